@@ -155,12 +155,22 @@ int main(int argc, char **argv)
         printf("  --loglevel <level> - One of the following:\n");
         printf("                       trace|debug|info|notice|warning|error|critical|alert|emerg.\n");
         printf("                       Default is debug.\n");
+        printf("  --logasync <n>     - Write log from separate thread through ring of n records.\n");
+        printf("  --logblock         - Wait for free record instead of dropping message\n");
+        printf("                       when asynchronous log is full.\n");
+        printf("  --trace <file>     - Record messages above log level into binary trace,\n");
+        printf("                       decode it with script/trace/gctrace.py.\n");
+        printf("  --tracesize <MB>   - Size of binary trace. Default is 16.\n");
         printf("  --backends <file>  - Specify list of backend nodes.\n");
         printf("                       Default is config/backend.cfg.\n");
         printf("  --daemonize        - Daemonize client.\n");
         printf("  --module <name>    - Name of the module. Comma-separated:\n");
         printf("                       phillipshue\n");
         printf("  --clientterm       - Terminate when first client disconnects\n");
+        printf("  --admin [port]     - Serve Prometheus metrics on 127.0.0.1:port/metrics.\n");
+        printf("                       Default port is %d.\n", GC_ADMIN_PORT);
+        printf("  --slowcallback <ms>- Log event loop callbacks slower than ms. Default is %d.\n",
+               GC_LOOP_SLOW_MS);
         printf("\n");
         exit(1);
     }
@@ -171,8 +181,14 @@ int main(int argc, char **argv)
     const char *backends    = "config/backends.cfg";
     const char *module      = NULL;
     int nolog = 0;
+    int log_async = 0;
+    int log_block = 0;
+    const char *trace_file = NULL;
+    int trace_size = 16;
     int daemonize = 0;
     int clientterm = 0;
+    int admin_port = 0;
+    int slow_callback = 0;
 
     int i;
     for(i = 0; i < argc; i++) {
@@ -186,12 +202,27 @@ int main(int argc, char **argv)
             daemonize = 1;
         else if(strcmp(argv[i], "--loglevel") == 0 && (i + 1) < argc)
             log_level = argv[i + 1];
+        else if(strcmp(argv[i], "--logasync") == 0 && (i + 1) < argc)
+            log_async = atoi(argv[i + 1]);
+        else if(strcmp(argv[i], "--logblock") == 0)
+            log_block = 1;
+        else if(strcmp(argv[i], "--trace") == 0 && (i + 1) < argc)
+            trace_file = argv[i + 1];
+        else if(strcmp(argv[i], "--tracesize") == 0 && (i + 1) < argc)
+            trace_size = atoi(argv[i + 1]);
         else if(strcmp(argv[i], "--backends") == 0 && (i + 1) < argc)
             backends = argv[i + 1];
         else if(strcmp(argv[i], "--module") == 0 && (i + 1) < argc)
             module = argv[i + 1];
         else if(strcmp(argv[i], "--clientterm") == 0)
             clientterm = 1;
+        else if(strcmp(argv[i], "--admin") == 0) {
+            admin_port = GC_ADMIN_PORT;
+            if((i + 1) < argc && atoi(argv[i + 1]) > 0)
+                admin_port = atoi(argv[i + 1]);
+        }
+        else if(strcmp(argv[i], "--slowcallback") == 0 && (i + 1) < argc)
+            slow_callback = atoi(argv[i + 1]);
     }
 
     if(config_file == NULL) {
@@ -216,6 +247,10 @@ int main(int argc, char **argv)
     gci.loop                   = ev_default_loop(0);
     gci.cfgfile                = config_file;
     gci.logfile                = log_file;
+    gci.logasync               = log_async;
+    gci.logoverflow            = log_block ? HM_LOG_OVERFLOW_BLOCK : HM_LOG_OVERFLOW_DROP;
+    gci.tracefile              = trace_file;
+    gci.tracesize              = (size_t)trace_size * 1024 * 1024;
     gci.backendfile            = backends;
     gci.callback.state_changed = callback_state_changed;
     gci.callback.login         = callback_login;
@@ -236,6 +271,8 @@ int main(int argc, char **argv)
     gci.module = MOD_NONE;
     if(module && strcmp(module, "phillipshue") == 0) gci.module |= MOD_PHILLIPSHUE;
     gci.clientterm = clientterm;
+    gci.adminport = admin_port;
+    gci.slowcallback = slow_callback;
 
     gc = gc_init(&gci);
     if(gc == NULL) {
@@ -0,0 +1,501 @@
+#!/usr/bin/env python3
+#
+# GrizzlyCloud library - simplified VPN alternative for IoT
+# Copyright (C) 2017 - 2018 Filip Pancik
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# Protocol generator.
+#
+# Reads message schema (script/proto/proto.json) and emits
+# src/include/proto.h and src/proto.c.
+#
+# Usage: script/proto/protogen.py [schema] [srcdir]
+#
+# Every message gets its own size_<msg>() and write_<msg>() function.
+# gc_serialize_size() returns exact length of a serialized message,
+# gc_serialize_write() fills caller's buffer in a single pass.
+#
+# Fields marked "ref" (bulk payloads) are not copied by gc_serialize_iov(),
+# it produces an iovec list of generated header blocks and direct
+# references to caller's payload instead.
+#
+
+import json
+import os
+import sys
+
+LICENSE = """/*
+ *
+ * GrizzlyCloud library - simplified VPN alternative for IoT
+ * Copyright (C) 2017 - 2018 Filip Pancik
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+"""
+
+GENERATED = "// This file is generated by script/proto/protogen.py, do not edit"
+
+
+class Field:
+    def __init__(self, spec):
+        if isinstance(spec, str):
+            self.name = spec
+            self.values = []
+            self.ref = False
+        else:
+            self.name = spec["name"]
+            self.values = spec.get("values", [])
+            self.ref = spec.get("ref", False)
+
+
+class Message:
+    def __init__(self, spec):
+        self.name = spec["name"]
+        self.member = self.name.lower()
+        self.fields = [Field(f) for f in spec["fields"]]
+        self.refs = [f for f in self.fields if f.ref]
+
+    def ref(self, field):
+        return "src->u.%s.%s" % (self.member, field.name)
+
+
+def gen_header(version, messages):
+    o = []
+    o.append(GENERATED)
+    o.append("#ifndef GC_PROTO_H_")
+    o.append("#define GC_PROTO_H_")
+    o.append("")
+    o.append("#define GCPROTO_VERSION\t%d" % version)
+    o.append("#define GCPROTO_OK  0")
+    o.append("#define GCPROTO_ERR 1")
+    o.append("#define GCPROTO_ERR_VERSION 2")
+    o.append("")
+    o.append("/* Space reserved in front of a serialized message for frame length */")
+    o.append("#define GCPROTO_FRAME_HEADROOM 4")
+    o.append("")
+    o.append("/* Maximum number of iovec entries filled by gc_serialize_iov() */")
+    o.append("#define GCPROTO_IOV_MAX %d" % (1 + 2 * max(len(m.refs) for m in messages)))
+    o.append("")
+    o.append("enum proto_e {")
+    for m in messages:
+        o.append("    %s," % m.name)
+    o.append("};")
+    o.append("")
+    o.append("struct proto_s {")
+    o.append("    enum proto_e type;")
+    o.append("    union {")
+    for m in messages:
+        o.append("        struct {")
+        if not m.fields:
+            o.append("            /* void */")
+        for f in m.fields:
+            o.append("            sn     %s;" % f.name)
+        o.append("        } %s;" % m.member)
+    o.append("    } u;")
+    o.append("};")
+    o.append("int gc_serialize(struct hm_pool_s *pool, sn *dst, struct proto_s *src);")
+    o.append("int gc_serialize_size(struct proto_s *src);")
+    o.append("int gc_serialize_write(char *dst, struct proto_s *src);")
+    o.append("int gc_serialize_hdr_size(struct proto_s *src);")
+    o.append("int gc_serialize_iov(char *hdr, struct iovec *iov, struct proto_s *src);")
+    o.append("int gc_deserialize(struct proto_s *dst, sn *src);")
+    o.append("void gc_proto_dump(struct proto_s *p);")
+    o.append("")
+    o.append("")
+    o.append("#endif")
+    return "\n".join(o) + "\n"
+
+
+def gen_dump(messages):
+    o = []
+    o.append("void gc_proto_dump(struct proto_s *p)")
+    o.append("{")
+    o.append("    switch(p->type) {")
+    for m in messages:
+        o.append("    case %s:" % m.name)
+        o.append("        printf(\"%s\\n\");" % m.name)
+        for f in m.fields:
+            r = "p->u.%s.%s" % (m.member, f.name)
+            o.append("        printf(\"%s: %%.*s\\n\", %s.n, %s.s);" % (f.name, r, r))
+        o.append("        break;")
+    o.append("")
+    o.append("        default:")
+    o.append("            return;")
+    o.append("            break;")
+    o.append("    }")
+    o.append("}")
+    return o
+
+
+def gen_helpers():
+    return """static inline char *put_int(char *dst, const int v)
+{
+    /* Network byte order, same as gc_swap_memory() on little endian */
+    dst[0] = (char)((unsigned int)v >> 24);
+    dst[1] = (char)((unsigned int)v >> 16);
+    dst[2] = (char)((unsigned int)v >> 8);
+    dst[3] = (char)((unsigned int)v);
+
+    return dst + sizeof(v);
+}
+
+static inline char *put_bin(char *dst, sn src)
+{
+    dst = put_int(dst, src.n);
+    if(src.n > 0) (void )memcpy(dst, src.s, src.n);
+
+    return dst + src.n;
+}
+
+static inline char *put_ref(char *dst, struct iovec *iov, int *niov, sn src)
+{
+    dst = put_int(dst, src.n);
+
+    // Close current header block, reference payload, open next block
+    iov[*niov - 1].iov_len = dst - (char *)iov[*niov - 1].iov_base;
+
+    iov[*niov].iov_base = src.s;
+    iov[*niov].iov_len  = src.n;
+    (*niov)++;
+
+    iov[*niov].iov_base = dst;
+    iov[*niov].iov_len  = 0;
+    (*niov)++;
+
+    return dst;
+}
+
+#define PROTO_INT_SIZE       ((int)sizeof(int))
+#define PROTO_BIN_SIZE(m_sn) (PROTO_INT_SIZE + (m_sn).n)
+
+static int get_int_intern(sn *src, int *value)
+{
+    assert(src);
+
+    if((int)(src->offset + sizeof(int)) > src->n) {
+        return GCPROTO_ERR;
+    }
+
+    *value = *(int *)(src->s + src->offset);
+    gc_swap_memory((void*)value, sizeof(*value));
+    src->offset += sizeof(*value);
+
+    return GCPROTO_OK;
+}
+
+static int get_intern(sn *dst, sn *src)
+{
+    if(src->offset + (int)sizeof(int) > src->n) {
+        return GCPROTO_ERR;
+    }
+
+    dst->n = *(int *)(src->s + src->offset);
+    dst->s = src->s + src->offset + sizeof(int);
+
+    gc_swap_memory((void*)&dst->n, sizeof(dst->n));
+
+    // increment offset
+    src->offset += sizeof(int) + dst->n;
+
+    return GCPROTO_OK;
+}
+
+static int get_enum(sn *src, enum proto_e *value)
+{
+    return get_int_intern(src, (int*)value);
+}
+
+static int get_int(sn *src, int *value)
+{
+    return get_int_intern(src, (int *)value);
+}""".split("\n")
+
+
+def gen_size(m):
+    o = []
+    o.append("static int size_%s(struct proto_s *src)" % m.member)
+    o.append("{")
+    if not m.fields:
+        o.append("    (void )src;")
+        o.append("")
+        o.append("    return 0;")
+        o.append("}")
+        return o
+
+    for f in m.fields:
+        if not f.values:
+            continue
+        r = m.ref(f)
+        conds = ["sn_memcmp(\"%s\", %d, %s.s, %s.n)" % (v, len(v), r, r)
+                 for v in f.values]
+        o.append("    if(!(%s)) {" % (" ||\n         ".join(conds)))
+        o.append("        return -1;")
+        o.append("    }")
+        o.append("")
+
+    sizes = ["PROTO_BIN_SIZE(%s)" % m.ref(f) for f in m.fields]
+    o.append("    return %s;" % (" +\n           ".join(sizes)))
+    o.append("}")
+    return o
+
+
+def gen_write(m):
+    o = []
+    o.append("static char *write_%s(char *dst, struct proto_s *src)" % m.member)
+    o.append("{")
+    if not m.fields:
+        o.append("    (void )src;")
+        o.append("")
+    for f in m.fields:
+        o.append("    dst = put_bin(dst, %s);" % m.ref(f))
+    if m.fields:
+        o.append("")
+    o.append("    return dst;")
+    o.append("}")
+    return o
+
+
+def gen_writev(m):
+    o = []
+    o.append("static char *writev_%s(char *dst, struct iovec *iov, int *niov, struct proto_s *src)" % m.member)
+    o.append("{")
+    for f in m.fields:
+        if f.ref:
+            o.append("    dst = put_ref(dst, iov, niov, %s);" % m.ref(f))
+        else:
+            o.append("    dst = put_bin(dst, %s);" % m.ref(f))
+    o.append("")
+    o.append("    return dst;")
+    o.append("}")
+    return o
+
+
+def gen_serialize_iov(messages):
+    o = []
+    o.append("int gc_serialize_hdr_size(struct proto_s *src)")
+    o.append("{")
+    o.append("    int n = gc_serialize_size(src);")
+    o.append("    if(n < 0) {")
+    o.append("        return -1;")
+    o.append("    }")
+    o.append("")
+    o.append("    switch(src->type) {")
+    for m in messages:
+        if not m.refs:
+            continue
+        o.append("        case %s:" % m.name)
+        for f in m.refs:
+            o.append("            n -= %s.n;" % m.ref(f))
+        o.append("            break;")
+    o.append("")
+    o.append("        default:")
+    o.append("        break;")
+    o.append("    }")
+    o.append("")
+    o.append("    return n;")
+    o.append("}")
+    o.append("")
+    o.append("int gc_serialize_iov(char *hdr, struct iovec *iov, struct proto_s *src)")
+    o.append("{")
+    o.append("    char *p = hdr;")
+    o.append("    int niov = 1;")
+    o.append("")
+    o.append("    iov[0].iov_base = hdr;")
+    o.append("    iov[0].iov_len  = 0;")
+    o.append("")
+    o.append("    p = put_int(p, GCPROTO_VERSION);")
+    o.append("    p = put_int(p, src->type);")
+    o.append("")
+    o.append("    switch(src->type) {")
+    for m in messages:
+        o.append("        case %s:" % m.name)
+        if m.refs:
+            o.append("            p = writev_%s(p, iov, &niov, src);" % m.member)
+        else:
+            o.append("            p = write_%s(p, src);" % m.member)
+        o.append("            break;")
+    o.append("")
+    o.append("        default:")
+    o.append("            return -1;")
+    o.append("        break;")
+    o.append("    }")
+    o.append("")
+    o.append("    iov[niov - 1].iov_len = p - (char *)iov[niov - 1].iov_base;")
+    o.append("    if(niov > 1 && iov[niov - 1].iov_len == 0) {")
+    o.append("        niov--;")
+    o.append("    }")
+    o.append("")
+    o.append("    return niov;")
+    o.append("}")
+    return o
+
+
+def gen_serialize(messages):
+    o = []
+    o.append("int gc_serialize_size(struct proto_s *src)")
+    o.append("{")
+    o.append("    int n;")
+    o.append("")
+    o.append("    switch(src->type) {")
+    for m in messages:
+        o.append("        case %s:" % m.name)
+        o.append("            n = size_%s(src);" % m.member)
+        o.append("            break;")
+    o.append("")
+    o.append("        default:")
+    o.append("            return -1;")
+    o.append("        break;")
+    o.append("    }")
+    o.append("")
+    o.append("    if(n < 0) {")
+    o.append("        return -1;")
+    o.append("    }")
+    o.append("")
+    o.append("    // version + type")
+    o.append("    return 2 * PROTO_INT_SIZE + n;")
+    o.append("}")
+    o.append("")
+    o.append("int gc_serialize_write(char *dst, struct proto_s *src)")
+    o.append("{")
+    o.append("    char *p = dst;")
+    o.append("")
+    o.append("    p = put_int(p, GCPROTO_VERSION);")
+    o.append("    p = put_int(p, src->type);")
+    o.append("")
+    o.append("    switch(src->type) {")
+    for m in messages:
+        o.append("        case %s:" % m.name)
+        o.append("            p = write_%s(p, src);" % m.member)
+        o.append("            break;")
+    o.append("")
+    o.append("        default:")
+    o.append("            return -1;")
+    o.append("        break;")
+    o.append("    }")
+    o.append("")
+    o.append("    return (int)(p - dst);")
+    o.append("}")
+    o.append("")
+    o.append("int gc_serialize(struct hm_pool_s *pool, sn *dst, struct proto_s *src)")
+    o.append("{")
+    o.append("    dst->s = NULL;")
+    o.append("    dst->n = dst->offset = 0;")
+    o.append("")
+    o.append("    int n = gc_serialize_size(src);")
+    o.append("    if(n < 0) {")
+    o.append("        return -1;")
+    o.append("    }")
+    o.append("")
+    o.append("    dst->s = hm_palloc(pool, n);")
+    o.append("    if(dst->s == NULL) {")
+    o.append("        return -1;")
+    o.append("    }")
+    o.append("")
+    o.append("    dst->n = gc_serialize_write(dst->s, src);")
+    o.append("    assert(dst->n == n);")
+    o.append("")
+    o.append("    return 0;")
+    o.append("}")
+    return o
+
+
+def gen_deserialize(messages):
+    o = []
+    o.append("#define CRET(m_func)\\")
+    o.append("    ret = m_func;\\")
+    o.append("    if(ret != GCPROTO_OK) return ret;")
+    o.append("")
+    o.append("int gc_deserialize(struct proto_s *dst, sn *src)")
+    o.append("{")
+    o.append("    src->offset = 0;")
+    o.append("")
+    o.append("    int ret;")
+    o.append("")
+    o.append("    int version;")
+    o.append("    CRET(get_int(src, &version))")
+    o.append("")
+    o.append("    if(version != GCPROTO_VERSION) {")
+    o.append("        return GCPROTO_ERR_VERSION;")
+    o.append("    }")
+    o.append("")
+    o.append("    CRET(get_enum(src, &dst->type))")
+    o.append("")
+    o.append("    switch(dst->type) {")
+    for m in messages:
+        o.append("    case %s:" % m.name)
+        for f in m.fields:
+            r = "dst->u.%s.%s" % (m.member, f.name)
+            o.append("        { sn tmp; CRET(get_intern(&tmp, src));")
+            o.append("        %s.s = tmp.s;" % r)
+            o.append("        %s.n = tmp.n;}" % r)
+        o.append("        break;")
+    o.append("")
+    o.append("        default:")
+    o.append("        return -1;")
+    o.append("    }")
+    o.append("")
+    o.append("    return 0;")
+    o.append("}")
+    return o
+
+
+def gen_source(messages):
+    o = []
+    o.append(GENERATED)
+    o.append("#include <gc.h>")
+    o.append("")
+    o += gen_dump(messages)
+    o.append("")
+    o += gen_helpers()
+    o.append("")
+    for m in messages:
+        o += gen_size(m)
+        o.append("")
+        o += gen_write(m)
+        o.append("")
+        if m.refs:
+            o += gen_writev(m)
+            o.append("")
+    o += gen_serialize(messages)
+    o.append("")
+    o += gen_serialize_iov(messages)
+    o.append("")
+    o += gen_deserialize(messages)
+    return LICENSE + "\n".join(o) + "\n"
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    schema = sys.argv[1] if len(sys.argv) > 1 else os.path.join(here, "proto.json")
+    srcdir = sys.argv[2] if len(sys.argv) > 2 else os.path.join(here, "..", "..", "src")
+
+    with open(schema) as f:
+        spec = json.load(f)
+
+    messages = [Message(m) for m in spec["messages"]]
+
+    with open(os.path.join(srcdir, "include", "proto.h"), "w") as f:
+        f.write(gen_header(spec["version"], messages))
+
+    with open(os.path.join(srcdir, "proto.c"), "w") as f:
+        f.write(gen_source(messages))
+
+
+if __name__ == "__main__":
+    main()
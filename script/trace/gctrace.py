@@ -0,0 +1,140 @@
+#!/usr/bin/env python3
+#
+# GrizzlyCloud library - simplified VPN alternative for IoT
+# Copyright (C) 2017 - 2018 Filip Pancik
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# Binary trace decoder.
+#
+# Reads ring file written by hm_log_trace_open() (see src/log.c for
+# the layout) and prints its records oldest first, formatted as text log.
+#
+# Usage: script/trace/gctrace.py <trace file>
+#
+# Trace may be decoded while process is still writing it, records being
+# overwritten at that moment may come out garbled.
+#
+
+import datetime
+import re
+import struct
+import sys
+
+HEADER  = struct.Struct('<8sIIQQQQQqq')
+SITE    = struct.Struct('<IIHHHH')
+RECORD  = struct.Struct('<IIq')
+TEXT    = 0x80000000
+PAD     = 0xffffffff
+LEVELS  = ['LOG_EMERG', 'LOG_ALERT', 'LOG_CRIT', 'LOG_ERR', 'LOG_WARNING',
+           'LOG_NOTICE', 'LOG_INFO', 'LOG_DEBUG', 'LOG_TRACE']
+
+# printf conversion, Python % ignores length modifiers only partially
+SPEC = re.compile(r'%([-+ #0\']*)(\*|\d+)?(?:\.(\*|\d+))?(?:hh|h|ll|l|L|q|j|z|t)*([a-zA-Z%])')
+
+
+def pyformat(fmt):
+    def spec(m):
+        flags, width, prec, conv = m.groups()
+        flags = flags.replace("'", '')
+        width = width or ''
+        prec = '.' + prec if prec is not None else ''
+        if conv == 'p':
+            return '0x%' + flags + width + 'x'
+        if conv == 'u':
+            conv = 'd'
+        return '%' + flags + width + prec + conv
+    return SPEC.sub(spec, fmt)
+
+
+def sites(data, hdr):
+    off = hdr['sites']
+    out = []
+    for _ in range(hdr['nsites']):
+        level, line, nfile, nfunc, nfmt, _r = SITE.unpack_from(data, off)
+        p = off + SITE.size
+        file = data[p:p + nfile].decode(errors='replace')
+        p += nfile
+        func = data[p:p + nfunc].decode(errors='replace')
+        p += nfunc
+        fmt = data[p:p + nfmt].decode(errors='replace')
+        p += nfmt
+        out.append((level, line, file, func, pyformat(fmt)))
+        off += (p - off + 7) & ~7
+    return out
+
+
+def args(data, off, end):
+    out = []
+    while off < end:
+        kind = data[off:off + 1]
+        off += 1
+        if kind == b'i':
+            out.append(struct.unpack_from('<i', data, off)[0])
+            off += 4
+        elif kind == b'l':
+            out.append(struct.unpack_from('<q', data, off)[0])
+            off += 8
+        elif kind == b'p':
+            out.append(struct.unpack_from('<Q', data, off)[0])
+            off += 8
+        elif kind == b'd':
+            out.append(struct.unpack_from('<d', data, off)[0])
+            off += 8
+        elif kind == b's':
+            n = struct.unpack_from('<H', data, off)[0]
+            off += 2
+            out.append(data[off:off + n].decode(errors='replace'))
+            off += n
+        else:
+            # Zero padding of aligned record
+            break
+    return out
+
+
+def decode(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+
+    hdr = dict(zip(('magic', 'version', 'nsites', 'sites', 'ring', 'size',
+                    'head', 'tail', 'realtime', 'monotonic'),
+                   HEADER.unpack_from(data, 0)))
+    if hdr['magic'].rstrip(b'\0') != b'GCTRACE' or hdr['version'] != 1:
+        sys.exit('%s: not a trace file' % path)
+
+    table = sites(data, hdr)
+    ring, size = hdr['ring'], hdr['size']
+    pos, head = hdr['tail'], hdr['head']
+
+    while pos < head:
+        start = ring + pos % size
+        length, site, ns = RECORD.unpack_from(data, start)
+        if length == 0:
+            break
+        pos += length
+        if site == PAD:
+            continue
+
+        level, line, file, func, fmt = table[site & ~TEXT]
+        values = args(data, start + RECORD.size, start + length)
+        if site & TEXT:
+            msg = values[0] if values else ''
+        else:
+            try:
+                msg = fmt % tuple(values)
+            except (TypeError, ValueError):
+                msg = fmt + ' ' + repr(values)
+
+        when = (hdr['realtime'] + ns - hdr['monotonic']) / 1e9
+        stamp = datetime.datetime.fromtimestamp(when).strftime('%Y-%m-%d %H:%M:%S.%f')
+        print('%s[%s] %s, %s:%d(%s)' % (LEVELS[level] if level < len(LEVELS) else level,
+                                         stamp, msg, file, line, func))
+
+
+if __name__ == '__main__':
+    if len(sys.argv) != 2:
+        sys.exit('Usage: %s <trace file>' % sys.argv[0])
+    decode(sys.argv[1])
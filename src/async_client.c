@@ -38,11 +38,18 @@ static void recv_append(struct gc_s *gc)
     }
 
     if(rb->recv.target != 0 && rb->recv.target <= rb->recv.len) {
-        c->net.buf = hm_prealloc(gc->pool, c->net.buf, rb->recv.target);
-        memcpy(c->net.buf, rb->recv.buf, rb->recv.target);
         c->net.n = rb->recv.target;
 
-        gc_ringbuffer_recv_pop(gc->pool, rb);
+        if(rb->recv.target == rb->recv.len) {
+            // Storage holds exactly one frame, take it over instead of copying
+            if(c->net.buf) hm_pfree(gc->pool, c->net.buf);
+            c->net.buf = gc_ringbuffer_recv_detach(rb);
+        } else {
+            c->net.buf = hm_prealloc(gc->pool, c->net.buf, rb->recv.target);
+            memcpy(c->net.buf, rb->recv.buf, rb->recv.target);
+
+            gc_ringbuffer_recv_pop(gc->pool, rb);
+        }
 
         if(c->callback.data) {
             c->callback.data(gc, c->net.buf, c->net.n);
@@ -89,6 +96,7 @@ static void async_read_ssl(struct ev_loop *loop, ev_io *w, int revents)
     int t = 0;
     struct gc_s *gc = (struct gc_s *)w->data;
     struct gc_gen_client_ssl_s *c = &gc->client;
+    gc_loop_watch(gc);
 
     (void)revents;
 
@@ -109,6 +117,7 @@ static void async_read_ssl(struct ev_loop *loop, ev_io *w, int revents)
     */
 
     if(t > 0) {
+        gc->metrics.upstream_bytes_in += t;
         gc_ringbuffer_recv_append(c->base.pool, &c->base.rb, t);
         /*
         FIXME: add MAX so we don't spend all memory
@@ -147,6 +156,7 @@ static void async_write_ssl(struct ev_loop *loop, ev_io *w, int revents)
     struct gc_s *gc = (struct gc_s *)w->data;
     struct gc_gen_client_ssl_s *c = &gc->client;
     int sz;
+    gc_loop_watch(gc);
 
     if(gc_sigterm == 1) return;
 
@@ -157,28 +167,49 @@ static void async_write_ssl(struct ev_loop *loop, ev_io *w, int revents)
         return;
     }
 
-    char *next = gc_ringbuffer_send_next(&c->base.rb, &sz);
+    int drained = 0;
+    t = 0;
 
-    if(sz == 0) {
-        ev_io_stop(loop, &c->base.write);
-        return;
-    }
+    // Frames are queued as several slots (header, payload reference),
+    // write consecutive slots while socket accepts them
+    for(;;) {
+        char *next = gc_ringbuffer_send_next(&c->base.rb, &sz);
 
-    t = SSL_write(c->ssl, next, sz);
-    /*
-       EAGAIN or EWOULDBLOCK The socket is marked nonblocking and the receive operation would block, or a receive timeout had been set and the timeout expired before data was received.
-     */
+        if(sz == 0 && !drained && c->callback.drained) {
+            // Let pending batch out before socket goes idle
+            drained = 1;
+            c->callback.drained(gc);
+            next = gc_ringbuffer_send_next(&c->base.rb, &sz);
+        }
 
-    if(t > 0) {
-        gc_ringbuffer_send_skip(c->base.pool, &c->base.rb, t);
-        if(gc_ringbuffer_send_is_empty(&c->base.rb)) {
+        if(sz == 0) {
             ev_io_stop(loop, &c->base.write);
-            if(c->callback.terminate) {
+            if(t > 0 && c->callback.terminate) {
                 c->callback.terminate(c, 0);
                 c->callback.terminate = NULL;
             }
+            return;
         }
-    } else if(t == -1 &&
+
+        unsigned long long start = gc_metrics_now();
+
+        t = SSL_write(c->ssl, next, sz);
+        /*
+           EAGAIN or EWOULDBLOCK The socket is marked nonblocking and the receive operation would block, or a receive timeout had been set and the timeout expired before data was received.
+         */
+
+        if(t <= 0) break;
+
+        gc_histogram_record(&gc->metrics.latency[GC_LATENCY_SSL_WRITE],
+                            gc_metrics_now() - start);
+
+        gc->metrics.upstream_bytes_out += t;
+        gc_ringbuffer_send_latency(&c->base.rb, t,
+                                   &gc->metrics.latency[GC_LATENCY_UPSTREAM_QUEUE]);
+        gc_ringbuffer_send_skip(c->base.pool, &c->base.rb, t);
+    }
+
+    if(t == -1 &&
         (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
         hm_log(LOG_TRACE, c->base.log, "Socket read EAGAIN|EWOULDBLOCK|EINTR");
         async_handle_socket_errno(c->base.log);
@@ -238,6 +269,8 @@ static void handle_connect(struct ev_loop *loop, ev_io *w, int revents)
     int t;
     struct gc_s *gc = (struct gc_s *)w->data;
     struct gc_gen_client_ssl_s *c = &gc->client;
+    gc_loop_watch(gc);
+
     t = connect(c->base.fd, (struct sockaddr *)&(c->servaddr), sizeof(c->servaddr));
     if(!t || errno == EISCONN || !errno) {
         ev_io_stop(loop, &c->ev_w_connect);
@@ -285,6 +318,7 @@ static void client_handshake(struct ev_loop *loop, ev_io *w, int revents)
     int t;
     struct gc_s *gc = (struct gc_s *)w->data;
     struct gc_gen_client_ssl_s *c = &gc->client;
+    gc_loop_watch(gc);
 
     t = SSL_do_handshake(c->ssl);
     if(t == 1) {
@@ -436,6 +470,7 @@ static void async_read(struct ev_loop *loop, ev_io *w, int revents)
     fd = w->fd;
 
     assert(c);
+    gc_loop_watch(c->base.gc);
 
     if(EQFLAG(c->base.flags, GC_WANT_SHUTDOWN)) {
         if(c->callback.error) {
@@ -493,27 +528,32 @@ static void async_write(struct ev_loop *loop, ev_io *w, int revents)
     fd = w->fd;
 
     assert(c);
+    gc_loop_watch(c->base.gc);
 
-    if(gc_ringbuffer_send_is_empty(&c->base.rb)) {
+    // Data queued while connecting is flushed by connect_done()
+    if(gc_ringbuffer_send_is_empty(&c->base.rb) || (c->base.flags & GC_CONNECTING)) {
         ev_io_stop(loop, &c->base.write);
         return;
     }
 
-    char *next = gc_ringbuffer_send_next(&c->base.rb, &sz);
+    struct iovec iov[RB_IOV_MAX];
+    struct msghdr msg = { .msg_iov = iov };
+    msg.msg_iovlen = gc_ringbuffer_send_iov(&c->base.rb, iov, RB_IOV_MAX);
 
-    if(sz == 0) {
-        ev_io_stop(loop, &c->base.write);
-        return;
-    }
-
-    sz = send(fd, next, sz, MSG_NOSIGNAL);
+    sz = sendmsg(fd, &msg, MSG_NOSIGNAL);
 
     hm_log(LOG_TRACE, c->base.log, "%d bytes sent to fd %d", sz, fd);
 
     if(sz > 0) {
+        gc_ringbuffer_send_latency(&c->base.rb, sz,
+                                   &c->base.gc->metrics.latency[GC_LATENCY_DELIVER]);
         gc_ringbuffer_send_skip(c->base.pool, &c->base.rb, sz);
+        if(c->callback.written) {
+            c->callback.written(c, sz);
+        }
         if(gc_ringbuffer_send_is_empty(&c->base.rb)) {
             ev_io_stop(loop, &c->base.write);
+            gc_stream_drained(c);
         }
     } else {
         async_handle_socket_errno(c->base.log);
@@ -524,6 +564,72 @@ static void async_write(struct ev_loop *loop, ev_io *w, int revents)
     }
 }
 
+static void connect_done(struct gc_gen_client_s *c, enum gcerr_e error)
+{
+    ev_io_stop(c->base.loop, &c->ev_w_connect);
+    ev_timer_stop(c->base.loop, &c->ev_t_connect);
+    c->base.flags &= ~GC_CONNECTING;
+
+    if(error != GC_NOERROR) {
+        c->callback.error(c, error);
+        return;
+    }
+
+    hm_log(LOG_TRACE, c->base.log, "Connected TCP client [%.*s:%d] fd: [%d]",
+                                   sn_p(c->base.net.ip), c->base.net.port,
+                                   c->base.fd);
+
+    ev_io_start(c->base.loop, &c->base.read);
+    if(!gc_ringbuffer_send_is_empty(&c->base.rb)) {
+        ev_io_start(c->base.loop, &c->base.write);
+    } else {
+        gc_stream_drained(c);
+    }
+}
+
+static void async_connect(struct ev_loop *loop, ev_io *w, int revents)
+{
+    (void)loop;
+    (void)revents;
+    struct gc_gen_client_s *c;
+    int err = 0;
+    socklen_t nerr = sizeof(err);
+
+    if(gc_sigterm == 1) return;
+
+    c = (struct gc_gen_client_s *)w->data;
+    assert(c);
+    gc_loop_watch(c->base.gc);
+
+    if(getsockopt(c->base.fd, SOL_SOCKET, SO_ERROR, &err, &nerr) == -1) {
+        err = errno;
+    }
+
+    if(err == EINPROGRESS || err == EINTR) return;
+
+    if(err != 0) {
+        hm_log(LOG_DEBUG, c->base.log, "{Connector}: connect() to port %d failed: %s",
+                                       c->base.net.port, strerror(err));
+        connect_done(c, GC_CONNECT_ERR);
+        return;
+    }
+
+    connect_done(c, GC_NOERROR);
+}
+
+static void async_connect_timeout(struct ev_loop *loop, ev_timer *w, int revents)
+{
+    (void)loop;
+    (void)revents;
+    struct gc_gen_client_s *c = (struct gc_gen_client_s *)w->data;
+    assert(c);
+    gc_loop_watch(c->base.gc);
+
+    hm_log(LOG_DEBUG, c->base.log, "{Connector}: connect() to port %d timed out",
+                                   c->base.net.port);
+    connect_done(c, GC_CONNECTTIMEOUT_ERR);
+}
+
 int async_client(struct gc_gen_client_s *client)
 {
     struct sockaddr_in servaddr;
@@ -557,16 +663,25 @@ int async_client(struct gc_gen_client_s *client)
 
     ev_io_init(&client->base.write, async_write, client->base.fd, EV_WRITE);
     ev_io_init(&client->base.read, async_read, client->base.fd, EV_READ);
+    ev_io_init(&client->ev_w_connect, async_connect, client->base.fd, EV_WRITE);
+    ev_timer_init(&client->ev_t_connect, async_connect_timeout, GC_CONNECT_TIMEOUT, 0.);
 
     client->base.read.data = client;
     client->base.write.data = client;
+    client->ev_w_connect.data = client;
+    client->ev_t_connect.data = client;
     gc_timestring(client->base.date, sizeof(client->base.date));
 
-    ev_io_start(client->base.loop, &client->base.read);
-    if(connect(client->base.fd, (struct sockaddr *)&servaddr, sizeof(servaddr)) != -1
-       && errno != EINPROGRESS) {
-        async_client_shutdown(client);
+    if(connect(client->base.fd, (struct sockaddr *)&servaddr, sizeof(servaddr)) == 0) {
+        connect_done(client, GC_NOERROR);
+    } else if(errno == EINPROGRESS || errno == EINTR) {
+        // Read and write wait until connect() completes
+        client->base.flags |= GC_CONNECTING;
+        ev_io_start(client->base.loop, &client->ev_w_connect);
+        ev_timer_start(client->base.loop, &client->ev_t_connect);
+    } else {
         hm_log(LOG_ERR, client->base.log, "{Connector}: connect() errno: %d", errno);
+        client->callback.error(client, GC_CONNECT_ERR);
         return GC_ERROR;
     }
 
@@ -26,6 +26,8 @@ void async_client_shutdown(struct gc_gen_client_s *c)
 
     ev_io_stop(c->base.loop, &c->base.read);
     ev_io_stop(c->base.loop, &c->base.write);
+    ev_io_stop(c->base.loop, &c->ev_w_connect);
+    ev_timer_stop(c->base.loop, &c->ev_t_connect);
 
     c->base.flags |= GC_WANT_SHUTDOWN;
 
@@ -43,16 +45,28 @@ void async_client_shutdown(struct gc_gen_client_s *c)
     }
 
     if(c->parent) {
-        char key[16];
-        snprintf(key, sizeof(key), "%d", c->base.fd);
-        ht_rem(c->parent->clients, key, strlen(key), p);
+        if(c->parent->callback.close) {
+            c->parent->callback.close(c);
+        }
+
+        struct gc_gen_server_s *s = c->parent;
+
+        if(c->prev) c->prev->next = c->next;
+        else s->clients = c->next;
+        if(c->next) c->next->prev = c->prev;
+        s->nclients--;
+
+        gc_registry_rem(&c->base.gc->streams, c->stream.id);
     }
 
+    gc_stream_free(p, &c->stream);
+
     struct gc_s *gc = c->base.gc;
+    int admin = (c->parent && c->parent == gc->metrics.admin);
     hm_pfree(p, c);
 
-    if(gc->clientterm) {
-        gc_force_stop();
+    if(gc->clientterm && !admin) {
+        gc_force_stop(gc);
     }
 }
 
@@ -60,6 +74,12 @@ static void client_error(struct gc_gen_client_s *c, enum gcerr_e err)
 {
     hm_log(LOG_TRACE, c->base.log, "Client error %d on fd %d",
                                    err, c->base.fd);
+
+    if(err == GC_READZERO_ERR && c->parent->callback.eof &&
+       c->parent->callback.eof(c) == GC_OK) {
+        return;
+    }
+
     async_client_shutdown(c);
 }
 
@@ -107,6 +127,7 @@ static void async_read(struct ev_loop *loop, ev_io *w, int revents)
     fd = w->fd;
 
     assert(c);
+    gc_loop_watch(c->base.gc);
 
     if(EQFLAG(c->base.flags, GC_WANT_SHUTDOWN)) {
         if(c->callback.error) {
@@ -163,24 +184,28 @@ static void async_write(struct ev_loop *loop, ev_io *w, int revents)
     fd = w->fd;
 
     assert(c);
+    gc_loop_watch(c->base.gc);
 
     if(gc_ringbuffer_send_is_empty(&c->base.rb)) {
         ev_io_stop(loop, &c->base.write);
         return;
     }
 
-    char *next = gc_ringbuffer_send_next(&c->base.rb, &sz);
+    struct iovec iov[RB_IOV_MAX];
+    struct msghdr msg = { .msg_iov = iov };
+    msg.msg_iovlen = gc_ringbuffer_send_iov(&c->base.rb, iov, RB_IOV_MAX);
 
-    if(sz == 0) {
-        ev_io_stop(loop, &c->base.write);
-        return;
-    }
-
-    sz = send(fd, next, sz, MSG_NOSIGNAL);
+    sz = sendmsg(fd, &msg, MSG_NOSIGNAL);
     if(sz > 0) {
+        gc_ringbuffer_send_latency(&c->base.rb, sz,
+                                   &c->base.gc->metrics.latency[GC_LATENCY_DELIVER]);
         gc_ringbuffer_send_skip(c->base.pool, &c->base.rb, sz);
+        if(c->callback.written) {
+            c->callback.written(c, sz);
+        }
         if(gc_ringbuffer_send_is_empty(&c->base.rb)) {
             ev_io_stop(loop, &c->base.write);
+            gc_stream_drained(c);
         }
     } else {
         async_handle_socket_errno(c->base.log);
@@ -205,19 +230,17 @@ static int async_client_accept(struct gc_gen_client_s *client)
     return GC_OK;
 }
 
-static int connector_addclient(struct gc_gen_server_s *cs, struct gc_gen_client_s *cc)
+static void connector_addclient(struct gc_gen_server_s *cs, struct gc_gen_client_s *cc)
 {
-    char key[8];
-    snprintf(key, sizeof(key), "%d", cc->base.fd);
-    if(HT_ADD_WA(cs->clients, key, strlen(key), cc, sizeof(cc), cs->pool) != GC_OK) {
-        hm_log(LOG_ERR, cs->log, "Cannot add key [%s] to hashtable", key);
-        return GC_ERROR;
-    }
-
-    hm_log(LOG_DEBUG, cs->log, "Adding tunnel TCP client [%.*s:%d] fd: [%d]",
-                                sn_p(cc->base.net.ip), cc->base.net.port, cc->base.fd);
-
-    return GC_OK;
+    cc->prev = NULL;
+    cc->next = cs->clients;
+    if(cs->clients) cs->clients->prev = cc;
+    cs->clients = cc;
+    cs->nclients++;
+
+    hm_log(LOG_DEBUG, cs->log, "Adding tunnel TCP client [%.*s:%d] fd: [%d] clients: [%d]",
+                                sn_p(cc->base.net.ip), cc->base.net.port, cc->base.fd,
+                                cs->nclients);
 }
 
 static void server_async_client(struct ev_loop *loop, ev_io *w, int revents)
@@ -232,6 +255,7 @@ static void server_async_client(struct ev_loop *loop, ev_io *w, int revents)
     if(gc_sigterm == 1) return;
 
     assert(cs);
+    gc_loop_watch(cs->gc);
 
     client = accept(w->fd, (struct sockaddr *) &addr, &sl);
     if(client == -1) {
@@ -316,19 +340,31 @@ static void server_async_client(struct ev_loop *loop, ev_io *w, int revents)
     cc->base.gc = cs->gc;
     cc->parent = cs;
     cc->callback.error = client_error;
+    cc->callback.written = cs->callback.written;
 #ifdef PEER_NAME
     sn_initz(snip, ipstr);
     snb_cpy_ds(cc->base.net.ip, snip);
     cc->base.net.port = pport;
 #endif
 
-    if(connector_addclient(cs, cc) != GC_OK) {
+    unsigned int id = gc_registry_add(cs->pool, &cs->gc->streams, cc);
+    if(id == 0) {
+        hm_log(LOG_ERR, cs->log, "Too many tunnel clients, closing fd %d", client);
+        (void )gc_fd_close(client);
         hm_pfree(cs->pool, cc);
         return;
     }
 
+    gc_stream_init(&cc->stream, id);
+
+    connector_addclient(cs, cc);
+
     cc->callback.data = cs->callback.data;
     async_client_accept(cc);
+
+    if(cs->callback.accept) {
+        cs->callback.accept(cc);
+    }
 }
 
 int async_server(struct gc_gen_server_s *cs, struct gc_s *gc,
@@ -349,6 +385,7 @@ int async_server(struct gc_gen_server_s *cs, struct gc_s *gc,
     cs->fd = socket(ai->ai_family, SOCK_STREAM, IPPROTO_TCP);
     if(cs->fd == -1) {
         hm_log(LOG_CRIT, cs->log, "Server socket() initialization failed");
+        freeaddrinfo(ai);
         return GC_ERROR;
     }
 
@@ -368,6 +405,8 @@ int async_server(struct gc_gen_server_s *cs, struct gc_s *gc,
 
     if(bind(cs->fd, ai->ai_addr, ai->ai_addrlen)) {
         hm_log(LOG_CRIT, cs->log, "Server bind() failed [%s:%s]", cs->host, cs->port);
+        freeaddrinfo(ai);
+        (void )gc_fd_close(cs->fd);
         return GC_ERROR;
     }
 
@@ -396,12 +435,6 @@ int async_server(struct gc_gen_server_s *cs, struct gc_s *gc,
     cs->listener.data = cs;
     ev_io_start(cs->loop, &cs->listener);
 
-    cs->clients = ht_init(cs->pool);
-    if(!cs->clients) {
-        hm_log(LOG_CRIT, cs->log, "Hashtable failed to initialize");
-        return GC_ERROR;
-    }
-
     hm_log(LOG_TRACE, cs->log, "Opening async server on %s:%s fd: %d %p",
                                cs->host, cs->port, cs->fd, cs);
 
@@ -420,14 +453,10 @@ void async_server_shutdown(struct gc_gen_server_s *s)
 
     (void )gc_fd_close(s->fd);
 
-    int i;
-    for(i = 0; i < HT_MAX; i++) {
-        if(!s->clients[i]) continue;
-        c = (struct gc_gen_client_s *)s->clients[i]->s;
-        if(c) async_client_shutdown(c);
+    // Client unlinks itself on shutdown
+    while((c = s->clients) != NULL) {
+        async_client_shutdown(c);
     }
 
-    ht_free(s->clients, s->pool);
-
     hm_pfree(p, s);
 }
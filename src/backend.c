@@ -56,6 +56,7 @@ static struct backend_s *backend_ping(struct gc_s *gcs,
 {
     int i;
     struct backend_s *gc, *head = NULL;
+    gc_loop_watch(gcs);
 
 #define GCA(m_ip, m_host, m_idx, m_next)\
     gc = hm_palloc(gcs->pool, sizeof(*gc));\
@@ -66,6 +67,10 @@ static struct backend_s *backend_ping(struct gc_s *gcs,
     gc->idx         = m_idx;\
     gc->next        = m_next;
 
+    if(count == 0) {
+        return NULL;
+    }
+
     if(compare == 0) {
         GCA(gcs->config.backends.item[0].ip,
             gcs->config.backends.item[0].hostname,
@@ -0,0 +1,220 @@
+/*
+ *
+ * GrizzlyCloud library - simplified VPN alternative for IoT
+ * Copyright (C) 2017 - 2018 Filip Pancik
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <gc.h>
+
+static voidpf codec_alloc(voidpf opaque, uInt items, uInt size)
+{
+    return hm_palloc((struct hm_pool_s *)opaque, items * size);
+}
+
+static void codec_release(voidpf opaque, voidpf address)
+{
+    hm_pfree((struct hm_pool_s *)opaque, address);
+}
+
+static unsigned long long codec_usec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+enum gc_codec_e gc_codec_parse(sn name)
+{
+    sn_initz(deflate, "deflate");
+
+    if(sn_cmps(name, deflate)) {
+        return GC_CODEC_DEFLATE;
+    }
+
+    return GC_CODEC_NONE;
+}
+
+const char *gc_codec_name(enum gc_codec_e type)
+{
+    switch(type) {
+        case GC_CODEC_DEFLATE:
+            return "deflate";
+        default:
+            return "none";
+    }
+}
+
+struct gc_codec_s *gc_codec_new(struct hm_pool_s *pool, enum gc_codec_e type,
+                                struct gc_codec_stats_s *stats)
+{
+    struct gc_codec_s *codec;
+
+    if(type != GC_CODEC_DEFLATE) {
+        return NULL;
+    }
+
+    codec = hm_palloc(pool, sizeof(*codec));
+    if(!codec) return NULL;
+
+    memset(codec, 0, sizeof(*codec));
+
+    codec->type  = type;
+    codec->stats = stats;
+
+    codec->deflate.zalloc = codec->inflate.zalloc = codec_alloc;
+    codec->deflate.zfree  = codec->inflate.zfree  = codec_release;
+    codec->deflate.opaque = codec->inflate.opaque = pool;
+
+    // Raw deflate, payloads are framed by protocol already
+    if(deflateInit2(&codec->deflate, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                    -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        hm_pfree(pool, codec);
+        return NULL;
+    }
+
+    if(inflateInit2(&codec->inflate, -MAX_WBITS) != Z_OK) {
+        deflateEnd(&codec->deflate);
+        hm_pfree(pool, codec);
+        return NULL;
+    }
+
+    return codec;
+}
+
+void gc_codec_free(struct hm_pool_s *pool, struct gc_codec_s *codec)
+{
+    if(!codec) return;
+
+    deflateEnd(&codec->deflate);
+    inflateEnd(&codec->inflate);
+
+    hm_pfree(pool, codec);
+}
+
+static void codec_backoff(struct gc_codec_s *codec)
+{
+    codec->backoff = codec->backoff == 0 ? 1 : codec->backoff * 2;
+    if(codec->backoff > GC_CODEC_MAX_BACKOFF) {
+        codec->backoff = GC_CODEC_MAX_BACKOFF;
+    }
+
+    codec->skip = codec->backoff;
+}
+
+int gc_codec_compress(struct hm_pool_s *pool, struct gc_codec_s *codec,
+                      sn src, sn *dst)
+{
+    assert(codec);
+
+    if(src.n < GC_CODEC_MIN_SIZE) {
+        return GC_ERROR;
+    }
+
+    if(codec->skip > 0) {
+        codec->skip--;
+        if(codec->stats) codec->stats->raw += src.n;
+        return GC_ERROR;
+    }
+
+    // Anything that doesn't fit is not worth sending compressed
+    int limit = src.n * GC_CODEC_POOR_RATIO / 100;
+    char *out = hm_palloc(pool, limit);
+    if(!out) return GC_ERROR;
+
+    unsigned long long start = codec_usec();
+
+    deflateReset(&codec->deflate);
+
+    codec->deflate.next_in   = (Bytef *)src.s;
+    codec->deflate.avail_in  = src.n;
+    codec->deflate.next_out  = (Bytef *)out;
+    codec->deflate.avail_out = limit;
+
+    int ret = deflate(&codec->deflate, Z_FINISH);
+
+    if(codec->stats) codec->stats->usec += codec_usec() - start;
+
+    if(ret != Z_STREAM_END) {
+        hm_pfree(pool, out);
+        codec_backoff(codec);
+        if(codec->stats) codec->stats->raw += src.n;
+        return GC_ERROR;
+    }
+
+    codec->backoff = 0;
+
+    dst->s = out;
+    dst->n = limit - codec->deflate.avail_out;
+
+    if(codec->stats) {
+        codec->stats->in  += src.n;
+        codec->stats->out += dst->n;
+    }
+
+    return GC_OK;
+}
+
+int gc_codec_decompress(struct hm_pool_s *pool, struct gc_codec_s *codec,
+                        sn src, sn *dst)
+{
+    assert(codec);
+
+    int n = src.n * 4 > 4096 ? src.n * 4 : 4096;
+    if(n > GC_CODEC_MAX_SIZE) n = GC_CODEC_MAX_SIZE;
+
+    char *out = hm_palloc(pool, n);
+    if(!out) return GC_ERROR;
+
+    unsigned long long start = codec_usec();
+
+    inflateReset(&codec->inflate);
+
+    codec->inflate.next_in  = (Bytef *)src.s;
+    codec->inflate.avail_in = src.n;
+
+    int ret;
+    for(;;) {
+        codec->inflate.next_out  = (Bytef *)out + codec->inflate.total_out;
+        codec->inflate.avail_out = n - codec->inflate.total_out;
+
+        ret = inflate(&codec->inflate, Z_FINISH);
+        if(ret == Z_STREAM_END) break;
+
+        // Output buffer is the only acceptable reason to stop
+        if((ret != Z_OK && ret != Z_BUF_ERROR) ||
+            codec->inflate.avail_out != 0 || n >= GC_CODEC_MAX_SIZE) {
+            break;
+        }
+
+        n = n * 2 > GC_CODEC_MAX_SIZE ? GC_CODEC_MAX_SIZE : n * 2;
+
+        char *tmp = hm_prealloc(pool, out, n);
+        if(!tmp) break;
+        out = tmp;
+    }
+
+    if(codec->stats) codec->stats->usec += codec_usec() - start;
+
+    if(ret != Z_STREAM_END) {
+        hm_pfree(pool, out);
+        return GC_ERROR;
+    }
+
+    dst->s = out;
+    dst->n = codec->inflate.total_out;
+
+    return GC_OK;
+}
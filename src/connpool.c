@@ -0,0 +1,232 @@
+/*
+ *
+ * GrizzlyCloud library - simplified VPN alternative for IoT
+ * Copyright (C) 2017 - 2018 Filip Pancik
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <gc.h>
+
+static struct gc_connpool_s *connpool_find(struct gc_s *gc, int port)
+{
+    struct gc_connpool_s *pool;
+    int i;
+
+    for(pool = gc->connpools; pool != NULL; pool = pool->next) {
+        if(pool->port == port) {
+            return pool;
+        }
+    }
+
+    for(i = 0; i < gc->config.nkeepalive; i++) {
+        if(gc->config.keepalive[i].port == port) break;
+    }
+
+    if(i == gc->config.nkeepalive) {
+        return NULL;
+    }
+
+    pool = hm_palloc(gc->pool, sizeof(*pool));
+    if(!pool) return NULL;
+
+    memset(pool, 0, sizeof(*pool));
+
+    pool->port     = port;
+    pool->max_idle = gc->config.keepalive[i].idle;
+    pool->timeout  = gc->config.keepalive[i].timeout;
+    pool->gc       = gc;
+
+    pool->next = gc->connpools;
+    gc->connpools = pool;
+
+    return pool;
+}
+
+/*
+ * Idle connection must have nothing to say, backend either closed
+ * it or is still writing response of previous stream.
+ */
+static int connpool_healthy(struct gc_gen_client_s *client)
+{
+    char c;
+    int n = recv(client->base.fd, &c, sizeof(c), MSG_PEEK | MSG_DONTWAIT);
+
+    return n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK) ? GC_OK : GC_ERROR;
+}
+
+static void connpool_unlink(struct gc_connpool_s *pool, struct gc_gen_client_s *client)
+{
+    if(client->prev) client->prev->next = client->next;
+    else pool->idle = client->next;
+    if(client->next) client->next->prev = client->prev;
+
+    client->prev = client->next = NULL;
+    pool->nidle--;
+
+    if(pool->nidle == 0) {
+        ev_timer_stop(pool->gc->loop, &pool->timer);
+    }
+}
+
+static void connpool_expire(struct ev_loop *loop, struct ev_timer *timer, int revents)
+{
+    (void )revents;
+
+    struct gc_connpool_s *pool = timer->data;
+    struct gc_gen_client_s *client, *next;
+    ev_tstamp now = ev_now(loop);
+    gc_loop_watch(pool->gc);
+
+    for(client = pool->idle; client != NULL; client = next) {
+        next = client->next;
+
+        if(now - client->idle < pool->timeout &&
+           connpool_healthy(client) == GC_OK) continue;
+
+        hm_log(LOG_TRACE, client->base.log, "Closing idle backend connection fd: [%d] port: [%d]",
+                                            client->base.fd, pool->port);
+
+        connpool_unlink(pool, client);
+        async_client_shutdown(client);
+    }
+}
+
+struct gc_gen_client_s *gc_connpool_get(struct gc_s *gc, int port)
+{
+    struct gc_connpool_s *pool = connpool_find(gc, port);
+    struct gc_gen_client_s *client;
+
+    if(!pool) return NULL;
+
+    while((client = pool->idle) != NULL) {
+        connpool_unlink(pool, client);
+
+        if(connpool_healthy(client) == GC_OK) {
+            pool->hits++;
+
+            hm_log(LOG_TRACE, client->base.log, "Reusing backend connection fd: [%d] port: [%d] hits: [%llu] misses: [%llu]",
+                                                client->base.fd, port,
+                                                pool->hits, pool->misses);
+            return client;
+        }
+
+        async_client_shutdown(client);
+    }
+
+    pool->misses++;
+
+    return NULL;
+}
+
+int gc_connpool_enabled(struct gc_s *gc, int port)
+{
+    int i;
+    for(i = 0; i < gc->config.nkeepalive; i++) {
+        if(gc->config.keepalive[i].port == port) return 1;
+    }
+
+    return 0;
+}
+
+int gc_connpool_put(struct gc_s *gc, struct gc_gen_client_s *client)
+{
+    struct gc_connpool_s *pool = connpool_find(gc, client->base.net.port);
+
+    if(!pool || pool->nidle >= pool->max_idle) {
+        return GC_ERROR;
+    }
+
+    // Pending connect would still fire its watcher or timeout on pooled client
+    if(EQFLAG(client->base.flags, GC_WANT_SHUTDOWN) ||
+       EQFLAG(client->base.flags, GC_CONNECTING) ||
+       client->stream.eof_sent ||
+       (client->stream.eof_recv && !client->stream.keepalive) ||
+       !gc_ringbuffer_send_is_empty(&client->base.rb) ||
+       connpool_healthy(client) != GC_OK) {
+        return GC_ERROR;
+    }
+
+    ev_io_stop(client->base.loop, &client->base.read);
+    ev_io_stop(client->base.loop, &client->base.write);
+
+    gc_stream_free(client->base.pool, &client->stream);
+    memset(&client->stream, 0, sizeof(client->stream));
+
+    client->endpoint = NULL;
+    client->idle = ev_now(gc->loop);
+
+    client->prev = NULL;
+    client->next = pool->idle;
+    if(pool->idle) pool->idle->prev = client;
+    pool->idle = client;
+
+    if(pool->nidle++ == 0) {
+        ev_timer_init(&pool->timer, connpool_expire, 1., 1.);
+        pool->timer.data = pool;
+        ev_timer_start(gc->loop, &pool->timer);
+    }
+
+    hm_log(LOG_TRACE, client->base.log, "Backend connection fd: [%d] port: [%d] kept alive, idle: [%d]",
+                                        client->base.fd, pool->port, pool->nidle);
+
+    return GC_OK;
+}
+
+void gc_connpool_reconfigure(struct gc_s *gc)
+{
+    struct gc_connpool_s *pool;
+    int i;
+
+    for(pool = gc->connpools; pool != NULL; pool = pool->next) {
+        for(i = 0; i < gc->config.nkeepalive; i++) {
+            if(gc->config.keepalive[i].port == pool->port) break;
+        }
+
+        // Pooling disabled for the port, idle connections are closed
+        if(i == gc->config.nkeepalive) {
+            pool->max_idle = 0;
+        } else {
+            pool->max_idle = gc->config.keepalive[i].idle;
+            pool->timeout  = gc->config.keepalive[i].timeout;
+        }
+
+        while(pool->nidle > pool->max_idle) {
+            struct gc_gen_client_s *client = pool->idle;
+            while(client->next) client = client->next;
+
+            connpool_unlink(pool, client);
+            async_client_shutdown(client);
+        }
+    }
+}
+
+void gc_connpool_free_all(struct gc_s *gc)
+{
+    struct gc_connpool_s *pool, *del;
+
+    for(pool = gc->connpools; pool != NULL; ) {
+        while(pool->idle) {
+            struct gc_gen_client_s *client = pool->idle;
+            connpool_unlink(pool, client);
+            async_client_shutdown(client);
+        }
+
+        del = pool;
+        pool = pool->next;
+        hm_pfree(gc->pool, del);
+    }
+
+    gc->connpools = NULL;
+}
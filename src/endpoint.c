@@ -19,42 +19,162 @@
  */
 #include <gc.h>
 
-static struct gc_endpoint_s *endpoints = NULL;
+static int endpoint_tables(struct gc_s *gc)
+{
+    if(!gc->endpoints.index) gc->endpoints.index = ht_init(gc->pool);
+    if(!gc->endpoints.peers) gc->endpoints.peers = ht_init(gc->pool);
+
+    return gc->endpoints.index && gc->endpoints.peers ? GC_OK : GC_ERROR;
+}
+
+static struct gc_endpoint_peer_s *peer_get(struct gc_s *gc, sn pid)
+{
+    struct hm_pool_s *pool = gc->pool;
+    struct ht_s *kv = ht_get(gc->endpoints.peers, pid.s, pid.n);
+    if(kv) return (struct gc_endpoint_peer_s *)kv->s;
+
+    struct gc_endpoint_peer_s *peer = hm_palloc(pool, sizeof(*peer));
+    if(!peer) return NULL;
+
+    memset(peer, 0, sizeof(*peer));
+    snb_cpy_ds(peer->pid, pid);
+
+    if(HT_ADD_WA(gc->endpoints.peers, peer->pid.s, peer->pid.n, peer, sizeof(peer), pool) != GC_OK) {
+        hm_pfree(pool, peer);
+        return NULL;
+    }
+
+    peer->next = gc->endpoints.list;
+    if(gc->endpoints.list) gc->endpoints.list->prev = peer;
+    gc->endpoints.list = peer;
+
+    return peer;
+}
+
+static int endpoint_link(struct gc_s *gc, struct gc_endpoint_s *ent)
+{
+    sn_initr(pid, ent->pid.s, ent->pid.n);
+
+    if(HT_ADD_WA(gc->endpoints.index, ent->key.s, ent->key.n, ent, sizeof(ent), gc->pool) != GC_OK) {
+        return GC_ERROR;
+    }
+
+    struct gc_endpoint_peer_s *peer = peer_get(gc, pid);
+    if(!peer) {
+        ht_rem(gc->endpoints.index, ent->key.s, ent->key.n, gc->pool);
+        return GC_ERROR;
+    }
+
+    ent->peer = peer;
+    ent->prev = NULL;
+    ent->next = peer->endpoints;
+    if(peer->endpoints) peer->endpoints->prev = ent;
+    peer->endpoints = ent;
+
+    return GC_OK;
+}
+
+static void endpoint_remove(struct gc_s *gc, struct gc_endpoint_s *ent)
+{
+    struct hm_pool_s *pool = gc->pool;
+    struct gc_endpoint_peer_s *peer = ent->peer;
+
+    if(ent->client) ent->client->endpoint = NULL;
+    if(ent->traffic) ent->traffic->active--;
+
+    ht_rem(gc->endpoints.index, ent->key.s, ent->key.n, pool);
+
+    if(peer) {
+        if(ent->prev) ent->prev->next = ent->next;
+        else peer->endpoints = ent->next;
+        if(ent->next) ent->next->prev = ent->prev;
+
+        // Last stream of remote process is gone
+        if(!peer->endpoints) {
+            ht_rem(gc->endpoints.peers, peer->pid.s, peer->pid.n, pool);
+
+            if(peer->prev) peer->prev->next = peer->next;
+            else gc->endpoints.list = peer->next;
+            if(peer->next) peer->next->prev = peer->prev;
+
+            hm_pfree(pool, peer);
+        }
+    }
+
+    hm_pfree(pool, ent);
+}
 
 static void endpoint_stop_client(struct gc_gen_client_s *c)
 {
-    struct gc_endpoint_s *prev = NULL;
     struct gc_endpoint_s *ent;
 
     assert(c);
 
-    for(ent = endpoints; ent != NULL; prev = ent, ent = ent->next) {
-        if(ent->client == c) {
+    ent = c->endpoint;
+    if(!ent) return;
 
-            if(prev) prev->next = ent->next;
-            else endpoints = ent->next;
+    hm_log(LOG_TRACE, c->base.log, "Removed endpoint on stream [%.*s]",
+                                   sn_p(ent->stream));
 
-            hm_log(LOG_TRACE, c->base.log, "Removed endpoint on fd [%.*s]",
-                                           sn_p(ent->remote_fd));
-            hm_pfree(c->base.pool, ent);
+    if(c->stream.codec) {
+        hm_log(LOG_DEBUG, c->base.log, "Stream [%.*s] %s: %llu -> %llu bytes, %llu bytes raw, %llu us",
+                                       sn_p(ent->stream),
+                                       gc_codec_name(c->stream.codec->type),
+                                       ent->stats.in, ent->stats.out,
+                                       ent->stats.raw, ent->stats.usec);
+    }
 
-            break;
-        }
+    endpoint_remove(c->base.gc, ent);
+}
+
+static int port_allowed(struct gc_s *gc, struct proto_s *p, const char *backend_port)
+{
+    char *end;
+    long port = strtol(backend_port, &end, 10);
+
+    if(end == backend_port || *end != '\0') {
+        return GC_ERROR;
     }
+
+    return gc_policy_check(&gc->config.policy,
+                           p->u.message_from.from_cloud,
+                           p->u.message_from.from_device,
+                           (int)port);
 }
 
-static int port_allowed(struct gc_s *gc, sn backend_port)
+static void endpoint_control(struct gc_s *gc, struct gc_endpoint_s *ent,
+                             const char *type, const char *extra)
 {
-    int i;
-    sn_atoi(port, backend_port, 8);
+    char header[96];
+    snprintf(header, sizeof(header), "%s/%.*s/%.*s%s", type,
+                                     sn_p(ent->backend_port),
+                                     sn_p(ent->stream),
+                                     extra);
 
-    for(i = 0; i < gc->config.nallowed; i++) {
-        if(gc->config.allowed[i] == port) {
-            return GC_OK;
-        }
+    sn_initr(tmp, "device", 6);
+    sn_initr(pid, ent->pid.s, ent->pid.n);
+
+    gc_stream_control(gc, tmp, pid, header);
+}
+
+static void endpoint_written(struct gc_gen_client_s *client, int len)
+{
+    struct gc_endpoint_s *ent = client->endpoint;
+
+    if(ent && ent->traffic) {
+        ent->traffic->bytes_out += len;
+        ent->traffic->packets_out++;
     }
 
-    return GC_ERROR;
+    int credit = gc_stream_consumed(&client->stream, len);
+    if(credit == 0) return;
+
+    if(!ent) return;
+
+    char extra[16];
+    snprintf(extra, sizeof(extra), "/%d", credit);
+
+    endpoint_control(client->base.gc, ent, "tunnel_credit", extra);
 }
 
 static void endpoint_recv(struct gc_gen_client_s *client, char *buf, int len)
@@ -63,135 +183,243 @@ static void endpoint_recv(struct gc_gen_client_s *client, char *buf, int len)
 
     assert(client);
 
-    for(ent = endpoints; ent != NULL; ent = ent->next) {
-        if(ent->client == client) {
+    // We should never receive data from client
+    // that doesn't belong to an endpoint
+    ent = client->endpoint;
+    if(!ent) abort();
+
+    if(ent->traffic) {
+        ent->traffic->bytes_in += len;
+        ent->traffic->packets_in++;
+    }
 
-            // Message header
-            char header[64];
-            snprintf(header, sizeof(header), "tunnel_response/%.*s/%.*s",
-                                             sn_p(ent->backend_port),
-                                             sn_p(ent->remote_fd));
-            sn_initr(snheader, header, strlen(header));
+    sn_initr(payload, buf, len);
+    void *mem = gc_ringbuffer_recv_detach(&client->base.rb);
 
-            sn_initr(tmp, "device", 6);
+    int compressed = gc_stream_encode(client, &payload, &mem) == GC_OK;
 
-            struct proto_s pr = { .type = MESSAGE_TO };
-            sn_set(pr.u.message_to.to,      tmp);
-            sn_set(pr.u.message_to.address, ent->pid);
-            sn_set(pr.u.message_to.tp,      snheader);
-            sn_setr(pr.u.message_to.body,   buf, len);
+    // Message header
+    char header[64];
+    snprintf(header, sizeof(header), "tunnel_response/%.*s/%.*s%s%s",
+                                     sn_p(ent->backend_port),
+                                     sn_p(ent->stream),
+                                     compressed ? "/" : "",
+                                     compressed ? gc_codec_name(client->stream.codec->type) : "");
+    sn_initr(snheader, header, strlen(header));
 
-            hm_log(LOG_TRACE, client->base.log, "Sending header [%.*s] and payload of %d bytes to upstream",
-                                                sn_p(snheader), len);
+    sn_initr(tmp, "device", 6);
 
-            assert(client->base.gc);
-            gc_packet_send(client->base.gc, &pr);
+    struct proto_s pr = { .type = MESSAGE_TO };
+    sn_set(pr.u.message_to.to,      tmp);
+    sn_set(pr.u.message_to.address, ent->pid);
+    sn_set(pr.u.message_to.tp,      snheader);
+    sn_set(pr.u.message_to.body,    payload);
 
-            return;
-        }
-    }
+    hm_log(LOG_TRACE, client->base.log, "Sending header [%.*s] and payload of %d bytes to upstream",
+                                        sn_p(snheader), payload.n);
 
-    // We should never receive data from client
-    // that doesn't exist in list of endpoints
-    abort();
+    assert(client->base.gc);
+
+    // Payload is queued straight from receive buffer
+    gc_packet_send_ref(client->base.gc, &pr, mem);
+
+    gc_stream_sent(client, len);
 }
 
 static void endpoint_error(struct gc_gen_client_s *c, enum gcerr_e error)
 {
     hm_log(LOG_TRACE, c->base.log, "Client error %d on fd %d, endpoint %p",
                                    error, c->base.fd, c);
+
+    struct gc_endpoint_s *ent = c->endpoint;
+
+    if(error == GC_READZERO_ERR && gc_stream_eof(c) == GC_OK) {
+        if(ent) endpoint_control(c->base.gc, ent, "tunnel_half_closed", "");
+        return;
+    }
+
+    if(ent && !c->stream.closed) {
+        endpoint_control(c->base.gc, ent, "tunnel_closed", "");
+    }
+
     endpoint_stop_client(c);
     async_client_shutdown(c);
 }
 
-static int endpoint_add(sn key, sn remote_fd, sn backend_port,
+static int endpoint_add(sn key, sn stream, sn backend_port,
                         sn remote_port, sn pid, struct gc_endpoint_s **ep,
                         struct gc_s *gc)
 {
     struct gc_endpoint_s *ent;
+
+    *ep = NULL;
+
+    if(endpoint_tables(gc) != GC_OK) return GC_ERROR;
+
     ent = hm_palloc(gc->pool, sizeof(*ent));
     if(!ent) return GC_ERROR;
 
+    memset(ent, 0, sizeof(*ent));
+
     snb_cpy_ds(ent->key,          key);
-    snb_cpy_ds(ent->remote_fd,    remote_fd);
+    snb_cpy_ds(ent->stream,       stream);
     snb_cpy_ds(ent->backend_port, backend_port);
     snb_cpy_ds(ent->pid,          pid);
 
-    *ep = ent;
+    sn_atoi(bp, backend_port, 32);
 
-    struct gc_gen_client_s *client = hm_palloc(gc->pool, sizeof(*client));
-    if(!client) return GC_ERROR;
+    // Reuse kept-alive backend connection if there's one
+    struct gc_gen_client_s *client = gc_connpool_get(gc, bp);
+    int pooled = client != NULL;
 
-    memset(client, 0, sizeof(*client));
+    if(!pooled) {
+        client = hm_palloc(gc->pool, sizeof(*client));
+        if(!client) {
+            hm_pfree(gc->pool, ent);
+            return GC_ERROR;
+        }
 
-    ent->client = client;
+        memset(client, 0, sizeof(*client));
+    }
 
     // Link new endpoint
-    ent->next = endpoints;
-    endpoints = ent;
+    if(endpoint_link(gc, ent) != GC_OK) {
+        if(pooled) async_client_shutdown(client);
+        else hm_pfree(gc->pool, client);
+        hm_pfree(gc->pool, ent);
+        return GC_ERROR;
+    }
 
-    sn_atoi(bp, backend_port, 32);
+    ent->client = client;
+    client->endpoint = ent;
+
+    ent->traffic = gc_metrics_endpoint(gc, bp);
+    if(ent->traffic) {
+        ent->traffic->accepted++;
+        ent->traffic->active++;
+    }
+
+    *ep = ent;
 
-    client->base.loop = gc->loop;
-    client->base.log  = &gc->log;
-    client->base.pool = gc->pool;
+    if(!pooled) {
+        client->base.loop = gc->loop;
+        client->base.log  = &gc->log;
+        client->base.pool = gc->pool;
 
-    sn_initz(ip, "0.0.0.0");
-    snb_cpy_ds(client->base.net.ip, ip);
+        sn_initz(ip, "0.0.0.0");
+        snb_cpy_ds(client->base.net.ip, ip);
+
+        client->base.net.port = bp;
+        client->base.gc = gc;
+    }
 
-    client->base.net.port  = bp;
     client->callback.data  = endpoint_recv;
     client->callback.error = endpoint_error;
+    client->callback.written = endpoint_written;
 
-    client->base.gc = gc;
+    sn_to_char(id, stream, 16);
+    gc_stream_init(&client->stream, (unsigned int)strtoul(id, NULL, 10));
+    client->stream.keepalive = gc_connpool_enabled(gc, bp);
 
-    int ret;
-    ret = async_client(client);
-    if(ret != GC_OK) return GC_ERROR;
+    if(pooled) {
+        ev_io_start(client->base.loop, &client->base.read);
+    } else if(async_client(client) != GC_OK) {
+        // Endpoint is already released by endpoint_error()
+        *ep = NULL;
+        return GC_ERROR;
+    }
 
-    hm_log(LOG_TRACE, client->base.log, "Endpoint added [remote_fd:backend_port:remote_port] [%.*s:%.*s:%.*s]",
-                                        sn_p(remote_fd), sn_p(backend_port), sn_p(remote_port));
+    hm_log(LOG_TRACE, client->base.log, "Endpoint added [stream:backend_port:remote_port] [%.*s:%.*s:%.*s]",
+                                        sn_p(stream), sn_p(backend_port), sn_p(remote_port));
 
     return GC_OK;
 }
 
-static struct gc_endpoint_s *endpoint_find(sn key)
+static struct gc_endpoint_s *endpoint_find(struct gc_s *gc, sn key)
 {
-    struct gc_endpoint_s *ent;
-    for(ent = endpoints; ent != NULL; ent = ent->next) {
-        if(sn_cmps(ent->key, key)) {
-            return ent;
-        }
-    }
+    if(!gc->endpoints.index) return NULL;
+
+    struct ht_s *kv = ht_get(gc->endpoints.index, key.s, key.n);
+    if(!kv) return NULL;
 
-    return NULL;
+    return (struct gc_endpoint_s *)kv->s;
 }
 
-void gc_endpoints_stop_all(struct hm_pool_s *pool)
+static void peer_stop(struct gc_s *gc, struct gc_endpoint_peer_s *peer)
 {
-    struct gc_endpoint_s *ent, *del;
+    struct gc_endpoint_s *ent, *next;
 
-    for(ent = endpoints; ent != NULL; ) {
-        if(ent->client) {
-            async_client_shutdown(ent->client);
-        }
-        del = ent;
-        ent = ent->next;
-        hm_pfree(pool, del);
+    // Peer is released together with its last endpoint
+    for(ent = peer->endpoints; ent != NULL; ent = next) {
+        next = ent->next;
+
+        struct gc_gen_client_s *client = ent->client;
+        endpoint_remove(gc, ent);
+
+        if(client) async_client_shutdown(client);
+    }
+}
+
+void gc_endpoints_stop_all(struct gc_s *gc)
+{
+    while(gc->endpoints.list) {
+        peer_stop(gc, gc->endpoints.list);
     }
 
-    endpoints = NULL;
+    if(gc->endpoints.index) ht_free(gc->endpoints.index, gc->pool);
+    if(gc->endpoints.peers) ht_free(gc->endpoints.peers, gc->pool);
+
+    gc->endpoints.index = NULL;
+    gc->endpoints.peers = NULL;
 }
 
-int gc_endpoint_request(struct gc_s *gc, struct proto_s *p, char **argv, int argc)
+void gc_endpoint_metrics(struct gc_s *gc)
 {
-    if(argc != 4) {
-        return GC_ERROR;
+    struct gc_metrics_port_s *mp;
+    struct gc_endpoint_peer_s *peer;
+    struct gc_endpoint_s *ent;
+
+    for(mp = gc->metrics.endpoints; mp != NULL; mp = mp->next) {
+        mp->traffic.queued = 0;
+    }
+
+    for(peer = gc->endpoints.list; peer != NULL; peer = peer->next) {
+        for(ent = peer->endpoints; ent != NULL; ent = ent->next) {
+            if(ent->traffic && ent->client) {
+                ent->traffic->queued += gc_ringbuffer_send_pending(&ent->client->base.rb);
+            }
+        }
     }
+}
 
+static int endpoint_get(struct gc_s *gc, struct proto_s *p, char **argv,
+                        struct gc_endpoint_s **ep)
+{
     sn_initr(backend_port, argv[1], strlen(argv[1]));
+    sn_initr(id, argv[2], strlen(argv[2]));
+
+    sn_initr(slash, "/", 1);
+    sn_bytes_new(gc->pool, key, p->u.message_from.from_address.n + slash.n + id.n);
+    sn_bytes_append(key, p->u.message_from.from_address);
+    sn_bytes_append(key, slash);
+    sn_bytes_append(key, id);
+
+    *ep = endpoint_find(gc, key);
+
+    // Stream was authorized when it was opened
+    if(*ep) {
+        sn_bytes_delete(gc->pool, key);
+        return GC_OK;
+    }
+
+    if(port_allowed(gc, p, argv[1]) != GC_OK) {
+        sn_bytes_delete(gc->pool, key);
+
+        hm_log(LOG_DEBUG, &gc->log, "Port [%.*s] denied to [cloud:device] [%.*s:%.*s]",
+                                    sn_p(backend_port),
+                                    sn_p(p->u.message_from.from_cloud),
+                                    sn_p(p->u.message_from.from_device));
 
-    if(port_allowed(gc, backend_port) != GC_OK) {
         char header[64];
         snprintf(header, sizeof(header), "tunnel_denied/%.*s",
                                          sn_p(backend_port));
@@ -208,62 +436,172 @@ int gc_endpoint_request(struct gc_s *gc, struct proto_s *p, char **argv, int arg
         return GC_OK;
     }
 
-    sn_initr(fd, argv[2], strlen(argv[2]));
+    sn_initr(remote_port,  argv[3], strlen(argv[3]));
+    sn_init(pid, p->u.message_from.from_address);
 
-    sn_bytes_new(gc->pool, key, p->u.message_from.from_address.n + fd.n);
+    int ret;
+    ret = endpoint_add(key, id, backend_port, remote_port,
+                       pid, ep, gc);
+
+    sn_bytes_delete(gc->pool, key);
+
+    if(ret != GC_OK) {
+        return ret;
+    }
+
+    hm_log(LOG_TRACE, &gc->log, "Adding endpoint");
+
+    return GC_OK;
+}
+
+static struct gc_endpoint_s *endpoint_lookup(struct gc_s *gc, struct proto_s *p,
+                                             char **argv)
+{
+    sn_initr(id, argv[2], strlen(argv[2]));
+
+    sn_initr(slash, "/", 1);
+    sn_bytes_new(gc->pool, key, p->u.message_from.from_address.n + slash.n + id.n);
     sn_bytes_append(key, p->u.message_from.from_address);
-    sn_bytes_append(key, fd);
+    sn_bytes_append(key, slash);
+    sn_bytes_append(key, id);
+
+    struct gc_endpoint_s *ep = endpoint_find(gc, key);
+
+    sn_bytes_delete(gc->pool, key);
+
+    return ep;
+}
+
+int gc_endpoint_open(struct gc_s *gc, struct proto_s *p, char **argv, int argc)
+{
+    // Optional 5th element offers payload compression
+    if(argc != 4 && argc != 5) {
+        return GC_ERROR;
+    }
+
+    struct gc_endpoint_s *ep;
+    int ret = endpoint_get(gc, p, argv, &ep);
+    if(ret != GC_OK || !ep || argc != 5 || ep->client->stream.codec) return ret;
+
+    sn_initr(name, argv[4], strlen(argv[4]));
+    enum gc_codec_e codec = gc_codec_parse(name);
+    if(codec == GC_CODEC_NONE) {
+        hm_log(LOG_TRACE, &gc->log, "Compression [%s] not supported", argv[4]);
+        return GC_OK;
+    }
+
+    ep->client->stream.codec = gc_codec_new(gc->pool, codec, &ep->stats);
+    if(!ep->client->stream.codec) return GC_OK;
 
-    struct gc_endpoint_s *ep = endpoint_find(key);
+    char extra[16];
+    snprintf(extra, sizeof(extra), "/%s", gc_codec_name(codec));
 
-    if(!ep) {
-        sn_initr(remote_port,  argv[3], strlen(argv[3]));
-        sn_init(pid, p->u.message_from.from_address);
+    endpoint_control(gc, ep, "tunnel_codec", extra);
 
-        int ret;
-        ret = endpoint_add(key, fd, backend_port, remote_port,
-                           pid, &ep, gc);
-        if(ret != GC_OK) return ret;
+    return GC_OK;
+}
 
-        hm_log(LOG_TRACE, &gc->log, "Adding endpoint");
-    } else {
-        hm_log(LOG_TRACE, &gc->log, "Reusing endpoint");
+int gc_endpoint_request(struct gc_s *gc, struct proto_s *p, char **argv, int argc)
+{
+    // Optional 5th element names codec of compressed payload
+    if(argc != 4 && argc != 5) {
+        return GC_ERROR;
     }
 
+    // Endpoint is created here as well if tunnel_open got lost
+    struct gc_endpoint_s *ep;
+    int ret = endpoint_get(gc, p, argv, &ep);
+    if(ret != GC_OK || !ep) return ret;
+
     hm_log(LOG_TRACE, &gc->log, "Receiving header [%s/%s/%s/%s] and payload of %d bytes",
                                 argv[0], argv[1], argv[2], argv[3], p->u.message_from.body.n);
 
-    gc_gen_ev_send(ep->client,
-                   p->u.message_from.body.s,
-                   p->u.message_from.body.n);
+    return gc_stream_deliver(gc, ep->client, p->u.message_from.body, argc == 5);
+}
 
-    sn_bytes_delete(gc->pool, key);
+int gc_endpoint_close(struct gc_s *gc, struct proto_s *p, char **argv, int argc)
+{
+    if(argc != 3) {
+        return GC_ERROR;
+    }
+
+    struct gc_endpoint_s *ep = endpoint_lookup(gc, p, argv);
+    if(!ep) return GC_ERROR;
+
+    hm_log(LOG_TRACE, &gc->log, "Stream [%.*s] closed by tunnel", sn_p(ep->stream));
+
+    struct gc_gen_client_s *client = ep->client;
+    client->stream.closed = 1;
+
+    // Released by endpoint_error() once remaining payload is written
+    if(gc_stream_draining(client)) return GC_OK;
+
+    endpoint_stop_client(client);
+
+    // Backend connection may serve another stream
+    if(gc_connpool_put(gc, client) != GC_OK) {
+        async_client_shutdown(client);
+    }
 
     return GC_OK;
 }
 
-void gc_endpoint_stop(struct hm_pool_s *pool, struct hm_log_s *log,
-                      sn address, sn cloud, sn device)
+int gc_endpoint_half_close(struct gc_s *gc, struct proto_s *p, char **argv, int argc)
 {
-    struct gc_endpoint_s *prev = NULL;
-    struct gc_endpoint_s *ent;
+    if(argc != 3) {
+        return GC_ERROR;
+    }
 
-    for(ent = endpoints; ent != NULL; prev = ent, ent = ent->next) {
-        if(sn_cmps(ent->pid, address)) {
+    struct gc_endpoint_s *ep = endpoint_lookup(gc, p, argv);
+    if(!ep) return GC_ERROR;
 
-            async_client_shutdown(ent->client);
+    struct gc_gen_client_s *client = ep->client;
 
-            if(prev) prev->next = ent->next;
-            else endpoints = ent->next;
+    if(gc_stream_peer_eof(client) != GC_OK) {
+        endpoint_error(client, GC_STREAMDONE_ERR);
+        return GC_OK;
+    }
 
-            hm_log(LOG_TRACE, log, "Removed endpoint [cloud:device:remote_fd:backend_port]\
-                                   [%.*s:%.*s:%.*s:%.*s]",
-                                   sn_p(cloud), sn_p(device),
-                                   sn_p(ent->remote_fd),
-                                   sn_p(ent->backend_port));
-            hm_pfree(pool, ent);
+    // Kept-alive backend isn't shut down, request is complete and stream
+    // ends from this side too, connection returns to pool on tunnel_close
+    if(client->stream.keepalive && !client->stream.eof_sent) {
+        ev_io_stop(client->base.loop, &client->base.read);
+        client->stream.paused = 0;
+        endpoint_control(gc, ep, "tunnel_half_closed", "");
+    }
 
-            break;
-        }
+    return GC_OK;
+}
+
+int gc_endpoint_window(struct gc_s *gc, struct proto_s *p, char **argv, int argc)
+{
+    if(argc != 4) {
+        return GC_ERROR;
     }
+
+    struct gc_endpoint_s *ep = endpoint_lookup(gc, p, argv);
+    if(!ep) return GC_ERROR;
+
+    sn_initr(bytes, argv[3], strlen(argv[3]));
+    sn_atoi(n, bytes, 16);
+    if(n <= 0) {
+        return GC_ERROR;
+    }
+
+    gc_stream_credit(ep->client, n);
+
+    return GC_OK;
+}
+
+void gc_endpoint_stop(struct gc_s *gc, sn address, sn cloud, sn device)
+{
+    if(!gc->endpoints.peers) return;
+
+    struct ht_s *kv = ht_get(gc->endpoints.peers, address.s, address.n);
+    if(!kv) return;
+
+    hm_log(LOG_TRACE, &gc->log, "Removing endpoints [cloud:device:pid] [%.*s:%.*s:%.*s]",
+                                sn_p(cloud), sn_p(device), sn_p(address));
+
+    peer_stop(gc, (struct gc_endpoint_peer_s *)kv->s);
 }
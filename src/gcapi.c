@@ -21,7 +21,83 @@
 
 int gc_sigterm = 0;
 
-static struct gc_s *gclocal = NULL;
+static int message_from(struct gc_s *gc, struct proto_s *p);
+
+static int batch_get(sn *src, sn *dst)
+{
+    int n;
+
+    if(src->offset + (int)sizeof(n) > src->n) return GC_ERROR;
+
+    memcpy(&n, src->s + src->offset, sizeof(n));
+    gc_swap_memory((void *)&n, sizeof(n));
+
+    if(n < 0 || n > src->n - src->offset - (int)sizeof(n)) return GC_ERROR;
+
+    dst->s = src->s + src->offset + sizeof(n);
+    dst->n = n;
+    src->offset += sizeof(n) + n;
+
+    return GC_OK;
+}
+
+/**
+ * @brief Unpack coalesced messages and dispatch them in order.
+ *
+ * Batch body is a sequence of length-prefixed (type, body) pairs,
+ * see gc_packet_send().
+ */
+static int message_batch(struct gc_s *gc, struct proto_s *p, char **argv, int argc)
+{
+    (void)argv;
+    (void)argc;
+
+    sn body = p->u.message_from.body;
+    body.offset = 0;
+
+    while(body.offset < body.n) {
+        struct proto_s inner = *p;
+
+        if(batch_get(&body, &inner.u.message_from.tp) != GC_OK ||
+           batch_get(&body, &inner.u.message_from.body) != GC_OK) {
+            hm_log(LOG_DEBUG, &gc->log, "Malformed batch");
+            return GC_ERROR;
+        }
+
+        // Sender only packs small messages, see gc_packet_send()
+        if(inner.u.message_from.tp.n + inner.u.message_from.body.n >= GC_PACKET_REF_MIN) {
+            hm_log(LOG_DEBUG, &gc->log, "Oversized batch entry");
+            return GC_ERROR;
+        }
+
+        // No nesting
+        if(sn_cmps(inner.u.message_from.tp, p->u.message_from.tp)) continue;
+
+        // Entries share upstream frame, payloads have to be copied
+        gc->batch.unpacking = 1;
+        message_from(gc, &inner);
+        gc->batch.unpacking = 0;
+    }
+
+    return GC_OK;
+}
+
+static void message_failed(struct gc_s *gc, struct proto_s *p, const char *reason)
+{
+    sn tp = p->u.message_from.tp;
+    int i;
+
+    // Delimiters were terminated by gc_parse_delimiter()
+    for(i = 0; i < tp.n; i++) {
+        if(tp.s[i] == '\0') tp.s[i] = '/';
+    }
+
+    hm_log(LOG_DEBUG, &gc->log, "Message [%.*s] from [%.*s:%.*s] %s",
+                                sn_p(tp),
+                                sn_p(p->u.message_from.from_device),
+                                sn_p(p->u.message_from.from_address),
+                                reason);
+}
 
 static int message_from(struct gc_s *gc, struct proto_s *p)
 {
@@ -31,43 +107,53 @@ static int message_from(struct gc_s *gc, struct proto_s *p)
 
     ret = gc_parse_delimiter(gc->pool, p->u.message_from.tp,
                              &argv, &argc, '/');
-    if(ret != GC_OK) {
-        if(argv) hm_pfree(gc->pool, argv);
-        return ret;
-    }
-
-    if(argc < 1) {
+    if(ret != GC_OK || argc < 1) {
+        message_failed(gc, p, "malformed");
         if(argv) hm_pfree(gc->pool, argv);
         return GC_ERROR;
     }
 
     sn_initr(type, argv[0], strlen(argv[0]));
-    sn_initz(response, "tunnel_response");
-    sn_initz(request, "tunnel_request");
-    sn_initz(update, "tunnel_update");
 
-    if(sn_cmps(type, request)) {
-        ret = gc_endpoint_request(gc, p, argv, argc);
-        if(ret != GC_OK) {
-            hm_log(LOG_TRACE, &gc->log, "Tunnel request failed");
-        }
-    } else if(sn_cmps(type, response)) {
-        ret = gc_tunnel_response(gc, p, argv, argc);
-        if(ret != GC_OK) {
-            hm_log(LOG_TRACE, &gc->log, "Tunnel reponse failed");
+    static const struct {
+        const char *type;
+        int (*handler)(struct gc_s *gc, struct proto_s *p, char **argv, int argc);
+    } handlers[] = {
+        { "tunnel_open",        gc_endpoint_open },
+        { "tunnel_request",     gc_endpoint_request },
+        { "tunnel_close",       gc_endpoint_close },
+        { "tunnel_half_close",  gc_endpoint_half_close },
+        { "tunnel_window",      gc_endpoint_window },
+        { "tunnel_response",    gc_tunnel_response },
+        { "tunnel_closed",      gc_tunnel_closed },
+        { "tunnel_half_closed", gc_tunnel_half_closed },
+        { "tunnel_credit",      gc_tunnel_credit },
+        { "tunnel_codec",       gc_tunnel_codec },
+        { "tunnel_update",      gc_tunnel_update },
+        { "batch",              message_batch },
+    };
+
+    int i, nhandlers = COUNT(handlers);
+    for(i = 0; i < nhandlers; i++) {
+        if(sn_memcmp(handlers[i].type, strlen(handlers[i].type), type.s, type.n)) {
+            break;
         }
-    } else if(sn_cmps(type, update)) {
-        ret = gc_tunnel_update(gc, p, argv, argc);
+    }
+
+    if(i == nhandlers) {
+        // Newer peers may send types we don't know about
+        message_failed(gc, p, "has unknown type");
+        ret = GC_ERROR;
+    } else {
+        ret = handlers[i].handler(gc, p, argv, argc);
         if(ret != GC_OK) {
-            hm_log(LOG_TRACE, &gc->log, "Tunnel update failed");
+            message_failed(gc, p, "failed");
         }
-    } else {
-        abort();
     }
 
     hm_pfree(gc->pool, argv);
 
-    return GC_OK;
+    return ret;
 }
 
 static void pairs_offline(struct gc_s *gc, sn address)
@@ -78,6 +164,7 @@ static void pairs_offline(struct gc_s *gc, sn address)
             if(sn_len(gc->config.tunnels[i].pid) > 0)
                 fs_unpair(&gc->log, &gc->config.tunnels[i].pid);
             gc->config.tunnels[i].pid.n = 0;
+            gc->config.tunnels[i].pairing = 0;
         } else if(sn_cmps(gc->config.tunnels[i].pid, address)) {
             hm_log(LOG_TRACE, &gc->log, "Tunnel marking pair [cloud:device:port:port_local] [%.*s:%.*s:%d:%d] offline",
                                       sn_p(gc->config.tunnels[i].cloud),
@@ -86,11 +173,12 @@ static void pairs_offline(struct gc_s *gc, sn address)
                                       gc->config.tunnels[i].port_local);
             fs_unpair(&gc->log, &gc->config.tunnels[i].pid);
             gc->config.tunnels[i].pid.n = 0;
-            break;
         }
     }
 }
 
+static void pair_reset(struct gc_s *gc);
+
 static void cloud_offline(struct gc_s *gc, struct proto_s *p)
 {
     hm_log(LOG_TRACE, &gc->log, "Cloud device offline [cloud:device:port:port_local] [%.*s:%.*s]",
@@ -98,80 +186,91 @@ static void cloud_offline(struct gc_s *gc, struct proto_s *p)
                                 sn_p(p->u.offline_set.device));
 
     pairs_offline(gc, p->u.offline_set.address);
-    gc_endpoint_stop(gc->pool, &gc->log,
-                     p->u.offline_set.address,
+    pair_reset(gc);
+
+    gc_endpoint_stop(gc, p->u.offline_set.address,
                      p->u.offline_set.cloud,
                      p->u.offline_set.device);
 
-    gc_tunnel_stop(gc->pool, &gc->log, p->u.offline_set.address);
+    gc_tunnel_stop(gc, p->u.offline_set.address);
 }
 
-static void gc_upstream_force_stop(struct ev_loop *loop)
+static void gc_upstream_force_stop(struct gc_s *gc)
 {
-    hm_log(LOG_TRACE, &gclocal->log, "Upstream force stop");
-    ev_timer_stop(loop, &gclocal->connect_timer);
-    if(gclocal->client.base.active) {
-        async_client_ssl_shutdown(&gclocal->client);
-        gclocal->client.base.active = 0;
+    hm_log(LOG_TRACE, &gc->log, "Upstream force stop");
+    ev_timer_stop(gc->loop, &gc->connect_timer);
+    if(gc->client.base.active) {
+        async_client_ssl_shutdown(&gc->client);
+        gc->client.base.active = 0;
     }
 }
 
 static void callback_error(struct gc_gen_client_ssl_s *c, enum gcerr_e error)
 {
+    struct gc_s *gc = c->base.gc;
+
     hm_log(LOG_TRACE, c->base.log, "Upstream error %d", error);
 
+    gc->metrics.upstream_disconnects++;
+
     // Remove tunnels' pid's
     sn_initr(empty_pid, "", 0);
-    pairs_offline(gclocal, empty_pid);
+    pairs_offline(gc, empty_pid);
 
     // Stop pair timer
-    ev_timer_stop(gclocal->loop, &gclocal->config.pair_timer);
+    ev_timer_stop(gc->loop, &gc->config.pair_timer);
+    gc->logged = 0;
 
-    gc_tunnel_stop_all(c->base.pool, c->base.log);
-    gc_endpoints_stop_all();
+    // Pending batch was addressed to peers of this session
+    gc->batch.count = 0;
+    gc->batch.buf.n = 0;
+
+    gc_tunnel_stop_all(gc);
+    gc_endpoints_stop_all(gc);
     if(c->base.active) {
         async_client_ssl_shutdown(c);
         c->base.active = 0;
     }
-    ev_timer_again(gclocal->loop, &gclocal->connect_timer);
+    ev_timer_again(gc->loop, &gc->connect_timer);
 }
 
 static void device_pair_reply(struct gc_s *gc, struct gc_device_pair_s *pair)
 {
-    if(gc_tunnel_add(gc, pair, pair->type) != GC_OK) {
-        gc_force_stop();
+    sn_initz(forced, "forced");
+    int forced_pair = sn_cmps(pair->type, forced);
+
+    sn_initr(port_local, pair->port_local.s, pair->port_local.n);
+    struct gc_config_tunnel_s *t = forced_pair ? NULL :
+                                   gc_config_tunnel_find(&gc->config, pair->cloud, pair->device,
+                                                         pair->port_remote, port_local);
+
+    // Tunnel removed by reload or already paired by earlier reply
+    if(!forced_pair && (!t || sn_len(t->pid) != 0)) {
+        hm_log(LOG_WARNING, &gc->log, "Tunnel [cloud:device:port:port_local] [%.*s:%.*s:%.*s:%.*s] not paired",
+                                      sn_p(pair->cloud),
+                                      sn_p(pair->device),
+                                      sn_p(pair->port_local),
+                                      sn_p(pair->port_remote));
         return;
     }
 
-    sn_initz(forced, "forced");
-    if(sn_cmps(pair->type, forced)) {
+    pair->codec = t ? t->codec : GC_CODEC_NONE;
+
+    if(gc_tunnel_add(gc, pair, pair->type) != GC_OK) {
+        gc_force_stop(gc);
         return;
     }
 
-    int i;
-    for(i = 0; i < gc->config.ntunnels; i++) {
-        sn_itoa(port,       gc->config.tunnels[i].port, 8);
-        sn_itoa(port_local, gc->config.tunnels[i].port_local,  8);
-
-        if(sn_cmps(gc->config.tunnels[i].cloud, pair->cloud) &&
-           sn_cmps(gc->config.tunnels[i].device, pair->device) &&
-           sn_cmps(port, pair->port_remote) &&
-           sn_cmps(port_local, pair->port_local)) {
-
-            hm_log(LOG_TRACE, &gc->log, "Tunnel [cloud:device:port:port_local] [%.*s:%.*s:%.*s:%.*s] active",
-                                        sn_p(pair->cloud), sn_p(pair->device),
-                                        sn_p(port), sn_p(port_local));
-            snb_cpy_ds(gc->config.tunnels[i].pid, pair->pid);
-            fs_pair(&gc->log, pair);
-            return;
-        }
+    if(forced_pair) {
+        return;
     }
 
-    hm_log(LOG_WARNING, &gc->log, "Tunnel [cloud:device:port:port_local] [%.*s:%.*s:%.*s:%.*s] not paired",
-                                  sn_p(pair->cloud),
-                                  sn_p(pair->device),
-                                  sn_p(pair->port_local),
-                                  sn_p(pair->port_remote));
+    hm_log(LOG_TRACE, &gc->log, "Tunnel [cloud:device:port:port_local] [%.*s:%.*s:%d:%d] active",
+                                sn_p(pair->cloud), sn_p(pair->device),
+                                t->port, t->port_local);
+    snb_cpy_ds(t->pid, pair->pid);
+    t->pairing = 0;
+    fs_pair(&gc->log, pair);
 }
 
 static void traffic_mi(struct gc_s *gc)
@@ -183,34 +282,107 @@ static void traffic_mi(struct gc_s *gc)
     if(ret != GC_OK) CALLBACK_ERROR(&gc->log, "traffic_mi");
 }
 
-static void devices_pair(struct ev_loop *loop, struct ev_timer *timer, int revents)
+static int devices_pair(struct gc_s *gc, int resend)
+{
+    struct proto_s *pr;
+    char (*ports)[2][8];
+    int i, n = 0;
+
+    if(gc->config.ntunnels == 0) return 0;
+
+    pr    = hm_palloc(gc->pool, gc->config.ntunnels * sizeof(*pr));
+    ports = hm_palloc(gc->pool, gc->config.ntunnels * sizeof(*ports));
+    if(!pr || !ports) {
+        if(pr) hm_pfree(gc->pool, pr);
+        if(ports) hm_pfree(gc->pool, ports);
+        CALLBACK_ERROR(&gc->log, "device_pair");
+        return gc->config.ntunnels;
+    }
+
+    for(i = 0; i < gc->config.ntunnels; i++) {
+        struct gc_config_tunnel_s *t = &gc->config.tunnels[i];
+
+        if(sn_len(t->pid) != 0) continue;
+
+        // Reply to earlier request may still arrive
+        if(t->pairing && !resend) continue;
+        t->pairing = 1;
+
+        char *port       = ports[n][0];
+        char *port_local = ports[n][1];
+        int nport        = snprintf(port,       sizeof(ports[n][0]), "%d", t->port);
+        int nport_local  = snprintf(port_local, sizeof(ports[n][1]), "%d", t->port_local);
+
+        memset(&pr[n], 0, sizeof(pr[n]));
+        pr[n].type = DEVICE_PAIR;
+        sn_set(pr[n].u.device_pair.cloud,        t->cloud);
+        sn_set(pr[n].u.device_pair.device,       t->device);
+        sn_setr(pr[n].u.device_pair.local_port,  port_local, nport_local);
+        sn_setr(pr[n].u.device_pair.remote_port, port,       nport);
+
+        hm_log(LOG_TRACE, &gc->log, "Attempt to pair [cloud:device:port:port_local] [%.*s:%.*s:%d:%d]",
+                                    sn_p(t->cloud), sn_p(t->device),
+                                    t->port, t->port_local);
+        n++;
+    }
+
+    if(n > 0 && gc_packet_send_all(gc, pr, n) != GC_OK) {
+        CALLBACK_ERROR(&gc->log, "device_pair");
+    }
+
+    hm_pfree(gc->pool, pr);
+    hm_pfree(gc->pool, ports);
+
+    return n;
+}
+
+static void pair_schedule(struct gc_s *gc)
+{
+    struct ev_timer *timer = &gc->config.pair_timer;
+
+    if(ev_is_active(timer)) return;
+
+    ev_timer_set(timer, gc->config.pair_backoff, 0.);
+    ev_timer_start(gc->loop, timer);
+}
+
+static void pair_retry(struct ev_loop *loop, struct ev_timer *timer, int revents)
 {
     struct gc_s *gc = (struct gc_s *)timer->data;
 
     assert(gc);
+    gc_loop_watch(gc);
 
-    int i;
-    for(i = 0; i < gc->config.ntunnels; i++) {
-        if(sn_len(gc->config.tunnels[i].pid) != 0) continue;
+    if(devices_pair(gc, 1) == 0) return;
 
-        struct proto_s pr = { .type = DEVICE_PAIR };
-        sn_set(pr.u.device_pair.cloud,       gc->config.tunnels[i].cloud);
-        sn_set(pr.u.device_pair.device,      gc->config.tunnels[i].device);
+    // Keep retrying, no reply might come for devices that are offline
+    gc->config.pair_backoff *= 2;
+    if(gc->config.pair_backoff > GC_PAIR_BACKOFF_MAX) {
+        gc->config.pair_backoff = GC_PAIR_BACKOFF_MAX;
+    }
 
-        sn_itoa(port,       gc->config.tunnels[i].port, 8);
-        sn_itoa(port_local, gc->config.tunnels[i].port_local, 8);
+    pair_schedule(gc);
+}
+
+static void pair_reset(struct gc_s *gc)
+{
+    gc->config.pair_backoff = GC_PAIR_BACKOFF_MIN;
 
-        sn_set(pr.u.device_pair.local_port,  port_local);
-        sn_set(pr.u.device_pair.remote_port, port);
+    ev_timer_stop(gc->loop, &gc->config.pair_timer);
+    pair_schedule(gc);
+}
 
-        hm_log(LOG_TRACE, &gc->log, "Attempt to pair [cloud:device:port:port_local] [%.*s:%.*s:%.*s:%.*s]",
-                                    sn_p(gc->config.tunnels[i].cloud),
-                                    sn_p(gc->config.tunnels[i].device),
-                                    sn_p(port), sn_p(port_local));
-        int ret;
-        ret = gc_packet_send(gc, &pr);
-        if(ret != GC_OK) CALLBACK_ERROR(&gc->log, "device_pair");
+static void pair_done(struct gc_s *gc)
+{
+    int i;
+    for(i = 0; i < gc->config.ntunnels; i++) {
+        if(sn_len(gc->config.tunnels[i].pid) == 0) return;
     }
+
+    hm_log(LOG_TRACE, &gc->log, "All tunnels paired");
+
+    ev_timer_stop(gc->loop, &gc->config.pair_timer);
+    gc->config.pair_backoff = GC_PAIR_BACKOFF_MIN;
 }
 
 static void modules_stop(struct gc_s *gc)
@@ -241,17 +413,17 @@ static void client_logged(struct gc_s *gc, sn error)
     sn_initz(ok_reg, "ok_registered");
 
     if(sn_cmps(ok, error)) {
+        gc->logged = 1;
+
         sn_initz(traffic, "traffic");
         if(sn_cmps(gc->config.action, traffic)) {
             traffic_mi(gc);
-        } else {
-            ev_init(&gc->config.pair_timer, devices_pair);
-            gc->config.pair_timer.repeat = 2.0;
-            gc->config.pair_timer.data = gc;
-            ev_timer_again(gc->loop, &gc->config.pair_timer);
+        } else if(devices_pair(gc, 1) > 0) {
+            gc->config.pair_backoff = GC_PAIR_BACKOFF_MIN;
+            pair_schedule(gc);
         }
     } else if(!sn_cmps(ok_reg, error)) {
-        gc_force_stop();
+        gc_force_stop(gc);
     }
 }
 
@@ -293,6 +465,11 @@ static void callback_data(struct gc_s *gc, const void *buffer, const int nbuffer
 {
     struct proto_s p;
     sn src = { .s = (char *)buffer + 4, .n = nbuffer - 4 };
+    gc_loop_watch(gc);
+
+    // Payloads delivered locally are timed from here
+    gc->metrics.decoded = gc_metrics_now();
+
     if(gc_deserialize(&p, &src) != 0) {
         hm_log(LOG_ERR, &gc->log, "Parsing failed");
         return;
@@ -301,6 +478,8 @@ static void callback_data(struct gc_s *gc, const void *buffer, const int nbuffer
     hm_log(LOG_TRACE, &gc->log, "Received packet from upstream type: %d size: %d",
                                 p.type, nbuffer);
 
+    gc->metrics.upstream_frames_in++;
+
     switch(p.type) {
         case ACCOUNT_LOGIN_REPLY:
             if(gc->callback.login)
@@ -344,6 +523,11 @@ static void callback_data(struct gc_s *gc, const void *buffer, const int nbuffer
                     sn_set(pair.type, p.u.device_pair_reply.type);
                     device_pair_reply(gc, &pair);
                 }
+
+                pair_done(gc);
+            } else {
+                hm_log(LOG_TRACE, &gc->log, "Pair failed: %.*s", sn_p(p.u.device_pair_reply.error));
+                pair_schedule(gc);
             }
             }
         break;
@@ -363,17 +547,17 @@ static void callback_data(struct gc_s *gc, const void *buffer, const int nbuffer
                 parse_traffic(gc,
                               p.u.traffic_get_reply.error,
                               p.u.traffic_get_reply.list);
-                gc_force_stop();
+                gc_force_stop(gc);
             }
         break;
         case ACCOUNT_SET_REPLY: {
                 if(gc->callback.account_set) gc->callback.account_set(gc, p.u.account_set_reply.error);
-                gc_force_stop();
+                gc_force_stop(gc);
             }
         break;
         case ACCOUNT_EXISTS_REPLY: {
                 if(gc->callback.account_exists) gc->callback.account_exists(gc, p.u.account_exists_reply.error);
-                gc_force_stop();
+                gc_force_stop(gc);
             }
         break;
         default:
@@ -386,9 +570,12 @@ static void upstream_connect(struct ev_loop *loop, struct ev_timer *timer, int r
 {
     struct gc_s *gc;
     gc = (struct gc_s *)timer->data;
+    gc_loop_watch(gc);
 
     ev_timer_stop(loop, &gc->connect_timer);
 
+    gc->metrics.upstream_connects++;
+
     memset(&gc->client, 0, sizeof(gc->client));
 
     gc->client.base.loop = loop;
@@ -400,6 +587,7 @@ static void upstream_connect(struct ev_loop *loop, struct ev_timer *timer, int r
 
     gc->client.callback.data  = callback_data;
     gc->client.callback.error = callback_error;
+    gc->client.callback.drained = gc_packet_flush;
 
     async_client_ssl(gc);
     (void )revents;
@@ -408,7 +596,12 @@ static void upstream_connect(struct ev_loop *loop, struct ev_timer *timer, int r
 void gc_deinit(struct gc_s *gc)
 {
     if(gc->net.buf.s) hm_pfree(gc->pool, gc->net.buf.s);
+    if(gc->batch.buf.s) hm_pfree(gc->pool, gc->batch.buf.s);
+    gc_metrics_free(gc);
+    gc_registry_free(gc->pool, &gc->streams);
 
+    hm_log_trace_close(&gc->log);
+    hm_log_async_stop(&gc->log);
     hm_log_close(&gc->log);
 
     FIPS_mode_set(0);
@@ -429,13 +622,82 @@ void gc_deinit(struct gc_s *gc)
     ev_default_destroy();
 }
 
-static void sigh_terminate(int __attribute__ ((unused)) signo)
+static const struct hm_allocator_s *ssl_allocator = NULL;
+
+#if (OPENSSL_VERSION_NUMBER <= 0x100020ffL)
+static void *ssl_alloc(size_t size)
+{
+    return ssl_allocator->alloc(ssl_allocator->ctx, size);
+}
+
+static void *ssl_realloc(void *ptr, size_t size)
+{
+    return ssl_allocator->realloc(ssl_allocator->ctx, ptr, size);
+}
+
+static void ssl_free(void *ptr)
+{
+    ssl_allocator->free(ssl_allocator->ctx, ptr);
+}
+#else
+static void *ssl_alloc(size_t size, const char __attribute__ ((unused)) *file,
+                       int __attribute__ ((unused)) line)
+{
+    return ssl_allocator->alloc(ssl_allocator->ctx, size);
+}
+
+static void *ssl_realloc(void *ptr, size_t size, const char __attribute__ ((unused)) *file,
+                         int __attribute__ ((unused)) line)
+{
+    return ssl_allocator->realloc(ssl_allocator->ctx, ptr, size);
+}
+
+static void ssl_free(void *ptr, const char __attribute__ ((unused)) *file,
+                     int __attribute__ ((unused)) line)
+{
+    ssl_allocator->free(ssl_allocator->ctx, ptr);
+}
+#endif
+
+/**
+ * @brief Route OpenSSL allocations through embedder's allocator.
+ *
+ * OpenSSL only accepts new functions before its first allocation,
+ * they stay in place for the rest of the process.
+ *
+ * @param allocator Allocator.
+ * @return GC_OK on success, GC_ERROR if OpenSSL already allocated memory.
+ */
+static int ssl_allocator_set(const struct hm_allocator_s *allocator)
 {
-    if(gc_sigterm == 1) return;
+    if(ssl_allocator == allocator) {
+        return GC_OK;
+    }
+
+    if(ssl_allocator != NULL) {
+        return GC_ERROR;
+    }
+
+    ssl_allocator = allocator;
+
+    if(CRYPTO_set_mem_functions(ssl_alloc, ssl_realloc, ssl_free) == 0) {
+        ssl_allocator = NULL;
+        return GC_ERROR;
+    }
+
+    return GC_OK;
+}
+
+static void sigh_terminate(struct ev_loop *loop, struct ev_signal *w, int revents)
+{
+    struct gc_s *gc = (struct gc_s *)w->data;
+
+    (void )loop;
+    (void )revents;
 
     gc_sigterm = 1;
-    hm_log(LOG_TRACE, &gclocal->log, "Received SIGTERM");
-    ev_timer_again(gclocal->loop, &gclocal->shutdown_timer);
+    hm_log(LOG_TRACE, &gc->log, "Received SIGTERM");
+    ev_timer_again(gc->loop, &gc->shutdown_timer);
 }
 
 static void gc_signals(struct gc_s *gc)
@@ -450,18 +712,14 @@ static void gc_signals(struct gc_s *gc)
         hm_log(LOG_CRIT, &gc->log, "Sigaction cannot be examined");
     }
 
-    act.sa_flags = SA_NOCLDSTOP;
+    // Delivered through the loop, so every instance on it is stopped
+    ev_signal_init(&gc->term_signal[0], sigh_terminate, SIGINT);
+    ev_signal_init(&gc->term_signal[1], sigh_terminate, SIGTERM);
 
-    act.sa_flags = 0;
-    act.sa_handler = sigh_terminate;
-    if(sigaction(SIGINT, &act, NULL) < 0) {
-        hm_log(LOG_CRIT, &gc->log, "Unable to register SIGINT signal handler: %s", strerror(errno));
-        exit(1);
-    }
-
-    if(sigaction(SIGTERM, &act, NULL) < 0) {
-        hm_log(LOG_CRIT, &gc->log, "Unable to register SIGTERM signal handler: %s", strerror(errno));
-        exit(1);
+    int i, nsignals = COUNT(gc->term_signal);
+    for(i = 0; i < nsignals; i++) {
+        gc->term_signal[i].data = gc;
+        ev_signal_start(gc->loop, &gc->term_signal[i]);
     }
 }
 
@@ -513,6 +771,8 @@ static int config_required(struct gc_config_s *cfg)
 }
 
 static void stop(struct ev_loop *loop, struct ev_timer *timer, int revents);
+static void reload_signal(struct ev_loop *loop, struct ev_signal *w, int revents);
+static void log_clock(struct ev_loop *loop, struct ev_check *w, int revents);
 
 struct gc_s *gc_init(struct gc_init_s *init)
 {
@@ -520,13 +780,13 @@ struct gc_s *gc_init(struct gc_init_s *init)
 
     assert(init);
 
-    struct hm_pool_s *pool = hm_create_pool();
+    struct hm_pool_s *pool = hm_create_pool_allocator(init->allocator);
 
     if(pool == NULL) {
         return NULL;
     }
 
-    gc = gclocal = hm_palloc(pool, sizeof(*gc));
+    gc = hm_palloc(pool, sizeof(*gc));
     memset(gc, 0, sizeof(*gc));
 
     if(hm_log_open(&gc->log, init->logfile, init->loglevel) != GC_OK) {
@@ -535,9 +795,29 @@ struct gc_s *gc_init(struct gc_init_s *init)
 
     pool->log = &gc->log;
 
+    if(init->logasync > 0 &&
+       hm_log_async_start(&gc->log, init->logasync, init->logoverflow) != GC_OK) {
+        hm_log(LOG_WARNING, &gc->log, "Could not start asynchronous log, logging synchronously");
+    }
+
+    if(init->tracefile &&
+       hm_log_trace_open(&gc->log, init->tracefile, init->tracesize, LOG_TRACE) != GC_OK) {
+        hm_log(LOG_WARNING, &gc->log, "Could not open trace file [%s]", init->tracefile);
+    }
+
+    // Must precede curl and SSL initialization, both allocate through OpenSSL
+    if(init->allocator && init->allocssl &&
+       ssl_allocator_set(init->allocator) != GC_OK) {
+        hm_log(LOG_WARNING, &gc->log, "OpenSSL already allocated memory, it keeps its own allocator");
+    }
+
     // Set memory pool
     gc->pool = pool;
 
+    if(gc_registry_init(gc->pool, &gc->streams) != GC_OK) {
+        return NULL;
+    }
+
     hm_log(LOG_DEBUG, &gc->log, "Openssl version: 0x%lx", OPENSSL_VERSION_NUMBER);
     hm_log(LOG_DEBUG, &gc->log, "Json-c version: %s",     JSON_C_VERSION);
     hm_log(LOG_DEBUG, &gc->log, "Libev version: %d.%d",   EV_VERSION_MAJOR,
@@ -586,6 +866,30 @@ struct gc_s *gc_init(struct gc_init_s *init)
     gc->connect_timer.data = gc;
     ev_timer_again(gc->loop, &gc->connect_timer);
 
+    // Started after login, see client_logged()
+    ev_init(&gc->config.pair_timer, pair_retry);
+    gc->config.pair_timer.data = gc;
+    gc->config.pair_backoff = GC_PAIR_BACKOFF_MIN;
+
+    // Reload configuration on SIGHUP
+    ev_signal_init(&gc->reload_signal, reload_signal, SIGHUP);
+    gc->reload_signal.data = gc;
+    ev_signal_start(gc->loop, &gc->reload_signal);
+
+    // Timestamp log messages once per loop iteration
+    ev_check_init(&gc->log_clock, log_clock);
+    gc->log_clock.data = gc;
+    ev_check_start(gc->loop, &gc->log_clock);
+    hm_log_clock(&gc->log, ev_now(gc->loop));
+
+    // Loop lag and slow callbacks
+    gc_loop_stats_start(gc, init->slowcallback);
+
+    if(init->adminport && gc_metrics_admin_start(gc, init->adminport) != GC_OK) {
+        hm_log(LOG_WARNING, &gc->log, "Metrics listener on port %d couldn't be opened",
+                                      init->adminport);
+    }
+
     ev_init(&gc->shutdown_timer, stop);
     gc->shutdown_timer.repeat = 0.1;
     gc->shutdown_timer.data = gc;
@@ -598,29 +902,203 @@ struct gc_s *gc_init(struct gc_init_s *init)
     return gc;
 }
 
-static void gc_config_free(struct hm_pool_s *pool, struct gc_config_s *cfg)
+/*
+ * Release everything gc_config_parse() creates.
+ */
+static void config_file_free(struct hm_pool_s *pool, struct gc_config_s *cfg)
 {
-    ev_timer_stop(gclocal->loop, &cfg->pair_timer);
-    json_object_put(cfg->jobj);
+    if(cfg->jobj) json_object_put(cfg->jobj);
+    gc_policy_free(pool, &cfg->policy);
+    if(cfg->tunnels_index) ht_free(cfg->tunnels_index, pool);
+    if(cfg->tunnels) hm_pfree(pool, cfg->tunnels);
+    if(cfg->keepalive) hm_pfree(pool, cfg->keepalive);
+    if(cfg->content) hm_pfree(pool, cfg->content);
+}
+
+static void gc_config_free(struct gc_s *gc)
+{
+    struct hm_pool_s *pool = gc->pool;
+    struct gc_config_s *cfg = &gc->config;
+
+    ev_timer_stop(gc->loop, &cfg->pair_timer);
+    config_file_free(pool, cfg);
     json_object_put(cfg->backends.jobj);
-    hm_pfree(pool, cfg->content);
+    if(cfg->backends.item) hm_pfree(pool, cfg->backends.item);
     hm_pfree(pool, cfg->backends.content);
 }
 
+/*
+ * Exchange everything gc_config_parse() creates, runtime state
+ * such as pair timer and backends stays where it is.
+ */
+static void config_file_swap(struct gc_config_s *a, struct gc_config_s *b)
+{
+#define SWAP(m_field)\
+    do {\
+        __typeof__(a->m_field) tmp = a->m_field;\
+        a->m_field = b->m_field;\
+        b->m_field = tmp;\
+    } while(0)
+
+    SWAP(username);
+    SWAP(password);
+    SWAP(device);
+    SWAP(action);
+    SWAP(batch);
+    SWAP(nallowed);
+    SWAP(policy);
+    SWAP(nkeepalive);
+    SWAP(keepalive);
+    SWAP(ntunnels);
+    SWAP(tunnels);
+    SWAP(tunnels_index);
+    SWAP(type);
+    SWAP(jobj);
+    SWAP(content);
+
+#undef SWAP
+}
+
+/*
+ * Carry tunnels present in both configurations over to @p next,
+ * close listeners of removed ones.
+ */
+static int tunnels_diff(struct gc_s *gc, struct gc_config_s *next)
+{
+    int i, kept = 0;
+
+    for(i = 0; i < gc->config.ntunnels; i++) {
+        struct gc_config_tunnel_s *t = &gc->config.tunnels[i];
+
+        sn_itoa(port,       t->port,              8);
+        sn_itoa(port_local, t->port_local_config, 8);
+
+        struct gc_config_tunnel_s *n = gc_config_tunnel_find(next, t->cloud, t->device,
+                                                             port, port_local);
+        if(n && n->codec == t->codec) {
+            // Listener stays, keep pairing and local port chosen by OS
+            n->pid     = t->pid;
+            n->pairing = t->pairing;
+            if(n->port_local != t->port_local &&
+               gc_config_tunnel_port_local(gc->pool, next, n, t->port_local) != GC_OK) {
+                hm_log(LOG_WARNING, &gc->log, "Tunnel with local port %d couldn't be indexed",
+                                              t->port_local);
+            }
+            kept++;
+            continue;
+        }
+
+        hm_log(LOG_DEBUG, &gc->log, "Tunnel [cloud:device:port:port_local] [%.*s:%.*s:%d:%d] removed",
+                                    sn_p(t->cloud), sn_p(t->device),
+                                    t->port, t->port_local);
+
+        // Unpaired tunnel has no listener yet
+        if(sn_len(t->pid) == 0) continue;
+
+        sn_itoa(port_current, t->port_local, 8);
+        gc_tunnel_remove(gc, t->cloud, t->device, port, port_current);
+    }
+
+    return kept;
+}
+
+int gc_reload(struct gc_s *gc)
+{
+    struct gc_config_s *next;
+
+    hm_log(LOG_INFO, &gc->log, "Reloading config file [%s]", gc->config.file);
+
+    next = hm_palloc(gc->pool, sizeof(*next));
+    if(!next) return GC_ERROR;
+
+    memset(next, 0, sizeof(*next));
+    next->log = &gc->log;
+
+    if(gc_config_parse(gc->pool, next, gc->config.file) != GC_OK ||
+       config_required(next) != GC_OK) {
+        hm_log(LOG_ERR, &gc->log, "Config file [%s] is invalid, keeping current configuration",
+                                  gc->config.file);
+        config_file_free(gc->pool, next);
+        hm_pfree(gc->pool, next);
+        return GC_ERROR;
+    }
+
+    if(!sn_cmps(gc->config.username, next->username) ||
+       !sn_cmps(gc->config.password, next->password) ||
+       !sn_cmps(gc->config.device,   next->device)) {
+        hm_log(LOG_WARNING, &gc->log, "Credentials changed, they take effect on next login");
+    }
+
+    int kept = tunnels_diff(gc, next);
+    int removed = gc->config.ntunnels - kept;
+
+    config_file_swap(&gc->config, next);
+    config_file_free(gc->pool, next);
+    hm_pfree(gc->pool, next);
+
+    if(!gc->config.batch) {
+        gc_packet_flush(gc);
+    }
+
+    gc_connpool_reconfigure(gc);
+
+    hm_log(LOG_INFO, &gc->log, "Config reloaded, tunnels kept: [%d] added: [%d] removed: [%d]",
+                               kept, gc->config.ntunnels - kept, removed);
+
+    gc_config_dump(&gc->config);
+
+    // Pair added tunnels, the rest is paired right after login
+    if(gc->logged && devices_pair(gc, 0) > 0) {
+        gc->config.pair_backoff = GC_PAIR_BACKOFF_MIN;
+        pair_schedule(gc);
+    }
+
+    return GC_OK;
+}
+
+static void reload_signal(struct ev_loop *loop, struct ev_signal *w, int revents)
+{
+    (void )loop;
+    (void )revents;
+
+    struct gc_s *gc = (struct gc_s *)w->data;
+    gc_loop_watch(gc);
+
+    hm_log(LOG_TRACE, &gc->log, "Received SIGHUP");
+
+    gc_reload(gc);
+}
+
+static void log_clock(struct ev_loop *loop, struct ev_check *w, int revents)
+{
+    struct gc_s *gc = (struct gc_s *)w->data;
+
+    hm_log_clock(&gc->log, ev_now(loop));
+    (void )revents;
+}
+
 static void stop(struct ev_loop *loop, struct ev_timer *timer, int revents)
 {
     struct gc_s *gc = (struct gc_s *)timer->data;
 
     ev_timer_stop(gc->loop, &gc->shutdown_timer);
-
+    ev_signal_stop(gc->loop, &gc->reload_signal);
+    ev_signal_stop(gc->loop, &gc->term_signal[0]);
+    ev_signal_stop(gc->loop, &gc->term_signal[1]);
+    ev_check_stop(gc->loop, &gc->log_clock);
+    hm_log_clock(&gc->log, 0);
+
+    gc_metrics_admin_stop(gc);
+    gc_loop_stats_stop(gc);
     modules_stop(gc);
-    gc_config_free(gc->pool, &gc->config);
-    gc_upstream_force_stop(gc->loop);
-    gc_tunnel_stop_all(gc->pool, &gc->log);
-    gc_endpoints_stop_all();
+    gc_config_free(gc);
+    gc_upstream_force_stop(gc);
+    gc_tunnel_stop_all(gc);
+    gc_endpoints_stop_all(gc);
+    gc_connpool_free_all(gc);
 }
 
-void gc_force_stop()
+void gc_force_stop(struct gc_s *gc)
 {
-    ev_timer_again(gclocal->loop, &gclocal->shutdown_timer);
+    ev_timer_again(gc->loop, &gc->shutdown_timer);
 }
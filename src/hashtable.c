@@ -19,186 +19,356 @@
  */
 #include <gc.h>
 
-struct ht_s **ht_init(struct hm_pool_s *pool)
+static struct ht_s ht_deleted;
+#define HT_DELETED (&ht_deleted)
+
+static unsigned int ht_seed(struct ht_table_s *ht)
 {
-    struct ht_s **ht;
+    static unsigned int seed = 0;
 
-    ht = hm_palloc(pool, sizeof(void *) * HT_MAX);
-    if(ht == NULL) {
-        return NULL;
+    if(seed == 0) {
+        seed = (unsigned int)time(NULL) ^ ((unsigned int)getpid() << 16);
     }
 
-    memset(ht, 0, sizeof(void *) * HT_MAX);
+    // Tables don't share seed, collisions found in one are useless in other
+    seed = seed * 1103515245 + 12345;
 
-    return ht;
+    return seed ^ (unsigned int)(uintptr_t)ht;
 }
 
-void ht_free(struct ht_s **ht, struct hm_pool_s *pool)
-{
-    hm_pfree(pool, ht);
-}
-
-inline static void ht_key(int *dst, const char *key, const int nkey)
+static inline unsigned int ht_hash(unsigned int seed, const char *key, const int nkey)
 {
+    // FNV-1a
+    unsigned int h = 2166136261U ^ seed;
     int i;
 
     for(i = 0; i < nkey; i++) {
-        *dst += key[i];
+        h ^= (unsigned char)key[i];
+        h *= 16777619U;
     }
 
-    *dst %= HT_MAX;
+    return h;
 }
 
-int ht_add(struct ht_s **ht, const char *key, const int nkey, const void *value, const int nvalue, const int alloc, struct hm_pool_s *pool)
+static struct ht_slot_s *ht_slots(struct hm_pool_s *pool, unsigned int size)
 {
-    struct ht_s *h;
-    int index = 0;
+    struct ht_slot_s *slots = hm_palloc(pool, sizeof(*slots) * size);
+    if(slots == NULL) {
+        return NULL;
+    }
 
-    assert(ht);
+    memset(slots, 0, sizeof(*slots) * size);
+
+    return slots;
+}
 
-    ht_key(&index, key, nkey);
-
-    for(h = ht[index]; h != NULL; h = h->next) {
-        if(nkey == h->nk && memcmp(key, h->k, nkey) == 0) {
-            /** first, free existing value */
-            if(h->flag == HT_ALLOC) {
-                hm_pfree(pool, h->s);
-            }
-
-            /** then copy new value */
-            if(alloc == HT_ALLOC) {
-                h->s = hm_palloc(pool, nvalue);
-                if(h->s == NULL) {
-                    return -1;
-                }
-#ifdef POOL_STDLIB
-                memcpy(h->s, value, nvalue);
-#else
-                memcpy(h->s, value, nvalue);
-#endif
-            } else {
-                h->s = (void *)value;
-            }
-
-            h->flag = alloc;
-            h->n = nvalue;
-
-            return 0;
+static struct ht_slot_s *ht_find(struct ht_slot_s *slots, unsigned int size,
+                                 unsigned int hash, const char *key, const int nkey)
+{
+    unsigned int mask = size - 1;
+    unsigned int i;
+
+    for(i = hash & mask; slots[i].e != NULL; i = (i + 1) & mask) {
+        struct ht_s *e = slots[i].e;
+        if(e != HT_DELETED && slots[i].hash == hash &&
+           e->nk == nkey && memcmp(e->k, key, nkey) == 0) {
+            return &slots[i];
         }
     }
 
-    h = hm_palloc(pool, sizeof(*h));
-    if(h == NULL) {
-        return -1;
+    return NULL;
+}
+
+static void ht_insert(struct ht_slot_s *slots, unsigned int size, struct ht_s *e)
+{
+    unsigned int mask = size - 1;
+    unsigned int i;
+
+    // Table is never full, there's always an empty slot
+    for(i = e->hash & mask; slots[i].e != NULL && slots[i].e != HT_DELETED;
+        i = (i + 1) & mask);
+
+    slots[i].hash = e->hash;
+    slots[i].e    = e;
+}
+
+static void ht_migrate(struct ht_table_s *ht, unsigned int n, struct hm_pool_s *pool)
+{
+    if(ht->old == NULL) return;
+
+    for(; n > 0 && ht->old_pos < ht->old_size; n--, ht->old_pos++) {
+        struct ht_s *e = ht->old[ht->old_pos].e;
+        if(e == NULL || e == HT_DELETED) continue;
+
+        ht_insert(ht->slots, ht->size, e);
+        ht->used++;
+
+        // Keep probe sequences of old table intact for lookups
+        ht->old[ht->old_pos].e = HT_DELETED;
+    }
+
+    if(ht->old_pos == ht->old_size) {
+        hm_pfree(pool, ht->old);
+        ht->old = NULL;
+        ht->old_size = 0;
+        ht->old_pos = 0;
     }
+}
+
+static int ht_grow(struct ht_table_s *ht, struct hm_pool_s *pool)
+{
+    // Previous resize has to be finished first
+    ht_migrate(ht, ht->old_size, pool);
 
-    h->nk = nkey;
-    h->k = hm_palloc(pool, nkey);
-    if(h->k == NULL) {
+    // Same size is enough if table is full of deleted slots
+    unsigned int size = ht->count * 2 >= ht->size ? ht->size * 2 : ht->size;
+
+    struct ht_slot_s *slots = ht_slots(pool, size);
+    if(slots == NULL) {
         return -1;
     }
 
-    h->n = nvalue;
+    ht->old      = ht->slots;
+    ht->old_size = ht->size;
+    ht->old_pos  = 0;
 
-    /* always allocate a key */
-#ifdef POOL_STDLIB
-    memcpy(h->k, key, nkey);
-#else
-    memcpy(h->k, key, nkey);
-#endif
+    ht->slots = slots;
+    ht->size  = size;
+    ht->used  = 0;
+
+    return 0;
+}
+
+static struct ht_slot_s *ht_lookup(struct ht_table_s *ht, unsigned int hash,
+                                   const char *key, const int nkey)
+{
+    struct ht_slot_s *slot;
 
+    slot = ht_find(ht->slots, ht->size, hash, key, nkey);
+    if(slot == NULL && ht->old) {
+        slot = ht_find(ht->old, ht->old_size, hash, key, nkey);
+    }
+
+    return slot;
+}
+
+static int ht_value(struct ht_s *h, const void *value, const int nvalue,
+                    const int alloc, struct hm_pool_s *pool)
+{
     if(alloc == HT_ALLOC) {
-        h->flag = HT_ALLOC;
         h->s = hm_palloc(pool, nvalue);
         if(h->s == NULL) {
             return -1;
         }
-
-#ifdef POOL_STDLIB
         memcpy(h->s, value, nvalue);
-#else
-        memcpy(h->s, value, nvalue);
-#endif
     } else {
-        h->flag = 0;
         h->s = (void *)value;
     }
 
-    h->next = ht[index];
-    ht[index] = h;
+    h->flag = alloc;
+    h->n = nvalue;
 
     return 0;
 }
 
-int ht_rem(struct ht_s **ht, const char *key, const int nkey, struct hm_pool_s *pool)
+static void ht_entry_free(struct ht_s *h, struct hm_pool_s *pool)
 {
-    struct ht_s *h, *prev = NULL;
-    int index = 0;
+    if(h->flag == HT_ALLOC) {
+        hm_pfree(pool, h->s);
+    }
+    if(h->k != h->key) {
+        hm_pfree(pool, h->k);
+    }
 
-    assert(ht);
+    hm_pfree(pool, h);
+}
 
-    ht_key(&index, key, nkey);
+struct ht_table_s *ht_init(struct hm_pool_s *pool)
+{
+    struct ht_table_s *ht;
 
-    for(h = ht[index], prev = NULL; h != NULL; prev = h, h = h->next) {
-        if(nkey == h->nk && memcmp(h->k, key, nkey) == 0) {
-            if(prev == NULL) {
-                ht[index] = h->next;
-            } else {
-                prev->next = h->next;
-            }
+    ht = hm_palloc(pool, sizeof(*ht));
+    if(ht == NULL) {
+        return NULL;
+    }
 
-            if(h->flag == HT_ALLOC) {
-                hm_pfree(pool, h->s);
-            }
-            hm_pfree(pool, h->k);
+    memset(ht, 0, sizeof(*ht));
 
-            hm_pfree(pool, h);
+    ht->size  = HT_INIT;
+    ht->slots = ht_slots(pool, ht->size);
+    if(ht->slots == NULL) {
+        hm_pfree(pool, ht);
+        return NULL;
+    }
+
+    ht->seed = ht_seed(ht);
+
+    return ht;
+}
+
+void ht_free(struct ht_table_s *ht, struct hm_pool_s *pool)
+{
+    unsigned int i;
 
-            ht[index] = NULL;
-            return 0;
+    for(i = 0; i < ht->size; i++) {
+        struct ht_s *e = ht->slots[i].e;
+        if(e != NULL && e != HT_DELETED) ht_entry_free(e, pool);
+    }
+
+    if(ht->old) {
+        for(i = ht->old_pos; i < ht->old_size; i++) {
+            struct ht_s *e = ht->old[i].e;
+            if(e != NULL && e != HT_DELETED) ht_entry_free(e, pool);
         }
+        hm_pfree(pool, ht->old);
     }
 
-    return -1;
+    hm_pfree(pool, ht->slots);
+    hm_pfree(pool, ht);
 }
 
-struct ht_s *ht_get(struct ht_s **ht, const char *key, const int nkey)
+int ht_add(struct ht_table_s *ht, const char *key, const int nkey, const void *value, const int nvalue, const int alloc, struct hm_pool_s *pool)
 {
+    struct ht_slot_s *slot;
     struct ht_s *h;
-    int index = 0;
 
     assert(ht);
 
-    ht_key(&index, key, nkey);
+    ht_migrate(ht, HT_MIGRATE, pool);
+
+    unsigned int hash = ht_hash(ht->seed, key, nkey);
+
+    slot = ht_lookup(ht, hash, key, nkey);
+    if(slot) {
+        h = slot->e;
 
-    if(ht[index]) {
-        /** fast access - only one key exists under ht index */
-        if(ht[index] && ht[index]->next == NULL) {
-            return ht[index];
+        /** first, free existing value */
+        if(h->flag == HT_ALLOC) {
+            hm_pfree(pool, h->s);
         }
 
-        /** otherwise traverse compare against all existing keys */
-        for(h = ht[index]; h != NULL; h = h->next) {
-            if(h->nk == nkey && memcmp(h->k, key, nkey) == 0) {
-                return h;
-            }
+        /** then copy new value */
+        return ht_value(h, value, nvalue, alloc, pool);
+    }
+
+    if((ht->used + 1) * 4 > ht->size * 3) {
+        if(ht_grow(ht, pool) != 0) {
+            return -1;
         }
-        return NULL;
+    }
+
+    h = hm_palloc(pool, sizeof(*h));
+    if(h == NULL) {
+        return -1;
+    }
+
+    h->nk   = nkey;
+    h->hash = hash;
+
+    /* short keys live in entry */
+    if(nkey <= HT_KEY_INLINE) {
+        h->k = h->key;
     } else {
+        h->k = hm_palloc(pool, nkey);
+        if(h->k == NULL) {
+            hm_pfree(pool, h);
+            return -1;
+        }
+    }
+
+    memcpy(h->k, key, nkey);
+
+    if(ht_value(h, value, nvalue, alloc, pool) != 0) {
+        if(h->k != h->key) hm_pfree(pool, h->k);
+        hm_pfree(pool, h);
+        return -1;
+    }
+
+    ht_insert(ht->slots, ht->size, h);
+    ht->used++;
+    ht->count++;
+
+    return 0;
+}
+
+int ht_rem(struct ht_table_s *ht, const char *key, const int nkey, struct hm_pool_s *pool)
+{
+    struct ht_slot_s *slot;
+
+    assert(ht);
+
+    unsigned int hash = ht_hash(ht->seed, key, nkey);
+
+    slot = ht_lookup(ht, hash, key, nkey);
+    if(slot == NULL) {
+        return -1;
+    }
+
+    struct ht_s *h = slot->e;
+
+    // Slot keeps probe sequences of other keys intact
+    slot->e = HT_DELETED;
+    ht->count--;
+
+    ht_entry_free(h, pool);
+
+    ht_migrate(ht, HT_MIGRATE, pool);
+
+    return 0;
+}
+
+struct ht_s *ht_get(struct ht_table_s *ht, const char *key, const int nkey)
+{
+    struct ht_slot_s *slot;
+
+    assert(ht);
+
+    slot = ht_lookup(ht, ht_hash(ht->seed, key, nkey), key, nkey);
+    if(slot == NULL) {
+        return NULL;
+    }
+
+    return slot->e;
+}
+
+struct ht_s *ht_first(struct ht_table_s *ht)
+{
+    unsigned int i;
+
+    assert(ht);
+
+    if(ht->count == 0) {
         return NULL;
     }
+
+    for(i = 0; i < ht->size; i++) {
+        if(ht->slots[i].e != NULL && ht->slots[i].e != HT_DELETED) {
+            return ht->slots[i].e;
+        }
+    }
+
+    for(i = ht->old_pos; ht->old && i < ht->old_size; i++) {
+        if(ht->old[i].e != NULL && ht->old[i].e != HT_DELETED) {
+            return ht->old[i].e;
+        }
+    }
+
+    return NULL;
 }
 
-void ht_dump_index(struct ht_s **ht, const char *key, const int nkey)
+void ht_dump_index(struct ht_table_s *ht, const char *key, const int nkey)
 {
     struct ht_s *h;
-    int index = 0;
 
     assert(ht);
 
-    ht_key(&index, key, nkey);
+    unsigned int hash = ht_hash(ht->seed, key, nkey);
 
-    for(h = ht[index]; h != NULL; h = h->next) {
-        printf("index [%d] with key [%.*s], value [%.*s]\n", index, h->nk, h->k, h->n, h->s);
+    h = ht_get(ht, key, nkey);
+    if(h == NULL) {
+        return;
     }
+
+    printf("index [%u] with key [%.*s], value [%.*s]\n", hash & (ht->size - 1),
+                                                        h->nk, h->k, h->n, h->s);
 }
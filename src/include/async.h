@@ -25,6 +25,7 @@
 #endif
 
 #define GC_DEFAULT_BACKLOG  8
+#define GC_CONNECT_TIMEOUT  10.0    /**< Seconds to wait for backend connect() to complete. */
 
 /**
  * @brief Client flags.
@@ -33,6 +34,7 @@
 enum gcflags_e {
     GC_WANT_SHUTDOWN = (1 << 0),    /**< Client's marked for shutdown. */
     GC_HANDSHAKED    = (1 << 1),    /**< Client already TLS handshaked. */
+    GC_CONNECTING    = (1 << 2),    /**< Client's connect() still in progress. */
 };
 
 /**
@@ -48,6 +50,9 @@ enum gcerr_e {
     GC_WRITE_ERR,           /**< Error writing to socket. */
     GC_PACKETEXPECT_ERR,    /**< Packet length unexpected. */
     GC_SOCKET_ERR,          /**< Generic socket error. */
+    GC_CONNECT_ERR,         /**< Connection refused or unreachable. */
+    GC_CONNECTTIMEOUT_ERR,  /**< Connection not established in time. */
+    GC_STREAMDONE_ERR,      /**< Stream finished in both directions. */
 };
 
 struct gc_gen_client_s;
@@ -67,7 +72,8 @@ struct gc_gen_server_s {
     const char         *host;         /**< Listening hostname. */
     const char         *port;         /**< Listening port. */
 
-    struct ht_s        **clients;     /**< Hashtable of clients. */
+    struct gc_gen_client_s *clients;  /**< Connected clients. */
+    int                nclients;      /**< Number of connected clients. */
 
     struct gc_s        *gc;           /**< GC generic structure. */
 
@@ -75,6 +81,10 @@ struct gc_gen_server_s {
 
     struct {
         void (*data)(struct gc_gen_client_s *data, char *buf, const int len);
+        void (*accept)(struct gc_gen_client_s *client);
+        void (*close)(struct gc_gen_client_s *client);
+        void (*written)(struct gc_gen_client_s *client, int len);
+        int  (*eof)(struct gc_gen_client_s *client);
     } callback;
 };
 
@@ -111,10 +121,21 @@ struct gc_gen_client_s {
     struct gc_client_s     base;        /**< Client template structure. */
 
     struct gc_gen_server_s *parent;     /**< Server parent structure. */
+    struct gc_gen_client_s *prev;       /**< Previous client of parent server or connection pool. */
+    struct gc_gen_client_s *next;       /**< Next client of parent server or connection pool. */
+    ev_tstamp              idle;        /**< Time client was returned to connection pool. */
+
+    struct gc_stream_s     stream;      /**< Tunneled stream carried by this client. */
+
+    struct gc_endpoint_s   *endpoint;   /**< Endpoint owning this client, NULL if none. */
+
+    struct ev_io           ev_w_connect; /**< Connect completion event. */
+    struct ev_timer        ev_t_connect; /**< Connect timeout. */
 
     struct {
         void (*data)(struct gc_gen_client_s *client, char *buf, int len);
         void (*error)(struct gc_gen_client_s *client, enum gcerr_e error);
+        void (*written)(struct gc_gen_client_s *client, int len);
     } callback;
 };
 
@@ -141,6 +162,7 @@ struct gc_gen_client_ssl_s {
         void (*error)(struct gc_gen_client_ssl_s *client, enum gcerr_e error);
         void (*terminate)(struct gc_gen_client_ssl_s *client, int error);
         void (*connected)(struct gc_gen_client_ssl_s *client);
+        void (*drained)(struct gc_s *gc);
     } callback;
 };
 
@@ -166,6 +188,9 @@ void async_server_shutdown(struct gc_gen_server_s *cs);
 /**
  * @brief Initialize generic client.
  *
+ * Connect completes asynchronously; data queued before that stays in the
+ * send buffer. Failed or timed out connect is reported through error callback.
+ *
  * @param cs Generic client structure.
  * @return GC_OK on success, GC_ERROR on failure.
  */
@@ -223,4 +248,17 @@ void gc_ssl_ev_send(struct gc_gen_client_ssl_s *client, char *buf, const int len
  */
 void gc_gen_ev_send(struct gc_gen_client_s *client, char *buf, const int len);
 
+/**
+ * @brief Forward payload of last upstream packet to tunnel or endpoint.
+ *
+ * Large payloads are sent straight from upstream receive buffer,
+ * payloads of batched messages are always copied.
+ *
+ * @param gc GC structure.
+ * @param client Generic client.
+ * @param body Payload pointing into last received upstream packet.
+ * @return void.
+ */
+void gc_packet_forward(struct gc_s *gc, struct gc_gen_client_s *client, sn body);
+
 #endif
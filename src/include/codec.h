@@ -0,0 +1,141 @@
+/*
+ *
+ * GrizzlyCloud library - simplified VPN alternative for IoT
+ * Copyright (C) 2017 - 2018 Filip Pancik
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef GC_CODEC_H_
+#define GC_CODEC_H_
+
+/**
+ * @brief Payloads smaller than this are never compressed.
+ */
+#define GC_CODEC_MIN_SIZE       128
+
+/**
+ * @brief Upper limit of decompressed payload.
+ */
+#define GC_CODEC_MAX_SIZE       (1024 * 1024)
+
+/**
+ * @brief Compressed size, in percent of original, considered not worth it.
+ */
+#define GC_CODEC_POOR_RATIO     90
+
+/**
+ * @brief Maximum number of payloads sent raw after poor ratio was measured.
+ */
+#define GC_CODEC_MAX_BACKOFF    1024
+
+/**
+ * @brief Payload compression algorithm.
+ *
+ */
+enum gc_codec_e {
+    GC_CODEC_NONE = 0,      /**< Payload sent as is. */
+    GC_CODEC_DEFLATE        /**< Raw deflate (zlib). */
+};
+
+/**
+ * @brief Compression statistics.
+ *
+ */
+struct gc_codec_stats_s {
+    unsigned long long in;          /**< Bytes before compression. */
+    unsigned long long out;         /**< Bytes after compression. */
+    unsigned long long raw;         /**< Bytes sent uncompressed due to poor ratio. */
+    unsigned long long usec;        /**< Time spent compressing and decompressing. */
+};
+
+/**
+ * @brief Compression state of a single stream.
+ *
+ * Every payload is compressed independently, so any of them
+ * may be sent raw without breaking the peer's decompressor.
+ */
+struct gc_codec_s {
+    enum gc_codec_e         type;       /**< Negotiated algorithm. */
+    z_stream                deflate;    /**< Compressor. */
+    z_stream                inflate;    /**< Decompressor. */
+    int                     skip;       /**< Payloads left to send raw. */
+    int                     backoff;    /**< Current skip length after poor ratio. */
+    struct gc_codec_stats_s *stats;     /**< Statistics to update, may be NULL. */
+};
+
+/**
+ * @brief Parse algorithm name.
+ *
+ * @param name Algorithm name as used in config and protocol.
+ * @return Algorithm, GC_CODEC_NONE if unknown.
+ */
+enum gc_codec_e gc_codec_parse(sn name);
+
+/**
+ * @brief Algorithm name.
+ *
+ * @param type Algorithm.
+ * @return Name as used in config and protocol.
+ */
+const char *gc_codec_name(enum gc_codec_e type);
+
+/**
+ * @brief Create compression state.
+ *
+ * @param pool Memory pool.
+ * @param type Algorithm.
+ * @param stats Statistics to update, may be NULL.
+ * @return Compression state, NULL on failure.
+ */
+struct gc_codec_s *gc_codec_new(struct hm_pool_s *pool, enum gc_codec_e type,
+                                struct gc_codec_stats_s *stats);
+
+/**
+ * @brief Release compression state.
+ *
+ * @param pool Memory pool.
+ * @param codec Compression state.
+ * @return void.
+ */
+void gc_codec_free(struct hm_pool_s *pool, struct gc_codec_s *codec);
+
+/**
+ * @brief Compress payload.
+ *
+ * Payload is left as is when it is too small, while backing off after
+ * poor ratio, or when compression doesn't pay off.
+ *
+ * @param pool Memory pool.
+ * @param codec Compression state.
+ * @param src Payload.
+ * @param dst Compressed payload allocated from @p pool.
+ * @return GC_OK if compressed, GC_ERROR if payload should be sent raw.
+ */
+int gc_codec_compress(struct hm_pool_s *pool, struct gc_codec_s *codec,
+                      sn src, sn *dst);
+
+/**
+ * @brief Decompress payload.
+ *
+ * @param pool Memory pool.
+ * @param codec Compression state.
+ * @param src Compressed payload.
+ * @param dst Payload allocated from @p pool.
+ * @return GC_OK on success, GC_ERROR on failure.
+ */
+int gc_codec_decompress(struct hm_pool_s *pool, struct gc_codec_s *codec,
+                        sn src, sn *dst);
+
+#endif
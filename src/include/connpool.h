@@ -0,0 +1,105 @@
+/*
+ *
+ * GrizzlyCloud library - simplified VPN alternative for IoT
+ * Copyright (C) 2017 - 2018 Filip Pancik
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef GC_CONNPOOL_H_
+#define GC_CONNPOOL_H_
+
+/**
+ * @brief Default number of idle backend connections kept per port.
+ */
+#define GC_CONNPOOL_IDLE        8
+
+/**
+ * @brief Default number of seconds idle backend connection is kept.
+ */
+#define GC_CONNPOOL_TIMEOUT     30
+
+/**
+ * @brief Pool of idle keep-alive connections to one backend port.
+ *
+ * Endpoint checks connection out when stream opens and returns it
+ * once remote tunnel closes the stream. Connection is reused only if
+ * nothing is left to be written and backend neither closed it nor
+ * sent anything while it was idle. Suitable for request/response
+ * backends such as HTTP servers with keep-alive.
+ */
+struct gc_connpool_s {
+    int                     port;       /**< Backend port. */
+    int                     max_idle;   /**< Maximum idle connections. */
+    int                     timeout;    /**< Seconds idle connection is kept. */
+
+    int                     nidle;      /**< Number of idle connections. */
+    struct gc_gen_client_s  *idle;      /**< Idle connections, most recent first. */
+
+    unsigned long long      hits;       /**< Streams served by pooled connection. */
+    unsigned long long      misses;     /**< Streams that needed a new connection. */
+
+    struct ev_timer         timer;      /**< Expiry of idle connections. */
+    struct gc_s             *gc;        /**< GC structure. */
+
+    struct gc_connpool_s    *next;      /**< Next pool in linked list. */
+};
+
+/**
+ * @brief Check out idle connection to backend port.
+ *
+ * @param gc GC structure.
+ * @param port Backend port.
+ * @return Connected client with stopped watchers, NULL if pooling is
+ *         disabled for the port or no healthy connection is idle.
+ */
+struct gc_gen_client_s *gc_connpool_get(struct gc_s *gc, int port);
+
+/**
+ * @brief Check whether connections to backend port are pooled.
+ *
+ * @param gc GC structure.
+ * @param port Backend port.
+ * @return 1 if port has keepalive configured, 0 otherwise.
+ */
+int gc_connpool_enabled(struct gc_s *gc, int port);
+
+/**
+ * @brief Return connection to pool, clients still connecting are refused.
+ *
+ * @param gc GC structure.
+ * @param client Client no longer owned by any endpoint.
+ * @return GC_OK if client was pooled, GC_ERROR if caller has to close it.
+ */
+int gc_connpool_put(struct gc_s *gc, struct gc_gen_client_s *client);
+
+/**
+ * @brief Apply reloaded keepalive configuration to existing pools.
+ *
+ * Oldest idle connections over the new limit are closed.
+ *
+ * @param gc GC structure.
+ * @return void.
+ */
+void gc_connpool_reconfigure(struct gc_s *gc);
+
+/**
+ * @brief Close all idle connections and free pools.
+ *
+ * @param gc GC structure.
+ * @return void.
+ */
+void gc_connpool_free_all(struct gc_s *gc);
+
+#endif
@@ -24,16 +24,35 @@
  * @brief Endpoint representation.
  *
  * Specifies endpoint along with local tcp client.
+ * Endpoints are indexed by process ID and stream ID of remote tunnel,
+ * and linked together per remote process.
  */
 struct gc_endpoint_s {
-    snb key;                        /**< Key to identify endpoint.*/
-    snb remote_fd;                  /**< Remote file descriptor. */
+    snb key;                        /**< Key to identify endpoint, "<pid>/<stream>".*/
+    snb stream;                     /**< Stream ID assigned by remote tunnel. */
     snb backend_port;               /**< Backend port. */
     snb pid;                        /**< Process ID association. */
 
+    struct gc_codec_stats_s stats;  /**< Compression statistics. */
+    struct gc_metrics_traffic_s *traffic; /**< Counters of backend port. */
+
     struct gc_gen_client_s *client;   /**< TCP client. */
 
-    struct gc_endpoint_s *next;     /**< Next endpoint in linked list. */
+    struct gc_endpoint_peer_s *peer;  /**< Remote process owning the stream. */
+    struct gc_endpoint_s *prev;     /**< Previous endpoint of the same peer. */
+    struct gc_endpoint_s *next;     /**< Next endpoint of the same peer. */
+};
+
+/**
+ * @brief Remote process with open endpoints.
+ *
+ */
+struct gc_endpoint_peer_s {
+    snb pid;                            /**< Process ID. */
+    struct gc_endpoint_s *endpoints;    /**< Endpoints of this process. */
+
+    struct gc_endpoint_peer_s *prev;    /**< Previous peer in linked list. */
+    struct gc_endpoint_peer_s *next;    /**< Next peer in linked list. */
 };
 
 /**
@@ -48,23 +67,76 @@ struct gc_endpoint_s {
 int gc_endpoint_request(struct gc_s *gc, struct proto_s *p, char **argv, int argc);
 
 /**
- * @brief Stop endpoint.
+ * @brief Handle stream open.
+ *
+ * Connect to backend before any payload arrives.
+ *
+ * @param gc GC structure.
+ * @param p Proto message.
+ * @param argv Array of parsed header elements.
+ * @param argv Number of elements in array.
+ * @return GC_OK on success, GC_ERROR on failure.
+ */
+int gc_endpoint_open(struct gc_s *gc, struct proto_s *p, char **argv, int argc);
+
+/**
+ * @brief Handle stream close.
+ *
+ * @param gc GC structure.
+ * @param p Proto message.
+ * @param argv Array of parsed header elements.
+ * @param argv Number of elements in array.
+ * @return GC_OK on success, GC_ERROR on failure.
+ */
+int gc_endpoint_close(struct gc_s *gc, struct proto_s *p, char **argv, int argc);
+
+/**
+ * @brief Handle stream half-close, tunnel client finished sending.
  *
- * @param pool Memory pool.
- * @param log Logging stream.
+ * @param gc GC structure.
+ * @param p Proto message.
+ * @param argv Array of parsed header elements.
+ * @param argv Number of elements in array.
+ * @return GC_OK on success, GC_ERROR on failure.
+ */
+int gc_endpoint_half_close(struct gc_s *gc, struct proto_s *p, char **argv, int argc);
+
+/**
+ * @brief Handle window update granted by remote tunnel.
+ *
+ * @param gc GC structure.
+ * @param p Proto message.
+ * @param argv Array of parsed header elements.
+ * @param argv Number of elements in array.
+ * @return GC_OK on success, GC_ERROR on failure.
+ */
+int gc_endpoint_window(struct gc_s *gc, struct proto_s *p, char **argv, int argc);
+
+/**
+ * @brief Stop all endpoints of remote process.
+ *
+ * @param gc GC structure.
  * @param address Process ID.
  * @param cloud Cloud name.
  * @param device Device name.
  * @return void.
  */
-void gc_endpoint_stop(struct hm_pool_s *pool, struct hm_log_s *log,
-                      sn address, sn cloud, sn device);
+void gc_endpoint_stop(struct gc_s *gc, sn address, sn cloud, sn device);
 
 /**
  * @brief Stop all endpoints.
  *
+ * @param gc GC structure.
+ * @return void.
+ */
+void gc_endpoints_stop_all(struct gc_s *gc);
+
+/**
+ * @brief Refresh queue depth of endpoint counters.
+ *
+ * @param gc GC structure.
  * @return void.
  */
-void gc_endpoints_stop_all();
+void gc_endpoint_metrics(struct gc_s *gc);
 
 #endif
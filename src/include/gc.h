@@ -24,6 +24,7 @@
 #include <sys/types.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netdb.h>
 #include <sys/wait.h>
 #include <netinet/in.h>
@@ -47,8 +48,14 @@
 #include <errno.h>
 #include <time.h>
 #include <math.h>
+#include <signal.h>
+#include <sched.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/mman.h>
 
 #include <json.h>
+#include <zlib.h>
 #include <ev.h>
 #include <openssl/ssl.h>
 #include <openssl/engine.h>
@@ -60,9 +67,15 @@
 #include <proto.h>
 
 #include <backend.h>
+#include <policy.h>
+#include <metrics.h>
 #include <ringbuffer.h>
 #include <hashtable.h>
+#include <registry.h>
+#include <codec.h>
+#include <stream.h>
 #include <async.h>
+#include <connpool.h>
 #include <module.h>
 #include <gcapi.h>
 #include <endpoint.h>
@@ -26,24 +26,19 @@
 #define GC_DEFAULT_PORT         17040
 
 /**
- * @brief Upstream admin port.
+ * @brief Local admin port serving metrics.
  */
 #define GC_ADMIN_PORT           17041
 
 /**
- * @brief Maximum configured tunnels.
+ * @brief Initial delay in seconds before unpaired tunnels are retried.
  */
-#define GC_CFG_MAX_TUNNELS     32
+#define GC_PAIR_BACKOFF_MIN    2.0
 
 /**
- * @brief Maximum allowed ports.
+ * @brief Maximum delay in seconds between pair attempts.
  */
-#define GC_CFG_MAX_ALLOW_PORTS 32
-
-/**
- * @brief Maximum backend nodes.
- */
-#define GC_CFG_MAX_BACKENDS 32
+#define GC_PAIR_BACKOFF_MAX    60.0
 
 /**
  * @brief GC state enum.
@@ -77,7 +72,20 @@ struct gc_config_tunnel_s {
     sn device;               /**< Destination device name. */
     int port;                /**< Destination port. */
     int port_local;          /**< Local port. */
+    int port_local_config;   /**< Local port as configured, 0 if chosen by OS. */
     snb pid;                 /**< Paired process ID. */
+    int pairing;             /**< Pair request sent, no reply received yet. */
+    enum gc_codec_e codec;   /**< Payload compression to offer. */
+};
+
+/**
+ * @brief Backend connection pooling configuration.
+ *
+ */
+struct gc_config_keepalive_s {
+    int port;                /**< Backend port. */
+    int idle;                /**< Maximum idle connections. */
+    int timeout;             /**< Seconds idle connection is kept. */
 };
 
 struct gc_backend_item_s {
@@ -87,7 +95,7 @@ struct gc_backend_item_s {
 
 struct gc_config_backend_s {
     int n;                                              /**< Number of backends. */
-    struct gc_backend_item_s item[GC_CFG_MAX_BACKENDS]; /**< Array of backends. */
+    struct gc_backend_item_s *item;                     /**< Array of backends. */
 
     int compare;                                        /**< Comparisson flag. */
 
@@ -108,12 +116,17 @@ struct gc_config_s {
     sn action;                                          /**< User action. */
 
     int ntunnels;                                       /**< Number of tunnels. */
-    struct gc_config_tunnel_s tunnels[GC_CFG_MAX_TUNNELS];  /**< Array of tunnels. */
+    struct gc_config_tunnel_s *tunnels;                 /**< Array of tunnels. */
+    struct ht_table_s *tunnels_index;                   /**< Tunnels by cloud/device/port/port_local. */
 
-    struct ev_timer pair_timer;                         /**< Pair timer. */
+    struct ev_timer pair_timer;                         /**< Pair retry timer, stopped once all tunnels are paired. */
+    ev_tstamp pair_backoff;                             /**< Delay before next pair retry. */
 
-    int nallowed;                                       /**< Number of allowed ports. */
-    int allowed[GC_CFG_MAX_ALLOW_PORTS];                /**< Array of allowed ports. */
+    int nallowed;                                       /**< Number of allow elements. */
+    struct gc_policy_s policy;                          /**< Compiled access policy of allowed ports. */
+
+    int nkeepalive;                                     /**< Number of ports with pooled connections. */
+    struct gc_config_keepalive_s *keepalive;            /**< Array of pooled ports. */
 
     enum gc_cfg_type_e type;                            /**< Type of configuration. */
 
@@ -124,6 +137,8 @@ struct gc_config_s {
     char *content;                                      /**< File buffer. */
 
     struct gc_config_backend_s backends;                /**< Backend nodes strcuture. */
+
+    int batch;                                          /**< Coalesce small messages while upstream is busy. */
 };
 
 /**
@@ -137,6 +152,7 @@ struct gc_device_pair_s {
     snb port_local;                                     /**< Local port. */
     sn port_remote;                                     /**< Rmote port. */
     sn type;                                            /**< If "forced" entity is being paired. */
+    enum gc_codec_e codec;                              /**< Payload compression to offer. */
 };
 
 /**
@@ -150,8 +166,16 @@ struct gc_init_s {
     const char     *logfile;                            /**< Log file. */
     const char     *backendfile;                        /**< Backends file. */
     enum loglevel_e loglevel;                           /**< Log level. */
+    int            logasync;                            /**< Asynchronous log records, 0 to log synchronously. */
+    enum hm_log_overflow_e logoverflow;                 /**< Asynchronous log overflow policy. */
+    const char     *tracefile;                          /**< Binary trace of messages above log level, NULL if off. */
+    size_t         tracesize;                           /**< Binary trace ring size in bytes. */
     enum gc_module_e module;                            /**< Active modules. */
     int clientterm;                                     /**< Terminate when first client disconnects. */
+    int            adminport;                           /**< Local metrics listener port, 0 disables. */
+    int            slowcallback;                        /**< Log callbacks slower than this in ms, 0 for default. */
+    const struct hm_allocator_s *allocator;             /**< Memory allocator, NULL for stdlib. Json-c and log buffers keep using stdlib. */
+    int            allocssl;                            /**< Route OpenSSL through allocator too, allocator must then outlive process exit. */
 
     struct {
         void (*state_changed)(struct gc_s *gc, enum gc_state_e state);       /**< Upstream socket state cb. */
@@ -179,11 +203,33 @@ struct gc_s {
     struct gc_config_s  config;                         /**< Parsed config. */
     unsigned int        modules;                        /**< Flag of active modules. */
     int                 clientterm;                     /**< Terminate when first client disconnects. */
+    struct gc_registry_s streams;                       /**< Tunnel clients by stream ID. */
+    struct gc_connpool_s *connpools;                    /**< Pools of idle backend connections. */
+    struct ev_signal    reload_signal;                  /**< SIGHUP reloads configuration. */
+    struct ev_signal    term_signal[2];                 /**< SIGINT and SIGTERM stop instance. */
+    struct ev_check     log_clock;                      /**< Caches log timestamp once per loop iteration. */
+    int                 logged;                         /**< Upstream session is logged in. */
+    struct gc_metrics_s metrics;                        /**< Counters served on admin port. */
+    struct gc_tunnel_s  *tunnels;                       /**< Active tunnels. */
+
+    struct {
+        struct ht_table_s         *index;               /**< Endpoints by "<pid>/<stream>". */
+        struct ht_table_s         *peers;               /**< Peers by process ID. */
+        struct gc_endpoint_peer_s *list;                /**< All peers. */
+    } endpoints;
 
     struct {
         sn buf;                                         /**< Network buffer. */
     } net;
 
+    struct {
+        snb to;                                         /**< Destination device of pending batch. */
+        snb address;                                    /**< Destination process ID of pending batch. */
+        sn  buf;                                        /**< Packed messages. */
+        int count;                                      /**< Number of packed messages. */
+        int unpacking;                                  /**< Received batch is being dispatched. */
+    } batch;
+
     struct {
         void (*state_changed)(struct gc_s *gc, enum gc_state_e state);       /**< Upstream socket state cb. */
         void (*login)(struct gc_s *gc, sn error);                            /**< Login callback. */
@@ -208,9 +254,23 @@ void gc_deinit(struct gc_s *gc);
  * @brief Interrupt activity and clean any library related structures.
  *
  * Called after receiving SIGTERM.
+ * @param gc GC structure.
  * @return void.
  */
-void gc_force_stop();
+void gc_force_stop(struct gc_s *gc);
+
+/**
+ * @brief Reload configuration file.
+ *
+ * Applies differences to the running instance without reconnecting
+ * upstream: added tunnels are paired, removed ones are closed and
+ * unchanged ones keep their listeners and clients. Current
+ * configuration stays in place if the file is invalid.
+ *
+ * @param gc GC structure.
+ * @return GC_OK on success, GC_ERROR on failure.
+ */
+int gc_reload(struct gc_s *gc);
 
 extern int gc_sigterm;
 
@@ -20,7 +20,9 @@
 #ifndef GC_HASHTABLE_H_
 #define GC_HASHTABLE_H_
 
-#define HT_MAX          (1<<12)
+#define HT_INIT         16      /**< Initial number of slots, power of 2. */
+#define HT_KEY_INLINE   24      /**< Keys up to this length are stored in entry. */
+#define HT_MIGRATE      8       /**< Slots moved to resized table per operation. */
 #define HT_ALLOC        0x1
 
 #define HT_ADD(ht, key, nkey, value, nvalue, pool) ht_add(ht, key, nkey, value, nvalue, HT_ALLOC, pool)
@@ -35,38 +37,73 @@
     }
 
 /**
- * @brief Hashtable structure.
+ * @brief Hashtable entry.
  *
+ * Entry stays at the same address for its whole life,
+ * pointer returned by ht_get() is valid until the key is removed.
  */
 struct ht_s {
-    char         *k;    /**< Key. */
-    int          nk;    /**< Length of key. */
-    char         *s;    /**< Value. */
-    int          n;     /**< Length of value. */
-    unsigned int flag;  /**< Flags. */
-    struct ht_s  *next; /**< Next hashtable structure in linked list. */
+    char         *k;                    /**< Key. */
+    int          nk;                    /**< Length of key. */
+    char         *s;                    /**< Value. */
+    int          n;                     /**< Length of value. */
+    unsigned int flag;                  /**< Flags. */
+    unsigned int hash;                  /**< Hash of key. */
+    char         key[HT_KEY_INLINE];    /**< Storage for short keys. */
+};
+
+/**
+ * @brief Hashtable slot.
+ *
+ */
+struct ht_slot_s {
+    unsigned int hash;                  /**< Hash of key, compared before key itself. */
+    struct ht_s  *e;                    /**< Entry, NULL if empty. */
+};
+
+/**
+ * @brief Open addressing hashtable with linear probing.
+ *
+ * Table grows incrementally: once it is 3/4 full a table of twice
+ * the size is allocated and every following operation moves
+ * HT_MIGRATE slots of the old table into it. Lookups consult
+ * both tables until the old one is empty.
+ */
+struct ht_table_s {
+    struct ht_slot_s *slots;            /**< Slots. */
+    unsigned int     size;              /**< Number of slots, power of 2. */
+    unsigned int     used;              /**< Live and deleted slots. */
+
+    struct ht_slot_s *old;              /**< Table being migrated, NULL if none. */
+    unsigned int     old_size;          /**< Number of slots of old table. */
+    unsigned int     old_pos;           /**< Next slot of old table to migrate. */
+
+    unsigned int     count;             /**< Number of entries. */
+    unsigned int     seed;              /**< Hash seed. */
 };
 
 /**
  * @brief Initialize hashtable.
  *
  * @param pool Memory pool.
- * @return Memory pool pointer on succes, NULL on failure.
+ * @return Hashtable pointer on succes, NULL on failure.
  */
-struct ht_s **ht_init(struct hm_pool_s *pool);
+struct ht_table_s *ht_init(struct hm_pool_s *pool);
 
 /**
- * @brief Free hashtable.
+ * @brief Free hashtable along with its entries.
  *
  * @param ht Hashtable pointer.
  * @param pool Memory pool.
  * @return void.
  */
-void ht_free(struct ht_s **ht, struct hm_pool_s *pool);
+void ht_free(struct ht_table_s *ht, struct hm_pool_s *pool);
 
 /**
  * @brief Add Key/Value pair to hashtable.
  *
+ * Value of existing key is replaced.
+ *
  * @param ht Hashtable pointer.
  * @param key Key pointer.
  * @param nkey Length of key.
@@ -76,7 +113,7 @@ void ht_free(struct ht_s **ht, struct hm_pool_s *pool);
  * @param pool Memory pool.
  * @return 0 on success, -1 on failure.
  */
-int ht_add(struct ht_s **ht, const char *key, const int nkey,
+int ht_add(struct ht_table_s *ht, const char *key, const int nkey,
            const void *value, const int nvalue, const int alloc,
            struct hm_pool_s *pool);
 
@@ -85,10 +122,11 @@ int ht_add(struct ht_s **ht, const char *key, const int nkey,
  *
  * @param ht Hashtable pointer.
  * @param key Key pointer.
+ * @param nkey Length of key.
  * @param pool Memory pool.
  * @return 0 on success, -1 on failure.
  */
-int ht_rem(struct ht_s **ht, const char *key, const int nkey,
+int ht_rem(struct ht_table_s *ht, const char *key, const int nkey,
            struct hm_pool_s *pool);
 
 /**
@@ -96,19 +134,29 @@ int ht_rem(struct ht_s **ht, const char *key, const int nkey,
  *
  * @param ht Hashtable pointer.
  * @param key Key pointer.
- * @param pool Memory pool.
+ * @param nkey Length of key.
  * @return Pointer to hashtable entry on success, otherwise NULL.
  */
-struct ht_s *ht_get(struct ht_s **ht, const char *key, const int nkey);
+struct ht_s *ht_get(struct ht_table_s *ht, const char *key, const int nkey);
+
+/**
+ * @brief Get any entry of hashtable.
+ *
+ * Useful to drain the table, entry has to be removed before next call.
+ *
+ * @param ht Hashtable pointer.
+ * @return Pointer to hashtable entry, NULL if table is empty.
+ */
+struct ht_s *ht_first(struct ht_table_s *ht);
 
 /**
  * @brief Dump Key/Value pair.
  *
  * @param ht Hashtable pointer.
  * @param key Key pointer.
- * @param pool Memory pool.
+ * @param nkey Length of key.
  * @return void.
  */
-void ht_dump_index(struct ht_s **ht, const char *key, const int nkey);
+void ht_dump_index(struct ht_table_s *ht, const char *key, const int nkey);
 
 #endif
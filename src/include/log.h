@@ -36,6 +36,39 @@ enum loglevel_e {
     LOG_TRACE,
 };
 
+#define HM_LOG_RECORD  1024  /**< Size of asynchronous log record, longer messages are truncated. */
+
+/**
+ * @brief What to do once asynchronous log ring is full.
+ *
+ */
+enum hm_log_overflow_e {
+    HM_LOG_OVERFLOW_DROP = 0,   /**< Drop message and count it. */
+    HM_LOG_OVERFLOW_BLOCK,      /**< Wait until writer thread makes room. */
+};
+
+#define HM_LOG_ARGS    16    /**< Most arguments of message recorded by binary trace. */
+
+struct hm_log_async_s;
+struct hm_log_trace_s;
+
+/**
+ * @brief Log call site.
+ *
+ * Every hm_log() call places one in "hm_log_sites" section, its index
+ * in the section identifies messages of binary trace.
+ */
+struct hm_log_site_s {
+    enum loglevel_e level;                  /**< Log level. */
+    int             line;                   /**< Source line. */
+    const char      *file;                  /**< Source file. */
+    const char      *func;                  /**< Function. */
+    const char      *fmt;                   /**< Format string. */
+    int             nargs;                  /**< Arguments parsed from format, -1 if trace stores text. */
+    char            args[HM_LOG_ARGS];      /**< Argument kinds. */
+    unsigned char   limit[HM_LOG_ARGS];     /**< Precision of string arguments, 0 if none. */
+};
+
 /**
  * @brief Generic log structure.
  *
@@ -46,10 +79,31 @@ struct hm_log_s {
     FILE            *file;    /**< File stream. */
     void            *data;    /**< User data. */
     enum loglevel_e level;    /**< Log level. */
+    enum loglevel_e limit;    /**< Most verbose level recorded by log or binary trace. */
+    struct hm_log_async_s *async; /**< Asynchronous writer, NULL if synchronous. */
+    struct hm_log_trace_s *trace; /**< Binary trace of messages above log level, NULL if off. */
+    char            stamp[64];  /**< Cached timestamp, empty to format it per message. */
 };
 
+/**
+ * Least severe level compiled in, messages above it cost nothing.
+ * Release builds may set it to LOG_DEBUG to remove trace calls.
+ */
+#ifndef HM_LOG_MIN_LEVEL
+#define HM_LOG_MIN_LEVEL LOG_TRACE
+#endif
+
+#define HM_LOG_FMT(m_fmt, m_args...) m_fmt
+
 #define hm_log(t, l, fmt...)\
-    hm_log_impl(t, l, __FILE__, __LINE__, __FUNCTION__, fmt)
+    do {\
+        if((t) <= HM_LOG_MIN_LEVEL && (t) <= (l)->limit) {\
+            static struct hm_log_site_s hm_log_site\
+                __attribute__((section("hm_log_sites"), aligned(8), used)) =\
+                { t, __LINE__, __FILE__, __FUNCTION__, HM_LOG_FMT(fmt), 0, { 0 }, { 0 } };\
+            hm_log_site_impl(&hm_log_site, l, fmt);\
+        }\
+    } while(0)
 
 /**
  * @brief Add log message.
@@ -67,6 +121,20 @@ int hm_log_impl(enum loglevel_e level, struct hm_log_s *log,
                 const char *fmt, ...)
                 __attribute__ ((format (printf, 6, 7)));
 
+/**
+ * @brief Add log message of call site.
+ *
+ * Messages above log level go to binary trace.
+ *
+ * @param site Call site.
+ * @param log Log structure.
+ * @param fmt Varg formatted message.
+ * @return GC_OK on success, GC_ERROR on failure.
+ */
+int hm_log_site_impl(struct hm_log_site_s *site, struct hm_log_s *log,
+                     const char *fmt, ...)
+                     __attribute__ ((format (printf, 3, 4)));
+
 /**
  * @brief Initialize log.
  *
@@ -85,4 +153,69 @@ int hm_log_open(struct hm_log_s *l, const char *filename, enum loglevel_e level)
  */
 int hm_log_close(struct hm_log_s *l);
 
+/**
+ * @brief Cache timestamp of subsequent messages.
+ *
+ * Called once per event loop iteration so that messages
+ * don't have to read and format the clock each.
+ *
+ * @param l Log structure.
+ * @param now Current time, 0 to format timestamp per message again.
+ * @return void.
+ */
+void hm_log_clock(struct hm_log_s *l, double now);
+
+/**
+ * @brief Switch log into asynchronous mode.
+ *
+ * Messages are formatted by caller into lock-free ring of records
+ * and written to file by separate thread in batches.
+ *
+ * @param l Log structure.
+ * @param records Number of records in ring, rounded up to power of 2.
+ * @param overflow Overflow policy.
+ * @return GC_OK on success, GC_ERROR on failure.
+ */
+int hm_log_async_start(struct hm_log_s *l, int records, enum hm_log_overflow_e overflow);
+
+/**
+ * @brief Flush pending records, stop writer thread and switch log back into synchronous mode.
+ *
+ * @param l Log structure.
+ * @return GC_OK on success, GC_ERROR if log was not asynchronous.
+ */
+int hm_log_async_stop(struct hm_log_s *l);
+
+/**
+ * @brief Number of messages dropped since asynchronous mode was started.
+ *
+ * @param l Log structure.
+ * @return Dropped messages.
+ */
+unsigned long long hm_log_dropped(struct hm_log_s *l);
+
+/**
+ * @brief Record messages above log level into binary trace.
+ *
+ * Trace is memory-mapped ring file holding site ids, raw arguments and
+ * monotonic timestamps, oldest records are overwritten. It is written
+ * from event loop thread only and decoded by script/trace/gctrace.py.
+ *
+ * @param l Log structure.
+ * @param filename Trace file.
+ * @param size Ring size in bytes.
+ * @param level Most verbose level recorded.
+ * @return GC_OK on success, GC_ERROR on failure.
+ */
+int hm_log_trace_open(struct hm_log_s *l, const char *filename, size_t size,
+                      enum loglevel_e level);
+
+/**
+ * @brief Stop binary trace and unmap its file.
+ *
+ * @param l Log structure.
+ * @return GC_OK on success, GC_ERROR if trace was not open.
+ */
+int hm_log_trace_close(struct hm_log_s *l);
+
 #endif
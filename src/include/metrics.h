@@ -0,0 +1,306 @@
+/*
+ *
+ * GrizzlyCloud library - simplified VPN alternative for IoT
+ * Copyright (C) 2017 - 2018 Filip Pancik
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef GC_METRICS_H_
+#define GC_METRICS_H_
+
+/**
+ * @brief Admin listener only accepts local connections.
+ */
+#define GC_ADMIN_HOST   "127.0.0.1"
+
+/**
+ * @brief Histogram buckets.
+ *
+ * Every power of two is split into GC_HISTOGRAM_SUB linear buckets,
+ * so any recorded value is reported within 1/GC_HISTOGRAM_SUB of itself.
+ * Values from 2^GC_HISTOGRAM_MAX_BITS ns (~18 minutes) fall into last bucket.
+ */
+#define GC_HISTOGRAM_SUB_BITS   4
+#define GC_HISTOGRAM_SUB        (1 << GC_HISTOGRAM_SUB_BITS)
+#define GC_HISTOGRAM_MAX_BITS   40
+#define GC_HISTOGRAM_BUCKETS    ((GC_HISTOGRAM_MAX_BITS - GC_HISTOGRAM_SUB_BITS + 1) * GC_HISTOGRAM_SUB)
+
+/**
+ * @brief Measured points of tunnel data path.
+ *
+ */
+enum gc_latency_e {
+    GC_LATENCY_LOCAL_RECV = 0,  /**< Local client data received until queued for upstream. */
+    GC_LATENCY_SERIALIZE,       /**< Message serialization into upstream frame. */
+    GC_LATENCY_UPSTREAM_QUEUE,  /**< Frame queued until accepted by SSL_write(). */
+    GC_LATENCY_SSL_WRITE,       /**< Single SSL_write() call. */
+    GC_LATENCY_DELIVER,         /**< Upstream frame decoded until written to local socket. */
+    GC_LATENCY_MAX
+};
+
+/**
+ * @brief Log-bucketed latency histogram.
+ *
+ */
+struct gc_histogram_s {
+    unsigned long long count;                           /**< Recorded values. */
+    unsigned long long sum;                             /**< Sum of recorded values. */
+    unsigned long long max;                             /**< Largest recorded value. */
+    unsigned long long buckets[GC_HISTOGRAM_BUCKETS];   /**< Counts per bucket. */
+};
+
+/**
+ * @brief Default time in ms after which callback is reported as slow.
+ */
+#define GC_LOOP_SLOW_MS         50
+
+/**
+ * @brief Statistics of watched callback site.
+ *
+ * Sites are collected in "gc_loop_sites" section, so all of them
+ * can be reported without registration. Statistics are process-wide.
+ */
+struct gc_loop_site_s {
+    int                line;        /**< Line of watch. */
+    const char         *file;       /**< Source file. */
+    const char         *func;       /**< Callback. */
+    unsigned long long calls;       /**< Invocations. */
+    unsigned long long slow;        /**< Invocations over threshold. */
+    unsigned long long ns;          /**< Total time. */
+    unsigned long long max;         /**< Longest invocation. */
+};
+
+/**
+ * @brief Running invocation of watched callback.
+ *
+ */
+struct gc_loop_call_s {
+    struct gc_s           *gc;      /**< GC structure. */
+    struct gc_loop_site_s *site;    /**< Site of callback. */
+    unsigned long long    start;    /**< Time callback was entered. */
+};
+
+/**
+ * @brief Measure wall time of enclosing callback.
+ *
+ * Place on top of callback body, time is recorded when function returns.
+ * Callbacks slower than threshold are logged along with their site.
+ */
+#define gc_loop_watch(m_gc)\
+    static struct gc_loop_site_s gc_loop_site\
+        __attribute__((section("gc_loop_sites"), aligned(8), used)) =\
+        { __LINE__, __FILE__, __FUNCTION__, 0, 0, 0, 0 };\
+    struct gc_loop_call_s gc_loop_call __attribute__((cleanup(gc_loop_leave))) =\
+        { (m_gc), &gc_loop_site, gc_metrics_now() };\
+    gc_loop_enter(&gc_loop_call)
+
+/**
+ * @brief Event loop responsiveness.
+ *
+ */
+struct gc_loop_stats_s {
+    struct ev_prepare     prepare;      /**< Loop is about to block. */
+    struct ev_check       check;        /**< Loop woke up. */
+    unsigned long long    woke;         /**< Time loop woke up, 0 while blocked. */
+    unsigned long long    slow;         /**< Slow callback threshold in ns. */
+    int                   depth;        /**< Nesting of watched callbacks. */
+    struct gc_histogram_s lag;          /**< Time from wake-up until loop can block again. */
+    struct gc_histogram_s callbacks;    /**< Wall time of outermost watched callbacks. */
+};
+
+/**
+ * @brief Traffic counters of tunnel or endpoint backend port.
+ *
+ * "In" is read from local sockets, "out" is written to them.
+ */
+struct gc_metrics_traffic_s {
+    unsigned long long bytes_in;        /**< Bytes read from local sockets. */
+    unsigned long long bytes_out;       /**< Bytes written to local sockets. */
+    unsigned long long packets_in;      /**< Reads from local sockets. */
+    unsigned long long packets_out;     /**< Writes to local sockets. */
+    unsigned long long accepted;        /**< Connections opened. */
+    unsigned long long active;          /**< Connections open. */
+    unsigned long long queued;          /**< Bytes waiting to be written, refreshed on render. */
+};
+
+/**
+ * @brief Endpoint counters of one backend port.
+ *
+ */
+struct gc_metrics_port_s {
+    int                         port;       /**< Backend port. */
+    struct gc_metrics_traffic_s traffic;    /**< Counters of all endpoints on the port. */
+    struct gc_metrics_port_s    *next;      /**< Next port in linked list. */
+};
+
+/**
+ * @brief Metrics registry.
+ *
+ */
+struct gc_metrics_s {
+    unsigned long long upstream_connects;       /**< Upstream connection attempts. */
+    unsigned long long upstream_disconnects;    /**< Upstream connections lost. */
+    unsigned long long upstream_bytes_in;       /**< Bytes read from upstream. */
+    unsigned long long upstream_bytes_out;      /**< Bytes written to upstream. */
+    unsigned long long upstream_frames_in;      /**< Frames received from upstream. */
+    unsigned long long upstream_frames_out;     /**< Frames queued for upstream. */
+
+    struct gc_metrics_port_s *endpoints;        /**< Endpoint counters by backend port. */
+
+    struct gc_histogram_s    latency[GC_LATENCY_MAX];   /**< Latency in ns per measured point. */
+    unsigned long long       decoded;           /**< Time last upstream frame was decoded. */
+    struct gc_loop_stats_s   loop;              /**< Event loop lag and callback times. */
+
+    struct gc_gen_server_s   *admin;            /**< Admin listener, NULL if disabled. */
+    char                     admin_port[8];     /**< Admin listener port. */
+};
+
+/**
+ * @brief Growing text buffer metrics are rendered into.
+ *
+ */
+struct gc_metrics_out_s {
+    struct hm_pool_s *pool;     /**< Memory pool. */
+    char             *s;        /**< Text. */
+    int              n;         /**< Length of text. */
+    int              size;      /**< Allocated size. */
+};
+
+/**
+ * @brief Monotonic time in nanoseconds.
+ *
+ * @return Time.
+ */
+unsigned long long gc_metrics_now();
+
+/**
+ * @brief Record value into histogram.
+ *
+ * @param h Histogram.
+ * @param value Value, ns for latencies.
+ * @return void.
+ */
+void gc_histogram_record(struct gc_histogram_s *h, unsigned long long value);
+
+/**
+ * @brief Value below which given share of recorded values falls.
+ *
+ * @param h Histogram.
+ * @param p Percentile, 0.0 - 100.0.
+ * @return Highest value of matching bucket, 0 if histogram is empty.
+ */
+unsigned long long gc_histogram_percentile(const struct gc_histogram_s *h, double p);
+
+/**
+ * @brief Start measuring event loop lag.
+ *
+ * @param gc GC structure.
+ * @param slow Threshold in ms after which callback is logged, 0 for default.
+ * @return void.
+ */
+void gc_loop_stats_start(struct gc_s *gc, int slow);
+
+/**
+ * @brief Stop measuring event loop lag.
+ *
+ * @param gc GC structure.
+ * @return void.
+ */
+void gc_loop_stats_stop(struct gc_s *gc);
+
+/**
+ * @brief Mark watched callback as entered, see gc_loop_watch().
+ *
+ * @param call Callback invocation.
+ * @return void.
+ */
+void gc_loop_enter(struct gc_loop_call_s *call);
+
+/**
+ * @brief Record watched callback time, see gc_loop_watch().
+ *
+ * @param call Callback invocation.
+ * @return void.
+ */
+void gc_loop_leave(struct gc_loop_call_s *call);
+
+/**
+ * @brief Get endpoint counters of backend port, create them if needed.
+ *
+ * @param gc GC structure.
+ * @param port Backend port.
+ * @return Counters on success, NULL on failure.
+ */
+struct gc_metrics_traffic_s *gc_metrics_endpoint(struct gc_s *gc, int port);
+
+/**
+ * @brief Append formatted text.
+ *
+ * @param o Output buffer.
+ * @param fmt Varg formatted text.
+ * @return GC_OK on success, GC_ERROR on failure.
+ */
+int gc_metrics_printf(struct gc_metrics_out_s *o, const char *fmt, ...)
+                      __attribute__ ((format (printf, 2, 3)));
+
+/**
+ * @brief Render all metrics in Prometheus text format.
+ *
+ * @param gc GC structure.
+ * @param o Output buffer, caller releases o->s.
+ * @return GC_OK on success, GC_ERROR on failure.
+ */
+int gc_metrics_render(struct gc_s *gc, struct gc_metrics_out_s *o);
+
+/**
+ * @brief Render live allocations per call site, largest first.
+ *
+ * Needs library built with POOL_ACCOUNTING.
+ *
+ * @param gc GC structure.
+ * @param o Output buffer, caller releases o->s.
+ * @return GC_OK on success, GC_ERROR on failure.
+ */
+int gc_metrics_pool_report(struct gc_s *gc, struct gc_metrics_out_s *o);
+
+/**
+ * @brief Serve metrics on local admin port.
+ *
+ * Answers GET /metrics with rendered metrics and GET /pool with
+ * allocation report, then closes connection.
+ *
+ * @param gc GC structure.
+ * @param port Listening port.
+ * @return GC_OK on success, GC_ERROR on failure.
+ */
+int gc_metrics_admin_start(struct gc_s *gc, int port);
+
+/**
+ * @brief Close admin listener along with its clients.
+ *
+ * @param gc GC structure.
+ * @return void.
+ */
+void gc_metrics_admin_stop(struct gc_s *gc);
+
+/**
+ * @brief Release metrics registry.
+ *
+ * @param gc GC structure.
+ * @return void.
+ */
+void gc_metrics_free(struct gc_s *gc);
+
+#endif
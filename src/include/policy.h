@@ -0,0 +1,105 @@
+/*
+ *
+ * GrizzlyCloud library - simplified VPN alternative for IoT
+ * Copyright (C) 2017 - 2018 Filip Pancik
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef GC_POLICY_H_
+#define GC_POLICY_H_
+
+/**
+ * @brief Number of TCP ports.
+ */
+#define GC_POLICY_PORTS 65536
+
+/**
+ * @brief Access rule limited to cloud and/or device.
+ *
+ */
+struct gc_policy_rule_s {
+    snb cloud;                          /**< Cloud name, empty matches any cloud. */
+    snb device;                         /**< Device name, empty matches any device. */
+    int port_min;                       /**< First allowed port. */
+    int port_max;                       /**< Last allowed port. */
+
+    struct gc_policy_rule_s *next;      /**< Next rule in linked list. */
+};
+
+/**
+ * @brief Compiled access policy of endpoint ports.
+ *
+ * Compiled from "allow" array of configuration. Each element is
+ * either a port, a range "<min>-<max>" or an object restricting
+ * port or range to a cloud and/or device:
+ *
+ *   "allow" : [ 22, "8000-8100",
+ *               { "cloud" : "user1", "device" : "DevName1", "port" : 80 } ]
+ *
+ * Ports open to everyone are kept in a bitmap, restricted ones in a
+ * list of rules.
+ */
+struct gc_policy_s {
+    unsigned char ports[GC_POLICY_PORTS / 8];   /**< Ports allowed to any device. */
+    int           nports;                       /**< Number of ports in bitmap. */
+
+    struct gc_policy_rule_s *rules;             /**< Restricted rules. */
+    int           nrules;                       /**< Number of restricted rules. */
+};
+
+/**
+ * @brief Compile "allow" configuration into policy.
+ *
+ * Malformed elements are skipped with a warning.
+ *
+ * @param pool Memory pool.
+ * @param policy Policy structure.
+ * @param allow Parsed json array.
+ * @param log Logging stream.
+ * @return Number of compiled elements.
+ */
+int gc_policy_compile(struct hm_pool_s *pool, struct gc_policy_s *policy,
+                      struct json_object *allow, struct hm_log_s *log);
+
+/**
+ * @brief Check whether device may open stream to a port.
+ *
+ * @param policy Policy structure.
+ * @param cloud Cloud of remote device.
+ * @param device Remote device.
+ * @param port Backend port.
+ * @return GC_OK if allowed, GC_ERROR otherwise.
+ */
+int gc_policy_check(struct gc_policy_s *policy, sn cloud, sn device, int port);
+
+/**
+ * @brief Log policy.
+ *
+ * @param policy Policy structure.
+ * @param log Logging stream.
+ * @return void.
+ */
+void gc_policy_dump(struct gc_policy_s *policy, struct hm_log_s *log);
+
+/**
+ * @brief Free policy rules.
+ *
+ * @param pool Memory pool.
+ * @param policy Policy structure.
+ * @return void.
+ */
+void gc_policy_free(struct hm_pool_s *pool, struct gc_policy_s *policy);
+
+#endif
@@ -23,6 +23,27 @@
 #define POOL_DEBUG
 #define POOL_STDLIB
 
+/*
+ * Build with -DPOOL_ACCOUNTING to attribute every allocation
+ * to its call site, see hm_pool_sites().
+ */
+#if defined(POOL_ACCOUNTING) && !defined(POOL_STDLIB)
+#error "POOL_ACCOUNTING requires POOL_STDLIB"
+#endif
+
+/**
+ * @brief Allocator backing memory pool.
+ *
+ * Functions follow contract of malloc(), realloc() and free(),
+ * @p ctx is passed to each of them.
+ */
+struct hm_allocator_s {
+    void *(*alloc)(void *ctx, size_t size);                 /**< Allocate block. */
+    void *(*realloc)(void *ctx, void *ptr, size_t size);    /**< Resize block. */
+    void  (*free)(void *ctx, void *ptr);                    /**< Release block. */
+    void  *ctx;                                             /**< Allocator context. */
+};
+
 /**
  * @brief Pool structure.
  *
@@ -34,6 +55,9 @@ struct hm_pool_s {
     struct hm_log_s *log;           /**< Log stream. */
     struct pool_node_s *freenode;   /**< List of free nodes. */
     struct pool_bucket_s *buckets;  /**< List of buckets. */
+    unsigned long long allocs;      /**< Allocations served. */
+    unsigned long long frees;       /**< Allocations released. */
+    struct hm_allocator_s allocator;/**< Backing allocator, stdlib if alloc is NULL. */
     struct hm_pool_s *next;         /**< Next pool in linked list. */
 };
 
@@ -51,6 +75,22 @@ struct pool_node_s {
     struct pool_node_s *next;       /**< Next node in linked list. */
 };
 
+/**
+ * @brief Allocation call site.
+ *
+ * Sites are collected in "hm_palloc_sites" section. Statistics are process-wide
+ * and only maintained with POOL_ACCOUNTING.
+ */
+struct hm_pool_site_s {
+    int                line;        /**< Line of call. */
+    const char         *file;       /**< Source file, tells subsystem. */
+    const char         *func;       /**< Calling function. */
+    unsigned long long bytes;       /**< Live bytes. */
+    unsigned long long count;       /**< Live allocations. */
+    unsigned long long peak;        /**< High-water mark of live bytes. */
+    unsigned long long allocs;      /**< Allocations and reallocations made. */
+};
+
 /**
  * @brief Create new pool.
  *
@@ -58,6 +98,16 @@ struct pool_node_s {
  */
 struct hm_pool_s *hm_create_pool();
 
+/**
+ * @brief Create new pool backed by custom allocator.
+ *
+ * Pool structure itself is allocated by @p allocator as well.
+ *
+ * @param allocator Allocator, copied. NULL for stdlib.
+ * @return Pool structure on success or NULL on error.
+ */
+struct hm_pool_s *hm_create_pool_allocator(const struct hm_allocator_s *allocator);
+
 /**
  * @brief Allocate memory from pool.
  *
@@ -89,6 +139,48 @@ void *hm_prealloc(struct hm_pool_s *pool, void *ptr, const int size);
  */
 int hm_pfree(struct hm_pool_s *pool, void *ptr);
 
+/**
+ * @brief Allocate memory on behalf of call site.
+ *
+ * @param pool Pool structure.
+ * @param size Size of allocated block.
+ * @param site Call site.
+ * @return Memory pointer on success or NULL on error.
+ * @see hm_palloc()
+ */
+void *hm_palloc_site(struct hm_pool_s *pool, int size, struct hm_pool_site_s *site);
+
+/**
+ * @brief Reallocate memory on behalf of call site.
+ *
+ * Block is attributed to @p site afterwards.
+ *
+ * @param pool Pool structure.
+ * @param ptr Memory pointer.
+ * @param size New size.
+ * @param site Call site.
+ * @return Memory pointer on success or NULL on error.
+ * @see hm_prealloc()
+ */
+void *hm_prealloc_site(struct hm_pool_s *pool, void *ptr, const int size,
+                       struct hm_pool_site_s *site);
+
+/**
+ * @brief Allocation call sites.
+ *
+ * @param n Number of sites.
+ * @return Array of sites, NULL if accounting is off.
+ */
+struct hm_pool_site_s *hm_pool_sites(int *n);
+
+/**
+ * @brief Live bytes of all call sites.
+ *
+ * @param peak High-water mark of live bytes, may be NULL.
+ * @return Live bytes, 0 if accounting is off.
+ */
+unsigned long long hm_pool_usage(unsigned long long *peak);
+
 /**
  * @brief Destroy pool.
  *
@@ -97,4 +189,24 @@ int hm_pfree(struct hm_pool_s *pool, void *ptr);
  */
 int hm_destroy_pool(struct hm_pool_s *pool);
 
+/*
+ * Call sites are captured by macros, functions above stay
+ * available for callers that need an address.
+ */
+#ifdef POOL_ACCOUNTING
+#define HM_POOL_SITE\
+    ({\
+        static struct hm_pool_site_s hm_pool_site\
+            __attribute__((section("hm_palloc_sites"), aligned(8), used)) =\
+            { __LINE__, __FILE__, __FUNCTION__, 0, 0, 0, 0 };\
+        &hm_pool_site;\
+    })
+
+#define hm_palloc(m_pool, m_size)\
+    hm_palloc_site((m_pool), (m_size), HM_POOL_SITE)
+
+#define hm_prealloc(m_pool, m_ptr, m_size)\
+    hm_prealloc_site((m_pool), (m_ptr), (m_size), HM_POOL_SITE)
+#endif
+
 #endif
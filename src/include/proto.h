@@ -1,4 +1,4 @@
-// This file is generated 
+// This file is generated by script/proto/protogen.py, do not edit
 #ifndef GC_PROTO_H_
 #define GC_PROTO_H_
 
@@ -7,6 +7,12 @@
 #define GCPROTO_ERR 1
 #define GCPROTO_ERR_VERSION 2
 
+/* Space reserved in front of a serialized message for frame length */
+#define GCPROTO_FRAME_HEADROOM 4
+
+/* Maximum number of iovec entries filled by gc_serialize_iov() */
+#define GCPROTO_IOV_MAX 3
+
 enum proto_e {
     MESSAGE_TO,
     MESSAGE_TO_SET_REPLY,
@@ -114,8 +120,12 @@ struct proto_s {
     } u;
 };
 int gc_serialize(struct hm_pool_s *pool, sn *dst, struct proto_s *src);
+int gc_serialize_size(struct proto_s *src);
+int gc_serialize_write(char *dst, struct proto_s *src);
+int gc_serialize_hdr_size(struct proto_s *src);
+int gc_serialize_iov(char *hdr, struct iovec *iov, struct proto_s *src);
 int gc_deserialize(struct proto_s *dst, sn *src);
 void gc_proto_dump(struct proto_s *p);
 
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,106 @@
+/*
+ *
+ * GrizzlyCloud library - simplified VPN alternative for IoT
+ * Copyright (C) 2017 - 2018 Filip Pancik
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef GC_REGISTRY_H_
+#define GC_REGISTRY_H_
+
+/**
+ * @brief Bits of ID holding slot index, the rest is slot generation.
+ */
+#define GC_REGISTRY_INDEX_BITS  16
+#define GC_REGISTRY_INDEX_MASK  ((1U << GC_REGISTRY_INDEX_BITS) - 1)
+#define GC_REGISTRY_MAX         (1 << GC_REGISTRY_INDEX_BITS)
+#define GC_REGISTRY_INIT        64
+
+/**
+ * @brief Registry slot.
+ *
+ */
+struct gc_registry_slot_s {
+    void         *ptr;          /**< Registered object, NULL if slot is free. */
+    unsigned int generation;    /**< Bumped every time slot is released. */
+    int          next;          /**< Next free slot. */
+};
+
+/**
+ * @brief Slot map of live objects addressed by generation-tagged ID.
+ *
+ * ID is slot index in lower 16 bits and slot generation in upper 16 bits.
+ * Slot is reused once object is removed, but with a new generation,
+ * so an ID of removed object never resolves to a newer one.
+ */
+struct gc_registry_s {
+    struct gc_registry_slot_s *slots;   /**< Slots. */
+    int                       nslots;   /**< Number of allocated slots. */
+    int                       free;     /**< First free slot, -1 if none. */
+    int                       count;    /**< Number of registered objects. */
+};
+
+/**
+ * @brief Initialize registry.
+ *
+ * @param pool Memory pool.
+ * @param reg Registry structure.
+ * @return GC_OK on success, GC_ERROR on failure.
+ */
+int gc_registry_init(struct hm_pool_s *pool, struct gc_registry_s *reg);
+
+/**
+ * @brief Free registry.
+ *
+ * Registered objects are not released.
+ *
+ * @param pool Memory pool.
+ * @param reg Registry structure.
+ * @return void.
+ */
+void gc_registry_free(struct hm_pool_s *pool, struct gc_registry_s *reg);
+
+/**
+ * @brief Register object.
+ *
+ * @param pool Memory pool.
+ * @param reg Registry structure.
+ * @param ptr Object.
+ * @return Non-zero ID on success, 0 on failure.
+ */
+unsigned int gc_registry_add(struct hm_pool_s *pool, struct gc_registry_s *reg,
+                             void *ptr);
+
+/**
+ * @brief Look up object by ID.
+ *
+ * @param reg Registry structure.
+ * @param id ID returned by gc_registry_add().
+ * @return Object, NULL if ID is unknown or stale.
+ */
+void *gc_registry_get(struct gc_registry_s *reg, unsigned int id);
+
+/**
+ * @brief Unregister object.
+ *
+ * Stale IDs are ignored.
+ *
+ * @param reg Registry structure.
+ * @param id ID returned by gc_registry_add().
+ * @return void.
+ */
+void gc_registry_rem(struct gc_registry_s *reg, unsigned int id);
+
+#endif
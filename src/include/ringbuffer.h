@@ -21,6 +21,7 @@
 #define GC_RINGBUFFER_H
 
 #define RB_SLOT_SIZE    (32 * 1024)
+#define RB_IOV_MAX      16
 
 /**
  * @brief Ringbuffer slot specification.
@@ -28,8 +29,10 @@
  */
 struct gc_ringbuffer_slot_s {
     void   *buf;                       /**< Actual data. */
+    void   *mem;                       /**< Memory released once slot is sent, may be NULL. */
     int    len;                        /**< Data length. */
     int    sent;                       /**< Amount of data already sent. */
+    unsigned long long stamp;          /**< Time in ns to measure latency from, 0 if not measured. */
     struct gc_ringbuffer_slot_s *next; /**< Next slot in linked list. */
 };
 
@@ -70,6 +73,43 @@ char *gc_ringbuffer_send_next(struct gc_ringbuffer_s *rb, int *size);
 void gc_ringbuffer_send_skip(struct hm_pool_s *pool, struct gc_ringbuffer_s *rb,
                              int offset);
 
+/**
+ * @brief Gather pending send buffers.
+ *
+ * Fill @p iov with up to @p max unsent slots, in order.
+ * Use gc_ringbuffer_send_skip() with number of bytes written afterwards.
+ *
+ * @param rb Ringbuffer structure.
+ * @param iov Output vector.
+ * @param max Capacity of @p iov.
+ * @return Number of entries filled.
+ */
+int gc_ringbuffer_send_iov(struct gc_ringbuffer_s *rb, struct iovec *iov, int max);
+
+/**
+ * @brief Record latency of slots completed by next skip.
+ *
+ * Call before gc_ringbuffer_send_skip() with the same @p offset.
+ * Time elapsed since stamp of every timestamped slot that gets
+ * fully sent is recorded into @p h.
+ *
+ * @param rb Ringbuffer structure.
+ * @param offset Number of bytes sent.
+ * @param h Histogram.
+ * @return void.
+ */
+void gc_ringbuffer_send_latency(struct gc_ringbuffer_s *rb, int offset,
+                                struct gc_histogram_s *h);
+
+/**
+ * @brief Timestamp last queued slot.
+ *
+ * @param rb Ringbuffer structure.
+ * @param stamp Time in ns, see gc_metrics_now().
+ * @return void.
+ */
+void gc_ringbuffer_send_stamp(struct gc_ringbuffer_s *rb, unsigned long long stamp);
+
 /**
  * @brief Check if there is anything to send.
  *
@@ -78,6 +118,14 @@ void gc_ringbuffer_send_skip(struct hm_pool_s *pool, struct gc_ringbuffer_s *rb,
  */
 int gc_ringbuffer_send_is_empty(struct gc_ringbuffer_s *rb);
 
+/**
+ * @brief Number of bytes waiting to be sent.
+ *
+ * @param rb Ringbuffer structure.
+ * @return Pending bytes.
+ */
+int gc_ringbuffer_send_pending(struct gc_ringbuffer_s *rb);
+
 /**
  * @brief Clear send buffers.
  *
@@ -100,6 +148,42 @@ int gc_ringbuffer_send_append(struct hm_pool_s *pool,
                               struct gc_ringbuffer_s *rb,
                               char *buf, const int len);
 
+/**
+ * @brief Append data for sending without copying them.
+ *
+ * Ringbuffer takes ownership of @p buf, it must be allocated from @p pool
+ * and is released once sent. Released immediately on failure.
+ *
+ * @param pool Memory pool.
+ * @param rb Ringbuffer structure.
+ * @param buf Data pointer.
+ * @param len Length of data.
+ * @return GC_OK on success, GC_ERROR on failure.
+ */
+int gc_ringbuffer_send_append_nocopy(struct hm_pool_s *pool,
+                                     struct gc_ringbuffer_s *rb,
+                                     char *buf, const int len);
+
+/**
+ * @brief Append list of buffers for sending without copying them.
+ *
+ * Every iovec entry becomes its own slot referencing caller's memory.
+ * Slot releases @p mem entry (if not NULL) once it is sent, so owner
+ * of a memory block must be the last slot referencing it.
+ * Either all entries are queued or none.
+ *
+ * @param pool Memory pool.
+ * @param rb Ringbuffer structure.
+ * @param iov Buffers to send, at most RB_IOV_MAX.
+ * @param niov Number of buffers.
+ * @param mem Memory owned by each slot.
+ * @return GC_OK on success, GC_ERROR on failure.
+ */
+int gc_ringbuffer_send_append_iov(struct hm_pool_s *pool,
+                                  struct gc_ringbuffer_s *rb,
+                                  const struct iovec *iov, const int niov,
+                                  void **mem);
+
 /**
  * @brief Total bytes to send.
  *
@@ -130,6 +214,17 @@ void gc_ringbuffer_recv_append(struct hm_pool_s *pool, struct gc_ringbuffer_s *r
  */
 char *gc_ringbuffer_recv_read(struct gc_ringbuffer_s *rb, int *size);
 
+/**
+ * @brief Take ownership of received data.
+ *
+ * Storage is handed over to caller and must be released with hm_pfree().
+ * Ringbuffer starts with empty storage afterwards.
+ *
+ * @param rb Ringbuffer structure.
+ * @return Pointer to received data, NULL if nothing was received.
+ */
+void *gc_ringbuffer_recv_detach(struct gc_ringbuffer_s *rb);
+
 /**
  * @brief Release received data.
  *
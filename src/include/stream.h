@@ -0,0 +1,213 @@
+/*
+ *
+ * GrizzlyCloud library - simplified VPN alternative for IoT
+ * Copyright (C) 2017 - 2018 Filip Pancik
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef GC_STREAM_H_
+#define GC_STREAM_H_
+
+struct gc_s;
+struct gc_gen_client_s;
+
+/**
+ * @brief Initial per-stream flow control window in bytes.
+ */
+#define GC_STREAM_WINDOW        (256 * 1024)
+
+/**
+ * @brief Consumed bytes that trigger window update to the peer.
+ */
+#define GC_STREAM_WINDOW_UPDATE (GC_STREAM_WINDOW / 2)
+
+/**
+ * @brief Tunneled TCP connection multiplexed over upstream.
+ *
+ * Stream ID is assigned by the tunnel side when local connection
+ * is accepted, see gc_registry_add(), and is carried in every tunnel
+ * message:
+ *
+ * tunnel -> endpoint:
+ *   tunnel_open/<port_remote>/<id>/<port_local>
+ *   tunnel_request/<port_remote>/<id>/<port_local>   (payload)
+ *   tunnel_close/<port_remote>/<id>
+ *   tunnel_half_close/<port_remote>/<id>
+ *   tunnel_window/<port_remote>/<id>/<bytes>
+ *
+ * endpoint -> tunnel:
+ *   tunnel_response/<port_remote>/<id>              (payload)
+ *   tunnel_closed/<port_remote>/<id>
+ *   tunnel_half_closed/<port_remote>/<id>
+ *   tunnel_credit/<port_remote>/<id>/<bytes>
+ *
+ * tunnel_open may offer payload compression as 5th element, endpoint
+ * accepts it with tunnel_codec/<port_remote>/<id>/<codec>. Compressed
+ * payloads carry codec name as an extra trailing element of
+ * tunnel_request and tunnel_response.
+ *
+ * Each side may send at most window bytes of payload before peer
+ * grants more credit. Credit is granted only after payload has been
+ * written to local socket, so a slow consumer throttles its own
+ * stream and nothing else.
+ *
+ * Side whose local socket reads end of file sends half-close, peer
+ * shuts its local socket down for writing once everything queued is
+ * written. Side that finishes both directions first releases its client
+ * and sends close; close never drops data still being written locally.
+ */
+struct gc_stream_s {
+    unsigned int id;                /**< Stream ID. */
+    int          window;            /**< Bytes peer is still willing to accept. */
+    int          consumed;          /**< Bytes written locally, not yet credited to peer. */
+    int          paused;            /**< Reading from local socket stopped for lack of window. */
+    int          closed;            /**< Peer already closed the stream. */
+    int          eof_sent;          /**< Local socket reached end of file, peer told so. */
+    int          eof_recv;          /**< Peer finished sending. */
+    int          keepalive;         /**< Local socket is never shut down, it may serve another stream. */
+
+    struct gc_codec_s *codec;       /**< Payload compression, NULL if disabled. */
+};
+
+/**
+ * @brief Initialize stream.
+ *
+ * @param stream Stream structure.
+ * @param id Stream ID.
+ * @return void.
+ */
+void gc_stream_init(struct gc_stream_s *stream, unsigned int id);
+
+/**
+ * @brief Release stream resources.
+ *
+ * @param pool Memory pool.
+ * @param stream Stream structure.
+ * @return void.
+ */
+void gc_stream_free(struct hm_pool_s *pool, struct gc_stream_s *stream);
+
+/**
+ * @brief Compress outgoing payload if stream has compression enabled.
+ *
+ * On success @p payload points to compressed data and @p mem,
+ * memory block holding original payload, is replaced by compressed one.
+ *
+ * @param client Generic client owning the stream.
+ * @param payload Payload.
+ * @param mem Memory block holding payload.
+ * @return GC_OK if compressed, GC_ERROR if payload is to be sent raw.
+ */
+int gc_stream_encode(struct gc_gen_client_s *client, sn *payload, void **mem);
+
+/**
+ * @brief Deliver payload of last upstream packet to client.
+ *
+ * @param gc GC structure.
+ * @param client Generic client owning the stream.
+ * @param body Payload.
+ * @param compressed Payload is compressed.
+ * @return GC_OK on success, GC_ERROR on failure.
+ */
+int gc_stream_deliver(struct gc_s *gc, struct gc_gen_client_s *client,
+                      sn body, int compressed);
+
+/**
+ * @brief Account payload sent to the peer.
+ *
+ * Stops reading from client once window is exhausted.
+ *
+ * @param client Generic client owning the stream.
+ * @param n Number of bytes.
+ * @return void.
+ */
+void gc_stream_sent(struct gc_gen_client_s *client, int n);
+
+/**
+ * @brief Account payload written to local socket.
+ *
+ * @param stream Stream structure.
+ * @param n Number of bytes.
+ * @return Credit to grant to the peer, 0 if not yet worth sending.
+ */
+int gc_stream_consumed(struct gc_stream_s *stream, int n);
+
+/**
+ * @brief Apply credit granted by the peer.
+ *
+ * Resumes reading from client if it was paused.
+ *
+ * @param client Generic client owning the stream.
+ * @param n Number of bytes.
+ * @return void.
+ */
+void gc_stream_credit(struct gc_gen_client_s *client, int n);
+
+/**
+ * @brief Local socket reached end of file.
+ *
+ * Stops reading from client, peer is to be sent half-close.
+ *
+ * @param client Generic client owning the stream.
+ * @return GC_OK if stream stays half-open, GC_ERROR if it's finished
+ *         in both directions and client is to be closed.
+ */
+int gc_stream_eof(struct gc_gen_client_s *client);
+
+/**
+ * @brief Peer finished sending.
+ *
+ * Local socket is shut down for writing once send buffer drains,
+ * unless stream is kept alive.
+ *
+ * @param client Generic client owning the stream.
+ * @return GC_OK if stream stays half-open, GC_ERROR if it's finished
+ *         in both directions and client is to be closed.
+ */
+int gc_stream_peer_eof(struct gc_gen_client_s *client);
+
+/**
+ * @brief Check if finished stream is still writing to local socket.
+ *
+ * Such client is released by error callback with GC_STREAMDONE_ERR
+ * once send buffer drains.
+ *
+ * @param client Generic client owning the stream.
+ * @return 1 if client is still draining, 0 otherwise.
+ */
+int gc_stream_draining(struct gc_gen_client_s *client);
+
+/**
+ * @brief Handle drained send buffer of client.
+ *
+ * @param client Generic client owning the stream.
+ * @return void.
+ */
+void gc_stream_drained(struct gc_gen_client_s *client);
+
+/**
+ * @brief Send stream control message without payload.
+ *
+ * Nothing is sent while upstream is not connected.
+ *
+ * @param gc GC structure.
+ * @param to Destination device.
+ * @param address Destination process ID.
+ * @param tp Message type and arguments.
+ * @return GC_OK on success, GC_ERROR on failure.
+ */
+int gc_stream_control(struct gc_s *gc, sn to, sn address, const char *tp);
+
+#endif
@@ -33,6 +33,10 @@ struct gc_tunnel_s {
     snb    port_remote;             /**< Remote port. */
     snb    type;                    /**< Type of tunnel. */
 
+    enum gc_codec_e codec;          /**< Payload compression offered to endpoint. */
+    struct gc_codec_stats_s stats;  /**< Compression statistics of all streams. */
+    struct gc_metrics_traffic_s traffic; /**< Traffic of local clients. */
+
     struct gc_gen_server_s *server;   /**< Local TCP server related with tunnel. */
 
     struct gc_tunnel_s *next;       /**< Pointer to next tunnel in a linked list. */
@@ -79,23 +83,88 @@ int gc_tunnel_update(struct gc_s *gc, struct proto_s *p, char **argv, int argc);
  */
 int gc_tunnel_response(struct gc_s *gc, struct proto_s *p, char **argv, int argc);
 
+/**
+ * @brief Endpoint closed the stream, close local client.
+ *
+ * @param gc GC structure.
+ * @param p Protocol message.
+ * @param argv Array of parsed header elements.
+ * @param argc Number of elements in array.
+ * @return GC_OK on success, GC_ERROR on failure.
+ */
+int gc_tunnel_closed(struct gc_s *gc, struct proto_s *p, char **argv, int argc);
+
+/**
+ * @brief Endpoint finished sending, shut local client down for writing.
+ *
+ * @param gc GC structure.
+ * @param p Protocol message.
+ * @param argv Array of parsed header elements.
+ * @param argc Number of elements in array.
+ * @return GC_OK on success, GC_ERROR on failure.
+ */
+int gc_tunnel_half_closed(struct gc_s *gc, struct proto_s *p, char **argv, int argc);
+
+/**
+ * @brief Endpoint granted more window for the stream.
+ *
+ * @param gc GC structure.
+ * @param p Protocol message.
+ * @param argv Array of parsed header elements.
+ * @param argc Number of elements in array.
+ * @return GC_OK on success, GC_ERROR on failure.
+ */
+int gc_tunnel_credit(struct gc_s *gc, struct proto_s *p, char **argv, int argc);
+
+/**
+ * @brief Endpoint accepted payload compression for the stream.
+ *
+ * @param gc GC structure.
+ * @param p Protocol message.
+ * @param argv Array of parsed header elements.
+ * @param argc Number of elements in array.
+ * @return GC_OK on success, GC_ERROR on failure.
+ */
+int gc_tunnel_codec(struct gc_s *gc, struct proto_s *p, char **argv, int argc);
+
 /**
  * @brief Stop tunnel.
  *
- * @param pool Memory pool.
- * @param log Log structure.
+ * @param gc GC structure.
  * @param pid process ID.
  * @return void.
  */
-void gc_tunnel_stop(struct hm_pool_s *pool, struct hm_log_s *log, sn pid);
+void gc_tunnel_stop(struct gc_s *gc, sn pid);
+
+/**
+ * @brief Remove tunnel no longer present in configuration.
+ *
+ * Closes local TCP server along with its clients.
+ *
+ * @param gc GC structure.
+ * @param cloud Destination cloud.
+ * @param device Destination device.
+ * @param port_remote Destination port.
+ * @param port_local Local port.
+ * @return GC_OK on success, GC_ERROR if no such tunnel exists.
+ */
+int gc_tunnel_remove(struct gc_s *gc, sn cloud, sn device,
+                     sn port_remote, sn port_local);
+
+/**
+ * @brief List of active tunnels.
+ *
+ * @param gc GC structure.
+ * @return First tunnel, NULL if there are none.
+ */
+struct gc_tunnel_s *gc_tunnels(struct gc_s *gc);
 
 /**
  * @brief Stop all tunnels.
  *
- * @param pool Memory pool.
- * @param log Log structure.
+ * @param gc GC structure.
  * @return void.
  */
-void gc_tunnel_stop_all(struct hm_pool_s *pool, struct hm_log_s *log);
+void gc_tunnel_stop_all(struct gc_s *gc);
 
 #endif
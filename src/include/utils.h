@@ -22,6 +22,15 @@
 
 #define GC_MAX_FILE_SIZE   (1024 * 1024)
 
+/* Payloads from this size up are sent by reference rather than copied */
+#define GC_PACKET_REF_MIN  2048
+
+/* Batch is sent once it grows over this size */
+#define GC_BATCH_MAX       (16 * 1024)
+
+/* Longest cloud/device/port/port_local key of tunnel index */
+#define GC_CFG_TUNNEL_KEY  512
+
 #define COUNT(m_dst) sizeof(m_dst) / sizeof(m_dst[0])
 
 #define CALLBACK_ERROR(m_log, m_msg)\
@@ -279,6 +288,31 @@ int gc_config_parse(struct hm_pool_s *pool, struct gc_config_s *cfg, const char
  */
 int gc_backend_parse(struct hm_pool_s *pool, struct gc_config_s *cfg, const char *path);
 
+/**
+ * @brief Find configured tunnel.
+ *
+ * @param cfg Config structure
+ * @param cloud Destination cloud
+ * @param device Destination device
+ * @param port Destination port
+ * @param port_local Local port
+ * @return Tunnel on success, NULL if not configured
+ */
+struct gc_config_tunnel_s *gc_config_tunnel_find(struct gc_config_s *cfg, sn cloud,
+                                                 sn device, sn port, sn port_local);
+
+/**
+ * @brief Change local port of configured tunnel, keeping it indexed.
+ *
+ * @param pool Pool structure
+ * @param cfg Config structure
+ * @param t Tunnel
+ * @param port_local New local port
+ * @return GC_OK on success, GC_ERROR on failure
+ */
+int gc_config_tunnel_port_local(struct hm_pool_s *pool, struct gc_config_s *cfg,
+                                struct gc_config_tunnel_s *t, const int port_local);
+
 /**
  * @brief Send packet to upstream.
  *
@@ -288,6 +322,48 @@ int gc_backend_parse(struct hm_pool_s *pool, struct gc_config_s *cfg, const char
  */
 int gc_packet_send(struct gc_s *gc, struct proto_s *pr);
 
+/**
+ * @brief Send several packets to upstream in a single write.
+ *
+ * Frames are serialized back to back into one send buffer slot.
+ *
+ * @param gc GC structure.
+ * @param pr Array of protocol messages.
+ * @param npr Number of messages.
+ * @return GC_OK on success, GC_ERROR on failure.
+ */
+int gc_packet_send_all(struct gc_s *gc, struct proto_s *pr, const int npr);
+
+/**
+ * @brief Send pending batch of messages to upstream.
+ *
+ * If batching is enabled, small MESSAGE_TO packets queued by gc_packet_send()
+ * for the same peer while upstream is busy are packed into one MESSAGE_TO
+ * of type "batch". Batch is sent once upstream drains, grows over
+ * GC_BATCH_MAX, or any other packet is sent.
+ *
+ * Body of a batch is list of length prefixed (tp, body) pairs.
+ *
+ * @param gc GC structure.
+ * @return void.
+ */
+void gc_packet_flush(struct gc_s *gc);
+
+/**
+ * @brief Send packet to upstream without copying its payload.
+ *
+ * Payload (MESSAGE_TO/MESSAGE_FROM body) is queued by reference,
+ * @p ref is memory block holding it. Function takes ownership of @p ref
+ * and releases it once payload is sent or on failure.
+ * Payloads smaller than GC_PACKET_REF_MIN are copied.
+ *
+ * @param gc GC structure.
+ * @param pr Protocol message.
+ * @param ref Memory block holding payload, allocated from gc pool.
+ * @return GC_OK on success, GC_ERROR on failure.
+ */
+int gc_packet_send_ref(struct gc_s *gc, struct proto_s *pr, void *ref);
+
 /**
  * @brief Parse buffer by delimiter.
  *
@@ -19,22 +19,64 @@
  */
 #include <gc.h>
 
-int hm_log_impl(enum loglevel_e level, struct hm_log_s *log, const char *file,
-                const int line, const char *func, const char *msg, ...)
+#define HM_LOG_BATCH   64    /**< Maximum records written by single writev(). */
+#define HM_LOG_WAIT    100   /**< Writer thread idle wake-up in ms. */
+
+/**
+ * @brief Record of asynchronous log ring.
+ *
+ * Sequence number tells the owner of the record. It equals ring position
+ * when record is free for producers, position + 1 once message is ready
+ * for writer and position + ring size after writer released it.
+ */
+struct hm_log_record_s {
+    unsigned long seq;                 /**< Sequence number. */
+    size_t        len;                 /**< Message length. */
+    char          buf[HM_LOG_RECORD];  /**< Preformatted message. */
+};
+
+/**
+ * @brief Asynchronous log, bounded multi-producer single-consumer ring.
+ *
+ */
+struct hm_log_async_s {
+    struct hm_log_record_s *records;   /**< Ring of records. */
+    unsigned long          mask;       /**< Ring size - 1, size is power of 2. */
+    enum hm_log_overflow_e overflow;   /**< Overflow policy. */
+
+    unsigned long head __attribute__((aligned(64)));   /**< Next position claimed by producers. */
+    unsigned long long dropped;                        /**< Dropped messages. */
+
+    unsigned long tail __attribute__((aligned(64)));   /**< Next position written by writer. */
+    int           sleeping;                            /**< Writer waits for signal. */
+    int           stop;                                /**< Writer should drain and quit. */
+
+    int             fd;                                /**< Log file descriptor. */
+    pthread_t       thread;                            /**< Writer thread. */
+    pthread_mutex_t lock;                              /**< Protects wake-up. */
+    pthread_cond_t  wake;                              /**< Signals new records. */
+};
+
+static int log_stamp(char *out, size_t size, double now)
 {
-    size_t          len = 0;
-    char            out[8192], buf[128];
-    time_t          s;
-    struct timespec spec;
-    long long       ms;
-    struct tm       ts;
+    char      buf[128];
+    time_t    s = (time_t)now;
+    long long ms = (long long)((now - s) * 1e3);
+    struct tm ts;
 
-    assert(log);
+    localtime_r(&s, &ts);
+    strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &ts);
 
-    /** only display messages user asked for */
-    if(level > log->level) {
-        return -1;
-    }
+    return snprintf(out, size, "[%s.%03lld] ", buf, ms);
+}
+
+static size_t log_format(char *out, size_t size, const char *stamp,
+                         enum loglevel_e level,
+                         const char *file, int line, const char *func,
+                         const char *msg, va_list args)
+{
+    size_t          len = 0, max = 3 * size / 4;
+    int             n;
 
     //if(log->fd == STDERR_FILENO)
     {
@@ -71,31 +113,535 @@ int hm_log_impl(enum loglevel_e level, struct hm_log_s *log, const char *file,
                 colour = NULL;
         }
         if(colour) {
-            len += snprintf(out, sizeof(out), colour, NULL);
+            len += snprintf(out, size, colour, NULL);
         }
     }
 
-    clock_gettime(CLOCK_REALTIME, &spec);
-    s = spec.tv_sec;
-    ms = round(spec.tv_nsec / 1.0e6);
+    if(stamp && stamp[0]) {
+        len += snprintf(out + len, size - len, "%s", stamp);
+    } else {
+        struct timespec spec;
+        clock_gettime(CLOCK_REALTIME, &spec);
+        len += log_stamp(out + len, size - len, spec.tv_sec + spec.tv_nsec / 1e9);
+    }
 
-    ts = *localtime(&s);
-    strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &ts);
+    n = vsnprintf(out + len, max - len, msg, args);
+    if(n < 0) n = 0;
+    if(len + n >= max) {
+        len = max - 1;
+        len += snprintf(out + len, size - len, "...");
+    } else {
+        len += n;
+    }
+
+    n = snprintf(out + len, size - len, ", %s:%d(%s)\n", file, line, func);
+    if(n < 0) n = 0;
+    if(len + n >= size) {
+        len = size - 1;
+        out[len - 1] = '\n';
+    } else {
+        len += n;
+    }
+
+    return len;
+}
+
+static struct hm_log_record_s *async_claim(struct hm_log_async_s *a, unsigned long *pos)
+{
+    struct hm_log_record_s *r;
+    unsigned long p = __atomic_load_n(&a->head, __ATOMIC_RELAXED);
+
+    for(;;) {
+        r = &a->records[p & a->mask];
+        long diff = (long)(__atomic_load_n(&r->seq, __ATOMIC_ACQUIRE) - p);
+
+        if(diff == 0) {
+            if(__atomic_compare_exchange_n(&a->head, &p, p + 1, 1,
+                                           __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                *pos = p;
+                return r;
+            }
+        } else if(diff < 0) {
+            // Ring is full
+            if(a->overflow == HM_LOG_OVERFLOW_DROP) {
+                __atomic_add_fetch(&a->dropped, 1, __ATOMIC_RELAXED);
+                return NULL;
+            }
+
+            pthread_mutex_lock(&a->lock);
+            pthread_cond_signal(&a->wake);
+            pthread_mutex_unlock(&a->lock);
+            sched_yield();
+
+            p = __atomic_load_n(&a->head, __ATOMIC_RELAXED);
+        } else {
+            p = __atomic_load_n(&a->head, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static void async_publish(struct hm_log_async_s *a, struct hm_log_record_s *r, unsigned long pos)
+{
+    __atomic_store_n(&r->seq, pos + 1, __ATOMIC_SEQ_CST);
+
+    // Writer re-checks ring after announcing sleep, only first producer wakes it up
+    if(__atomic_exchange_n(&a->sleeping, 0, __ATOMIC_SEQ_CST)) {
+        pthread_mutex_lock(&a->lock);
+        pthread_cond_signal(&a->wake);
+        pthread_mutex_unlock(&a->lock);
+    }
+}
+
+static void async_writev(int fd, struct iovec *iov, int n)
+{
+    while(n > 0) {
+        ssize_t nwritten = writev(fd, iov, n);
+        if(nwritten < 0) {
+            if(errno == EINTR) continue;
+            return;
+        }
+
+        while(n > 0 && (size_t)nwritten >= iov->iov_len) {
+            nwritten -= iov->iov_len;
+            iov++;
+            n--;
+        }
+
+        if(n > 0) {
+            iov->iov_base = (char *)iov->iov_base + nwritten;
+            iov->iov_len -= nwritten;
+        }
+    }
+}
+
+static int async_ready(struct hm_log_async_s *a, unsigned long pos)
+{
+    return __atomic_load_n(&a->records[pos & a->mask].seq, __ATOMIC_SEQ_CST) == pos + 1;
+}
+
+static void *async_writer(void *arg)
+{
+    struct hm_log_async_s *a = arg;
+    struct iovec iov[HM_LOG_BATCH];
+    unsigned long pos = a->tail;
+    int i, n;
+
+    for(;;) {
+        for(n = 0; n < HM_LOG_BATCH && async_ready(a, pos + n); n++) {
+            struct hm_log_record_s *r = &a->records[(pos + n) & a->mask];
+            iov[n].iov_base = r->buf;
+            iov[n].iov_len  = r->len;
+        }
+
+        if(n > 0) {
+            async_writev(a->fd, iov, n);
+
+            for(i = 0; i < n; i++) {
+                __atomic_store_n(&a->records[(pos + i) & a->mask].seq,
+                                 pos + i + a->mask + 1, __ATOMIC_RELEASE);
+            }
+            pos += n;
+            __atomic_store_n(&a->tail, pos, __ATOMIC_RELEASE);
+            continue;
+        }
+
+        if(__atomic_load_n(&a->stop, __ATOMIC_ACQUIRE)) {
+            break;
+        }
+
+        pthread_mutex_lock(&a->lock);
+        __atomic_store_n(&a->sleeping, 1, __ATOMIC_SEQ_CST);
+        if(!async_ready(a, pos) && !__atomic_load_n(&a->stop, __ATOMIC_ACQUIRE)) {
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            ts.tv_nsec += HM_LOG_WAIT * 1000000L;
+            if(ts.tv_nsec >= 1000000000L) {
+                ts.tv_sec++;
+                ts.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&a->wake, &a->lock, &ts);
+        }
+        __atomic_store_n(&a->sleeping, 0, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&a->lock);
+    }
+
+    return NULL;
+}
+
+static int log_vimpl(enum loglevel_e level, struct hm_log_s *log, const char *file,
+                     const int line, const char *func, const char *msg, va_list args)
+{
+    size_t          len;
+    char            out[8192];
+
+    if(log->async) {
+        struct hm_log_record_s *r;
+        unsigned long pos;
+
+        r = async_claim(log->async, &pos);
+        if(r == NULL) {
+            return GC_ERROR;
+        }
+
+        r->len = log_format(r->buf, sizeof(r->buf), log->stamp, level, file, line, func, msg, args);
+
+        async_publish(log->async, r, pos);
+        return GC_OK;
+    }
 
-    len += snprintf(out + len, sizeof(out) - len, "[%s.%03lld] ", buf, ms);
+    len = log_format(out, sizeof(out), log->stamp, level, file, line, func, msg, args);
 
+    ssize_t nwritten = write(log->fd, out, len);
+    return (nwritten == (ssize_t)len) ? GC_OK : GC_ERROR;
+}
+
+int hm_log_impl(enum loglevel_e level, struct hm_log_s *log, const char *file,
+                const int line, const char *func, const char *msg, ...)
+{
     va_list args;
+    int     ret;
+
+    assert(log);
+
+    /** only display messages user asked for */
+    if(level > log->level) {
+        return -1;
+    }
+
     va_start(args, msg);
-    len += vsnprintf(out+len, 3*sizeof(out)/4-len, msg, args);
+    ret = log_vimpl(level, log, file, line, func, msg, args);
     va_end(args);
-    if(len >= 3*sizeof(out)/4) {
-        len += snprintf(out + len, sizeof(out) - len, "...");
+
+    return ret;
+}
+
+/*
+ * Binary trace file, native byte order:
+ *
+ *   header    struct hm_log_trace_hdr_s
+ *   sites     per site: u32 level, u32 line, u16 file, u16 func, u16 fmt,
+ *             u16 reserved, followed by the three strings, 8-byte aligned
+ *   ring      records, 8-byte aligned
+ *
+ * Record is u32 length, u32 site index and u64 monotonic nanoseconds
+ * followed by arguments, each a kind byte and its value: 'i' 4 bytes,
+ * 'l' 8 bytes, 'd' double, 'p' 8 bytes, 's' u16 length and bytes.
+ * Site index with HM_TRACE_TEXT set holds single preformatted 's'
+ * for formats trace can't store raw. Record with site HM_TRACE_PAD
+ * fills the ring up to its end.
+ */
+#define HM_TRACE_MAGIC    "GCTRACE"
+#define HM_TRACE_VERSION  1
+#define HM_TRACE_RECORD   1024          /**< Longest record, arguments are truncated. */
+#define HM_TRACE_STRING   255           /**< Longest string argument. */
+#define HM_TRACE_TEXT     0x80000000u
+#define HM_TRACE_PAD      0xffffffffu
+#define HM_TRACE_ALIGN(m_n) (((m_n) + 7) & ~(size_t)7)
+
+struct hm_log_trace_hdr_s {
+    char     magic[8];      /**< HM_TRACE_MAGIC. */
+    uint32_t version;       /**< HM_TRACE_VERSION. */
+    uint32_t nsites;        /**< Number of sites. */
+    uint64_t sites;         /**< Offset of site table. */
+    uint64_t ring;          /**< Offset of ring. */
+    uint64_t size;          /**< Ring size. */
+    uint64_t head;          /**< Bytes written into ring. */
+    uint64_t tail;          /**< Start of oldest record. */
+    int64_t  realtime;      /**< CLOCK_REALTIME at open, ns. */
+    int64_t  monotonic;     /**< CLOCK_MONOTONIC at open, ns. */
+};
+
+/**
+ * @brief Open binary trace.
+ *
+ */
+struct hm_log_trace_s {
+    int                       fd;       /**< Trace file. */
+    char                      *map;     /**< Mapped file. */
+    size_t                    nmap;     /**< Mapped size. */
+    struct hm_log_trace_hdr_s *hdr;     /**< Header. */
+    char                      *ring;    /**< Ring start. */
+};
+
+extern struct hm_log_site_s __start_hm_log_sites[] __attribute__((weak));
+extern struct hm_log_site_s __stop_hm_log_sites[] __attribute__((weak));
+
+static int64_t trace_ns(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief Parse argument kinds from printf format.
+ *
+ */
+static void trace_parse(struct hm_log_site_s *site)
+{
+    const char *p = site->fmt;
+    int n = 0;
+
+    while((p = strchr(p, '%'))) {
+        int lng = 0, limit = 0, star = 0;
+
+        p++;
+        if(*p == '%') {
+            p++;
+            continue;
+        }
+
+        while(*p && strchr("-+ #0'", *p)) p++;
+
+        if(*p == '*') {
+            if(n >= HM_LOG_ARGS) goto text;
+            site->args[n++] = 'i';
+            p++;
+        }
+        while(*p >= '0' && *p <= '9') p++;
+
+        if(*p == '.') {
+            p++;
+            if(*p == '*') {
+                star = 1;
+                p++;
+            }
+            while(*p >= '0' && *p <= '9') {
+                limit = limit * 10 + *p - '0';
+                p++;
+            }
+        }
+
+        while(*p && strchr("hlLqjzt", *p)) {
+            if(*p == 'l' || *p == 'q' || *p == 'j' || *p == 'z' || *p == 't') lng = 1;
+            if(*p == 'L') goto text;
+            p++;
+        }
+
+        if(n + star >= HM_LOG_ARGS) goto text;
+
+        // Precision of %.*s bounds string, it's stored as copied length
+        if(star) {
+            site->args[n++] = (*p == 's') ? 'P' : 'i';
+        }
+
+        switch(*p) {
+            case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+                site->args[n++] = lng ? 'l' : 'i';
+                break;
+            case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+                site->args[n++] = 'd';
+                break;
+            case 'p':
+                site->args[n++] = 'p';
+                break;
+            case 's':
+                site->limit[n] = limit > HM_TRACE_STRING ? HM_TRACE_STRING : limit;
+                site->args[n++] = 's';
+                break;
+            default:
+                goto text;
+        }
+        p++;
     }
 
-    len += snprintf(out+len, sizeof(out)-len, ", %s:%d(%s)\n", file, line, func);
+    site->nargs = n;
+    return;
 
-    ssize_t nwritten = write(log->fd, out, len);
-    return (nwritten == len) ? GC_OK : GC_ERROR;
+text:
+    site->nargs = -1;
+}
+
+static char *trace_put(char *dst, char *end, const void *src, size_t n)
+{
+    if(dst == NULL || dst + n > end) {
+        return NULL;
+    }
+
+    memcpy(dst, src, n);
+    return dst + n;
+}
+
+static char *trace_string(char *dst, char *end, const char *s, size_t limit)
+{
+    uint16_t n;
+
+    if(s == NULL) {
+        s = "(null)";
+    }
+
+    if(limit > HM_TRACE_STRING) limit = HM_TRACE_STRING;
+    n = strnlen(s, limit);
+
+    if(dst && dst + 1 + sizeof(n) + n > end) {
+        if(end - dst < (long)(1 + sizeof(n))) {
+            return NULL;
+        }
+        n = end - dst - 1 - sizeof(n);
+    }
+
+    dst = trace_put(dst, end, "s", 1);
+    dst = trace_put(dst, end, &n, sizeof(n));
+    return trace_put(dst, end, s, n);
+}
+
+static char *trace_args(struct hm_log_site_s *site, char *dst, char *end, va_list args)
+{
+    int  i, prec = HM_TRACE_STRING;
+
+    for(i = 0; i < site->nargs && dst; i++) {
+        switch(site->args[i]) {
+            case 'i': {
+                int v = va_arg(args, int);
+                dst = trace_put(dst, end, "i", 1);
+                dst = trace_put(dst, end, &v, sizeof(v));
+                break;
+            }
+            case 'P': {
+                int v = va_arg(args, int);
+                prec = (v < 0 || v > HM_TRACE_STRING) ? HM_TRACE_STRING : v;
+                // Copied length is known once string is read, patched below
+                dst = trace_put(dst, end, "i", 1);
+                dst = trace_put(dst, end, &prec, sizeof(prec));
+                break;
+            }
+            case 'l': {
+                long long v = va_arg(args, long long);
+                dst = trace_put(dst, end, "l", 1);
+                dst = trace_put(dst, end, &v, sizeof(v));
+                break;
+            }
+            case 'd': {
+                double v = va_arg(args, double);
+                dst = trace_put(dst, end, "d", 1);
+                dst = trace_put(dst, end, &v, sizeof(v));
+                break;
+            }
+            case 'p': {
+                uint64_t v = (uintptr_t)va_arg(args, void *);
+                dst = trace_put(dst, end, "p", 1);
+                dst = trace_put(dst, end, &v, sizeof(v));
+                break;
+            }
+            case 's': {
+                const char *v = va_arg(args, const char *);
+                char *start = dst;
+
+                if(i > 0 && site->args[i - 1] == 'P') {
+                    dst = trace_string(dst, end, v, prec);
+                    if(dst) {
+                        uint16_t n;
+                        memcpy(&n, start + 1, sizeof(n));
+                        prec = n;
+                        memcpy(start - sizeof(prec), &prec, sizeof(prec));
+                    }
+                    prec = HM_TRACE_STRING;
+                } else {
+                    dst = trace_string(dst, end, v, site->limit[i] ? site->limit[i] : HM_TRACE_STRING);
+                }
+                break;
+            }
+        }
+    }
+
+    return dst;
+}
+
+static void trace_write(struct hm_log_trace_s *t, const char *rec, uint32_t len)
+{
+    struct hm_log_trace_hdr_s *hdr = t->hdr;
+    uint64_t head = hdr->head, tail = hdr->tail, pos = head % hdr->size;
+    uint32_t pad[2] = { 0, HM_TRACE_PAD };
+
+    // Record doesn't fit before end of ring, pad it and wrap
+    if(pos + len > hdr->size) {
+        pad[0] = hdr->size - pos;
+        while(head + pad[0] - tail > hdr->size) {
+            tail += *(uint32_t *)(t->ring + tail % hdr->size);
+        }
+        __atomic_store_n(&hdr->tail, tail, __ATOMIC_RELEASE);
+        memcpy(t->ring + pos, pad, sizeof(pad));
+        head += pad[0];
+        pos = 0;
+    }
+
+    // Overwrite oldest records
+    while(head + len - tail > hdr->size) {
+        tail += *(uint32_t *)(t->ring + tail % hdr->size);
+    }
+    __atomic_store_n(&hdr->tail, tail, __ATOMIC_RELEASE);
+
+    memcpy(t->ring + pos, rec, len);
+    __atomic_store_n(&hdr->head, head + len, __ATOMIC_RELEASE);
+}
+
+static int trace_record(struct hm_log_trace_s *t, struct hm_log_site_s *site,
+                        const char *msg, va_list args)
+{
+    char     rec[HM_TRACE_RECORD], *dst, *end = rec + sizeof(rec);
+    uint32_t id, len;
+    int64_t  ns;
+
+    if(site < __start_hm_log_sites || site >= __stop_hm_log_sites) {
+        return GC_ERROR;
+    }
+
+    id = site - __start_hm_log_sites;
+    ns = trace_ns(CLOCK_MONOTONIC);
+
+    dst = rec + sizeof(len);
+    if(site->nargs < 0) {
+        char text[HM_TRACE_STRING + 1];
+        id |= HM_TRACE_TEXT;
+        vsnprintf(text, sizeof(text), msg, args);
+        dst = trace_put(dst, end, &id, sizeof(id));
+        dst = trace_put(dst, end, &ns, sizeof(ns));
+        dst = trace_string(dst, end, text, HM_TRACE_STRING);
+    } else {
+        dst = trace_put(dst, end, &id, sizeof(id));
+        dst = trace_put(dst, end, &ns, sizeof(ns));
+        dst = trace_args(site, dst, end, args);
+    }
+
+    if(dst == NULL) {
+        return GC_ERROR;
+    }
+
+    len = HM_TRACE_ALIGN(dst - rec);
+    memset(dst, 0, rec + len - dst);
+    memcpy(rec, &len, sizeof(len));
+
+    trace_write(t, rec, len);
+
+    return GC_OK;
+}
+
+int hm_log_site_impl(struct hm_log_site_s *site, struct hm_log_s *log,
+                     const char *msg, ...)
+{
+    va_list args;
+    int     ret;
+
+    assert(log);
+
+    va_start(args, msg);
+    if(site->level > log->level) {
+        ret = log->trace ? trace_record(log->trace, site, msg, args) : GC_ERROR;
+    } else {
+        ret = log_vimpl(site->level, log, site->file, site->line, site->func, msg, args);
+    }
+    va_end(args);
+
+    return ret;
+}
+
+void hm_log_clock(struct hm_log_s *l, double now)
+{
+    if(now > 0) {
+        log_stamp(l->stamp, sizeof(l->stamp), now);
+    } else {
+        l->stamp[0] = '\0';
+    }
 }
 
 int hm_log_open(struct hm_log_s *l, const char *filename, enum loglevel_e level)
@@ -112,6 +658,10 @@ int hm_log_open(struct hm_log_s *l, const char *filename, enum loglevel_e level)
     }
 
     l->level = level;
+    l->limit = level;
+    l->async = NULL;
+    l->trace = NULL;
+    l->stamp[0] = '\0';
 
     return GC_OK;
 }
@@ -125,3 +675,212 @@ int hm_log_close(struct hm_log_s *l)
         return GC_ERROR;
     }
 }
+
+int hm_log_async_start(struct hm_log_s *l, int records, enum hm_log_overflow_e overflow)
+{
+    struct hm_log_async_s *a;
+    unsigned long size, i;
+    sigset_t all, old;
+
+    if(l->async || records <= 0) {
+        return GC_ERROR;
+    }
+
+    for(size = 1; size < (unsigned long)records; size <<= 1);
+
+    // Writer thread runs outside of memory pool, it is not thread-safe
+    a = malloc(sizeof(*a));
+    if(a == NULL) {
+        return GC_ERROR;
+    }
+    memset(a, 0, sizeof(*a));
+
+    a->records = malloc(size * sizeof(*a->records));
+    if(a->records == NULL) {
+        free(a);
+        return GC_ERROR;
+    }
+
+    for(i = 0; i < size; i++) {
+        a->records[i].seq = i;
+    }
+
+    a->mask     = size - 1;
+    a->overflow = overflow;
+    a->fd       = l->fd;
+
+    pthread_mutex_init(&a->lock, NULL);
+    pthread_cond_init(&a->wake, NULL);
+
+    // Keep signals delivered to event loop thread
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    int ret = pthread_create(&a->thread, NULL, async_writer, a);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    if(ret != 0) {
+        pthread_cond_destroy(&a->wake);
+        pthread_mutex_destroy(&a->lock);
+        free(a->records);
+        free(a);
+        return GC_ERROR;
+    }
+
+    l->async = a;
+
+    return GC_OK;
+}
+
+int hm_log_async_stop(struct hm_log_s *l)
+{
+    struct hm_log_async_s *a = l->async;
+
+    if(a == NULL) {
+        return GC_ERROR;
+    }
+
+    __atomic_store_n(&a->stop, 1, __ATOMIC_RELEASE);
+    pthread_mutex_lock(&a->lock);
+    pthread_cond_signal(&a->wake);
+    pthread_mutex_unlock(&a->lock);
+
+    pthread_join(a->thread, NULL);
+
+    l->async = NULL;
+
+    if(a->dropped > 0) {
+        hm_log(LOG_WARNING, l, "Asynchronous log dropped %llu messages", a->dropped);
+    }
+
+    pthread_cond_destroy(&a->wake);
+    pthread_mutex_destroy(&a->lock);
+    free(a->records);
+    free(a);
+
+    return GC_OK;
+}
+
+unsigned long long hm_log_dropped(struct hm_log_s *l)
+{
+    if(l->async == NULL) {
+        return 0;
+    }
+
+    return __atomic_load_n(&l->async->dropped, __ATOMIC_RELAXED);
+}
+
+static size_t trace_sites_size()
+{
+    struct hm_log_site_s *site;
+    size_t n = 0;
+
+    for(site = __start_hm_log_sites; site < __stop_hm_log_sites; site++) {
+        n += HM_TRACE_ALIGN(4 * sizeof(uint32_t) + strlen(site->file) +
+                            strlen(site->func) + strlen(site->fmt));
+    }
+
+    return n;
+}
+
+static void trace_sites(char *dst)
+{
+    struct hm_log_site_s *site;
+
+    for(site = __start_hm_log_sites; site < __stop_hm_log_sites; site++) {
+        uint32_t hdr[2] = { site->level, site->line };
+        uint16_t len[4] = { strlen(site->file), strlen(site->func), strlen(site->fmt), 0 };
+        char *start = dst;
+
+        memcpy(dst, hdr, sizeof(hdr));
+        dst += sizeof(hdr);
+        memcpy(dst, len, sizeof(len));
+        dst += sizeof(len);
+        memcpy(dst, site->file, len[0]);
+        dst += len[0];
+        memcpy(dst, site->func, len[1]);
+        dst += len[1];
+        memcpy(dst, site->fmt, len[2]);
+        dst = start + HM_TRACE_ALIGN(dst + len[2] - start);
+
+        trace_parse(site);
+    }
+}
+
+int hm_log_trace_open(struct hm_log_s *l, const char *filename, size_t size,
+                      enum loglevel_e level)
+{
+    struct hm_log_trace_s *t;
+    size_t nsites;
+
+    if(l->trace || filename == NULL || size < HM_TRACE_RECORD) {
+        return GC_ERROR;
+    }
+
+    t = malloc(sizeof(*t));
+    if(t == NULL) {
+        return GC_ERROR;
+    }
+
+    size = HM_TRACE_ALIGN(size);
+    nsites = trace_sites_size();
+    t->nmap = sizeof(struct hm_log_trace_hdr_s) + nsites + size;
+
+    t->fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(t->fd == -1) {
+        free(t);
+        return GC_ERROR;
+    }
+
+    if(ftruncate(t->fd, t->nmap) != 0) {
+        close(t->fd);
+        free(t);
+        return GC_ERROR;
+    }
+
+    t->map = mmap(NULL, t->nmap, PROT_READ | PROT_WRITE, MAP_SHARED, t->fd, 0);
+    if(t->map == MAP_FAILED) {
+        close(t->fd);
+        free(t);
+        return GC_ERROR;
+    }
+
+    t->hdr  = (struct hm_log_trace_hdr_s *)t->map;
+    t->ring = t->map + sizeof(*t->hdr) + nsites;
+
+    memset(t->hdr, 0, sizeof(*t->hdr));
+    memcpy(t->hdr->magic, HM_TRACE_MAGIC, sizeof(HM_TRACE_MAGIC));
+    t->hdr->version   = HM_TRACE_VERSION;
+    t->hdr->nsites    = __stop_hm_log_sites - __start_hm_log_sites;
+    t->hdr->sites     = sizeof(*t->hdr);
+    t->hdr->ring      = sizeof(*t->hdr) + nsites;
+    t->hdr->size      = size;
+    t->hdr->realtime  = trace_ns(CLOCK_REALTIME);
+    t->hdr->monotonic = trace_ns(CLOCK_MONOTONIC);
+
+    trace_sites(t->map + t->hdr->sites);
+
+    l->trace = t;
+    if(level > l->limit) {
+        l->limit = level;
+    }
+
+    return GC_OK;
+}
+
+int hm_log_trace_close(struct hm_log_s *l)
+{
+    struct hm_log_trace_s *t = l->trace;
+
+    if(t == NULL) {
+        return GC_ERROR;
+    }
+
+    l->trace = NULL;
+    l->limit = l->level;
+
+    munmap(t->map, t->nmap);
+    close(t->fd);
+    free(t);
+
+    return GC_OK;
+}
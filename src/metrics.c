@@ -0,0 +1,667 @@
+/*
+ *
+ * GrizzlyCloud library - simplified VPN alternative for IoT
+ * Copyright (C) 2017 - 2018 Filip Pancik
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <gc.h>
+
+#define METRICS_CHUNK   4096
+
+static const char *latency_stages[GC_LATENCY_MAX] = {
+    [GC_LATENCY_LOCAL_RECV]     = "local_recv",
+    [GC_LATENCY_SERIALIZE]      = "serialize",
+    [GC_LATENCY_UPSTREAM_QUEUE] = "upstream_queue",
+    [GC_LATENCY_SSL_WRITE]      = "ssl_write",
+    [GC_LATENCY_DELIVER]        = "deliver",
+};
+
+static const double latency_quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+
+unsigned long long gc_metrics_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int histogram_bucket(unsigned long long value)
+{
+    if(value < GC_HISTOGRAM_SUB) return value;
+    if(value >> GC_HISTOGRAM_MAX_BITS) return GC_HISTOGRAM_BUCKETS - 1;
+
+    int shift = 63 - __builtin_clzll(value) - GC_HISTOGRAM_SUB_BITS;
+
+    return (shift + 1) * GC_HISTOGRAM_SUB + (int)(value >> shift) - GC_HISTOGRAM_SUB;
+}
+
+static unsigned long long histogram_highest(int bucket)
+{
+    if(bucket < GC_HISTOGRAM_SUB) return bucket;
+
+    int shift = bucket / GC_HISTOGRAM_SUB - 1;
+    unsigned long long sub = bucket % GC_HISTOGRAM_SUB + GC_HISTOGRAM_SUB;
+
+    return ((sub + 1) << shift) - 1;
+}
+
+void gc_histogram_record(struct gc_histogram_s *h, unsigned long long value)
+{
+    h->buckets[histogram_bucket(value)]++;
+    h->count++;
+    h->sum += value;
+    if(value > h->max) h->max = value;
+}
+
+unsigned long long gc_histogram_percentile(const struct gc_histogram_s *h, double p)
+{
+    unsigned long long target, seen = 0;
+    int i;
+
+    if(h->count == 0) return 0;
+
+    target = (unsigned long long)ceil(p / 100.0 * h->count);
+    if(target < 1) target = 1;
+
+    for(i = 0; i < GC_HISTOGRAM_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if(seen >= target) break;
+    }
+
+    unsigned long long value = histogram_highest(i);
+
+    return value < h->max ? value : h->max;
+}
+
+extern struct gc_loop_site_s __start_gc_loop_sites[] __attribute__((weak));
+extern struct gc_loop_site_s __stop_gc_loop_sites[] __attribute__((weak));
+
+static void loop_prepare(struct ev_loop *loop, struct ev_prepare *w, int revents)
+{
+    (void )loop;
+    (void )revents;
+
+    struct gc_loop_stats_s *ls = w->data;
+
+    if(ls->woke == 0) return;
+
+    gc_histogram_record(&ls->lag, gc_metrics_now() - ls->woke);
+    ls->woke = 0;
+}
+
+static void loop_check(struct ev_loop *loop, struct ev_check *w, int revents)
+{
+    (void )loop;
+    (void )revents;
+
+    struct gc_loop_stats_s *ls = w->data;
+
+    ls->woke = gc_metrics_now();
+}
+
+void gc_loop_stats_start(struct gc_s *gc, int slow)
+{
+    struct gc_loop_stats_s *ls = &gc->metrics.loop;
+
+    ls->slow = (unsigned long long)(slow > 0 ? slow : GC_LOOP_SLOW_MS) * 1000000ULL;
+
+    ev_prepare_init(&ls->prepare, loop_prepare);
+    ls->prepare.data = ls;
+    ev_prepare_start(gc->loop, &ls->prepare);
+
+    ev_check_init(&ls->check, loop_check);
+    ls->check.data = ls;
+    ev_check_start(gc->loop, &ls->check);
+
+    // Watchers don't keep loop alive
+    ev_unref(gc->loop);
+    ev_unref(gc->loop);
+}
+
+void gc_loop_stats_stop(struct gc_s *gc)
+{
+    struct gc_loop_stats_s *ls = &gc->metrics.loop;
+
+    if(!ev_is_active(&ls->prepare)) return;
+
+    ev_ref(gc->loop);
+    ev_ref(gc->loop);
+
+    ev_prepare_stop(gc->loop, &ls->prepare);
+    ev_check_stop(gc->loop, &ls->check);
+}
+
+void gc_loop_enter(struct gc_loop_call_s *call)
+{
+    if(call->gc) call->gc->metrics.loop.depth++;
+}
+
+void gc_loop_leave(struct gc_loop_call_s *call)
+{
+    struct gc_loop_site_s *site = call->site;
+    unsigned long long ns = gc_metrics_now() - call->start;
+
+    site->calls++;
+    site->ns += ns;
+    if(ns > site->max) site->max = ns;
+
+    if(!call->gc) return;
+
+    struct gc_loop_stats_s *ls = &call->gc->metrics.loop;
+
+    if(--ls->depth == 0) {
+        gc_histogram_record(&ls->callbacks, ns);
+    }
+
+    if(ls->slow && ns >= ls->slow) {
+        site->slow++;
+        hm_log(LOG_WARNING, &call->gc->log, "Slow callback %s() at %s:%d took %.1f ms",
+                                            site->func, site->file, site->line, ns / 1e6);
+    }
+}
+
+struct gc_metrics_traffic_s *gc_metrics_endpoint(struct gc_s *gc, int port)
+{
+    struct gc_metrics_port_s *mp;
+
+    for(mp = gc->metrics.endpoints; mp != NULL; mp = mp->next) {
+        if(mp->port == port) {
+            return &mp->traffic;
+        }
+    }
+
+    mp = hm_palloc(gc->pool, sizeof(*mp));
+    if(!mp) return NULL;
+
+    memset(mp, 0, sizeof(*mp));
+    mp->port = port;
+
+    mp->next = gc->metrics.endpoints;
+    gc->metrics.endpoints = mp;
+
+    return &mp->traffic;
+}
+
+int gc_metrics_printf(struct gc_metrics_out_s *o, const char *fmt, ...)
+{
+    va_list args;
+    int n;
+
+    for(;;) {
+        int avail = o->size - o->n;
+
+        va_start(args, fmt);
+        n = vsnprintf(o->s ? o->s + o->n : NULL, avail, fmt, args);
+        va_end(args);
+
+        if(n < 0) return GC_ERROR;
+        if(n < avail) break;
+
+        int size = o->size + (n < METRICS_CHUNK ? METRICS_CHUNK : n + 1);
+        char *s = hm_prealloc(o->pool, o->s, size);
+        if(!s) return GC_ERROR;
+
+        o->s = s;
+        o->size = size;
+    }
+
+    o->n += n;
+
+    return GC_OK;
+}
+
+/*
+ * Label values are user supplied, escape characters
+ * that would break the exposition format.
+ */
+static void label(char *dst, int size, snb src)
+{
+    int i, j = 0;
+
+    for(i = 0; i < src.n && j < size - 2; i++) {
+        char c = src.s[i];
+        if(c == '\\' || c == '"' || c == '\n') {
+            dst[j++] = '\\';
+            c = (c == '\n') ? 'n' : c;
+        }
+        dst[j++] = c;
+    }
+
+    dst[j] = '\0';
+}
+
+static void family(struct gc_metrics_out_s *o, const char *name,
+                   const char *type, const char *help)
+{
+    gc_metrics_printf(o, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+static void render_upstream(struct gc_s *gc, struct gc_metrics_out_s *o)
+{
+    struct gc_metrics_s *m = &gc->metrics;
+
+    family(o, "gc_upstream_connects_total", "counter", "Upstream connection attempts.");
+    gc_metrics_printf(o, "gc_upstream_connects_total %llu\n", m->upstream_connects);
+
+    family(o, "gc_upstream_disconnects_total", "counter", "Upstream connections lost.");
+    gc_metrics_printf(o, "gc_upstream_disconnects_total %llu\n", m->upstream_disconnects);
+
+    family(o, "gc_upstream_bytes_total", "counter", "Bytes exchanged with upstream.");
+    gc_metrics_printf(o, "gc_upstream_bytes_total{direction=\"in\"} %llu\n", m->upstream_bytes_in);
+    gc_metrics_printf(o, "gc_upstream_bytes_total{direction=\"out\"} %llu\n", m->upstream_bytes_out);
+
+    family(o, "gc_upstream_frames_total", "counter", "Frames exchanged with upstream.");
+    gc_metrics_printf(o, "gc_upstream_frames_total{direction=\"in\"} %llu\n", m->upstream_frames_in);
+    gc_metrics_printf(o, "gc_upstream_frames_total{direction=\"out\"} %llu\n", m->upstream_frames_out);
+
+    family(o, "gc_upstream_queue_bytes", "gauge", "Bytes waiting to be written to upstream.");
+    gc_metrics_printf(o, "gc_upstream_queue_bytes %d\n",
+                      gc_ringbuffer_send_pending(&gc->client.base.rb) + gc->batch.buf.n);
+}
+
+#define TRAFFIC(m_field) offsetof(struct gc_metrics_traffic_s, m_field)
+#define NODIR            ((size_t)-1)
+
+/**
+ * @brief Metric family rendered from traffic counters.
+ *
+ */
+static const struct {
+    const char *suffix;     /**< Name after prefix. */
+    const char *type;       /**< Prometheus type. */
+    const char *help;       /**< Help text, completed by subject. */
+    size_t     in;          /**< Counter offset, inbound if family has direction. */
+    size_t     out;         /**< Outbound counter offset or NODIR. */
+} traffic_families[] = {
+    { "bytes_total",       "counter", "Bytes exchanged with",           TRAFFIC(bytes_in),   TRAFFIC(bytes_out)   },
+    { "packets_total",     "counter", "Socket reads and writes on",     TRAFFIC(packets_in), TRAFFIC(packets_out) },
+    { "connections_total", "counter", "Connections opened to",          TRAFFIC(accepted),   NODIR                },
+    { "connections",       "gauge",   "Connections open to",            TRAFFIC(active),     NODIR                },
+    { "queue_bytes",       "gauge",   "Bytes waiting to be written to", TRAFFIC(queued),     NODIR                },
+};
+
+#define COUNTER(m_t, m_off) (*(unsigned long long *)((char *)(m_t) + (m_off)))
+
+static void traffic_header(struct gc_metrics_out_s *o, const char *prefix,
+                           const char *what, int f)
+{
+    gc_metrics_printf(o, "# HELP %s_%s %s %s.\n# TYPE %s_%s %s\n",
+                      prefix, traffic_families[f].suffix, traffic_families[f].help, what,
+                      prefix, traffic_families[f].suffix, traffic_families[f].type);
+}
+
+static void traffic_sample(struct gc_metrics_out_s *o, const char *prefix, int f,
+                           const char *labels, struct gc_metrics_traffic_s *t)
+{
+    const char *suffix = traffic_families[f].suffix;
+
+    if(traffic_families[f].out == NODIR) {
+        gc_metrics_printf(o, "%s_%s{%s} %llu\n", prefix, suffix, labels,
+                          COUNTER(t, traffic_families[f].in));
+        return;
+    }
+
+    gc_metrics_printf(o, "%s_%s{%s,direction=\"in\"} %llu\n", prefix, suffix, labels,
+                      COUNTER(t, traffic_families[f].in));
+    gc_metrics_printf(o, "%s_%s{%s,direction=\"out\"} %llu\n", prefix, suffix, labels,
+                      COUNTER(t, traffic_families[f].out));
+}
+
+static void tunnel_labels(struct gc_tunnel_s *t, char *dst, int size)
+{
+    char cloud[64], device[64], remote[16], local[16];
+
+    label(cloud,  sizeof(cloud),  t->cloud);
+    label(device, sizeof(device), t->device);
+    label(remote, sizeof(remote), t->port_remote);
+    label(local,  sizeof(local),  t->port_local);
+
+    snprintf(dst, size, "cloud=\"%s\",device=\"%s\",port_remote=\"%s\",port_local=\"%s\"",
+                        cloud, device, remote, local);
+}
+
+static void render_tunnels(struct gc_s *gc, struct gc_metrics_out_s *o)
+{
+    struct gc_tunnel_s *t;
+    struct gc_gen_client_s *c;
+    char labels[256];
+    unsigned int f;
+
+    for(t = gc_tunnels(gc); t != NULL; t = t->next) {
+        t->traffic.queued = 0;
+        if(!t->server) continue;
+
+        for(c = t->server->clients; c != NULL; c = c->next) {
+            t->traffic.queued += gc_ringbuffer_send_pending(&c->base.rb);
+        }
+    }
+
+    for(f = 0; f < sizeof(traffic_families) / sizeof(traffic_families[0]); f++) {
+        traffic_header(o, "gc_tunnel", "local tunnel clients", f);
+
+        for(t = gc_tunnels(gc); t != NULL; t = t->next) {
+            tunnel_labels(t, labels, sizeof(labels));
+            traffic_sample(o, "gc_tunnel", f, labels, &t->traffic);
+        }
+    }
+}
+
+static void render_endpoints(struct gc_s *gc, struct gc_metrics_out_s *o)
+{
+    struct gc_metrics_port_s *mp;
+    struct gc_connpool_s *cp;
+    char labels[32];
+    unsigned int f;
+
+    gc_endpoint_metrics(gc);
+
+    for(f = 0; f < sizeof(traffic_families) / sizeof(traffic_families[0]); f++) {
+        traffic_header(o, "gc_endpoint", "backend ports", f);
+
+        for(mp = gc->metrics.endpoints; mp != NULL; mp = mp->next) {
+            snprintf(labels, sizeof(labels), "port=\"%d\"", mp->port);
+            traffic_sample(o, "gc_endpoint", f, labels, &mp->traffic);
+        }
+    }
+
+    family(o, "gc_connpool_idle", "gauge", "Idle backend connections kept for reuse.");
+    for(cp = gc->connpools; cp != NULL; cp = cp->next) {
+        gc_metrics_printf(o, "gc_connpool_idle{port=\"%d\"} %d\n", cp->port, cp->nidle);
+    }
+
+    family(o, "gc_connpool_hits_total", "counter", "Streams served by pooled connection.");
+    for(cp = gc->connpools; cp != NULL; cp = cp->next) {
+        gc_metrics_printf(o, "gc_connpool_hits_total{port=\"%d\"} %llu\n", cp->port, cp->hits);
+    }
+
+    family(o, "gc_connpool_misses_total", "counter", "Streams that needed a new backend connection.");
+    for(cp = gc->connpools; cp != NULL; cp = cp->next) {
+        gc_metrics_printf(o, "gc_connpool_misses_total{port=\"%d\"} %llu\n", cp->port, cp->misses);
+    }
+}
+
+static void summary(struct gc_metrics_out_s *o, const char *name,
+                    const char *labels, struct gc_histogram_s *h)
+{
+    unsigned int q;
+    int any = *labels != '\0';
+
+    for(q = 0; q < sizeof(latency_quantiles) / sizeof(latency_quantiles[0]); q++) {
+        gc_metrics_printf(o, "%s{%s%squantile=\"%g\"} %.9f\n", name,
+                          labels, any ? "," : "", latency_quantiles[q],
+                          gc_histogram_percentile(h, latency_quantiles[q] * 100.0) / 1e9);
+    }
+
+    gc_metrics_printf(o, "%s_sum%s%s%s %.9f\n", name, any ? "{" : "", labels, any ? "}" : "",
+                      h->sum / 1e9);
+    gc_metrics_printf(o, "%s_count%s%s%s %llu\n", name, any ? "{" : "", labels, any ? "}" : "",
+                      h->count);
+}
+
+static void render_latency(struct gc_s *gc, struct gc_metrics_out_s *o)
+{
+    char labels[32];
+    unsigned int i;
+
+    family(o, "gc_latency_seconds", "summary", "Time spent by data inside library.");
+
+    for(i = 0; i < GC_LATENCY_MAX; i++) {
+        snprintf(labels, sizeof(labels), "stage=\"%s\"", latency_stages[i]);
+        summary(o, "gc_latency_seconds", labels, &gc->metrics.latency[i]);
+    }
+}
+
+static void render_loop(struct gc_s *gc, struct gc_metrics_out_s *o)
+{
+    struct gc_loop_stats_s *ls = &gc->metrics.loop;
+    struct gc_loop_site_s *site;
+    char labels[256];
+
+    family(o, "gc_loop_lag_seconds", "summary", "Time from loop wake-up until it can wait for events again.");
+    summary(o, "gc_loop_lag_seconds", "", &ls->lag);
+
+    family(o, "gc_loop_callback_seconds", "summary", "Wall time of callbacks invoked by event loop.");
+    summary(o, "gc_loop_callback_seconds", "", &ls->callbacks);
+
+#define SITES(m_name, m_type, m_help, m_fmt, m_value)\
+    family(o, m_name, m_type, m_help);\
+    for(site = __start_gc_loop_sites; site < __stop_gc_loop_sites; site++) {\
+        if(site->calls == 0) continue;\
+        snprintf(labels, sizeof(labels), "callback=\"%s\",site=\"%s:%d\"",\
+                                         site->func, site->file, site->line);\
+        gc_metrics_printf(o, m_name "{%s} " m_fmt "\n", labels, m_value);\
+    }
+
+    SITES("gc_callback_calls_total", "counter", "Invocations of callback.",
+          "%llu", site->calls)
+    SITES("gc_callback_seconds_total", "counter", "Wall time spent in callback.",
+          "%.9f", site->ns / 1e9)
+    SITES("gc_callback_max_seconds", "gauge", "Longest invocation of callback.",
+          "%.9f", site->max / 1e9)
+    SITES("gc_callback_slow_total", "counter", "Invocations of callback over slow threshold.",
+          "%llu", site->slow)
+
+#undef SITES
+}
+
+static void render_pool(struct gc_s *gc, struct gc_metrics_out_s *o)
+{
+    struct hm_pool_s *p = gc->pool;
+
+    family(o, "gc_pool_allocations", "gauge", "Live allocations of memory pool.");
+    gc_metrics_printf(o, "gc_pool_allocations %llu\n", p->allocs - p->frees);
+
+    family(o, "gc_pool_allocations_total", "counter", "Allocations served by memory pool.");
+    gc_metrics_printf(o, "gc_pool_allocations_total %llu\n", p->allocs);
+
+    int n;
+    if(hm_pool_sites(&n) == NULL) return;
+
+    unsigned long long peak, bytes = hm_pool_usage(&peak);
+
+    family(o, "gc_pool_bytes", "gauge", "Live bytes allocated by library.");
+    gc_metrics_printf(o, "gc_pool_bytes %llu\n", bytes);
+
+    family(o, "gc_pool_bytes_peak", "gauge", "High-water mark of live bytes.");
+    gc_metrics_printf(o, "gc_pool_bytes_peak %llu\n", peak);
+}
+
+static int site_cmp(const void *a, const void *b)
+{
+    const struct hm_pool_site_s *x = *(struct hm_pool_site_s * const *)a;
+    const struct hm_pool_site_s *y = *(struct hm_pool_site_s * const *)b;
+
+    return (x->bytes < y->bytes) - (x->bytes > y->bytes);
+}
+
+/*
+ * Subsystem is name of source file the allocation comes from.
+ */
+static int site_subsystem(const struct hm_pool_site_s *site, const char **name)
+{
+    const char *s = strrchr(site->file, '/');
+    s = s ? s + 1 : site->file;
+
+    const char *dot = strrchr(s, '.');
+    *name = s;
+
+    return dot ? (int)(dot - s) : (int)strlen(s);
+}
+
+int gc_metrics_pool_report(struct gc_s *gc, struct gc_metrics_out_s *o)
+{
+    struct hm_pool_site_s *sites, **sorted;
+    unsigned long long bytes, peak;
+    int i, n, nsorted = 0;
+
+    sites = hm_pool_sites(&n);
+    if(!sites) {
+        gc_metrics_printf(o, "Allocation accounting is off, build with -DPOOL_ACCOUNTING.\n");
+        return o->s ? GC_OK : GC_ERROR;
+    }
+
+    bytes = hm_pool_usage(&peak);
+    gc_metrics_printf(o, "live bytes: %llu peak bytes: %llu\n\n", bytes, peak);
+    gc_metrics_printf(o, "%12s %8s %12s %10s  %-12s %s\n",
+                      "bytes", "count", "peak", "allocs", "subsystem", "site");
+
+    sorted = hm_palloc(gc->pool, n * sizeof(*sorted));
+    if(!sorted) return GC_ERROR;
+
+    for(i = 0; i < n; i++) {
+        if(sites[i].allocs > 0) sorted[nsorted++] = &sites[i];
+    }
+
+    qsort(sorted, nsorted, sizeof(*sorted), site_cmp);
+
+    for(i = 0; i < nsorted; i++) {
+        const char *name;
+        int nname = site_subsystem(sorted[i], &name);
+
+        gc_metrics_printf(o, "%12llu %8llu %12llu %10llu  %-12.*s %s:%d %s()\n",
+                          sorted[i]->bytes, sorted[i]->count,
+                          sorted[i]->peak, sorted[i]->allocs,
+                          nname, name, sorted[i]->file, sorted[i]->line, sorted[i]->func);
+    }
+
+    hm_pfree(gc->pool, sorted);
+
+    return o->s ? GC_OK : GC_ERROR;
+}
+
+int gc_metrics_render(struct gc_s *gc, struct gc_metrics_out_s *o)
+{
+    render_upstream(gc, o);
+    render_tunnels(gc, o);
+    render_endpoints(gc, o);
+    render_latency(gc, o);
+    render_loop(gc, o);
+    render_pool(gc, o);
+
+    return o->s ? GC_OK : GC_ERROR;
+}
+
+static void admin_reply(struct gc_gen_client_s *client, const char *status,
+                        struct gc_metrics_out_s *body)
+{
+    char header[128];
+    int n = snprintf(header, sizeof(header), "HTTP/1.0 %s\r\n"
+                                             "Content-Type: text/plain; version=0.0.4\r\n"
+                                             "Content-Length: %d\r\n"
+                                             "Connection: close\r\n\r\n",
+                                             status, body->n);
+
+    gc_gen_ev_send(client, header, n);
+    if(body->n > 0) {
+        gc_gen_ev_send(client, body->s, body->n);
+    }
+}
+
+static int admin_path(const char *buf, int len, const char *line)
+{
+    int n = strlen(line);
+
+    return len >= n && memcmp(buf, line, n) == 0;
+}
+
+static void admin_data(struct gc_gen_client_s *client, char *buf, const int len)
+{
+    struct gc_s *gc = client->base.gc;
+    struct gc_metrics_out_s body = { .pool = gc->pool };
+    const char *status = "200 OK";
+    int ret = GC_OK;
+
+    // Reply once, ignore rest of request
+    if(client->stream.eof_sent) return;
+
+    if(admin_path(buf, len, "GET /metrics ") || admin_path(buf, len, "GET / ")) {
+        ret = gc_metrics_render(gc, &body);
+    } else if(admin_path(buf, len, "GET /pool ")) {
+        ret = gc_metrics_pool_report(gc, &body);
+    } else {
+        status = "404 Not Found";
+    }
+
+    if(ret != GC_OK) {
+        status = "500 Internal Server Error";
+        body.n = 0;
+    }
+
+    admin_reply(client, status, &body);
+
+    if(body.s) hm_pfree(gc->pool, body.s);
+
+    hm_log(LOG_TRACE, client->base.log, "{Metrics}: served %d bytes on fd %d",
+                                        body.n, client->base.fd);
+
+    // Close once response is drained
+    gc_stream_eof(client);
+    gc_stream_peer_eof(client);
+}
+
+int gc_metrics_admin_start(struct gc_s *gc, int port)
+{
+    struct gc_gen_server_s *s;
+
+    s = hm_palloc(gc->pool, sizeof(*s));
+    if(!s) return GC_ERROR;
+
+    memset(s, 0, sizeof(*s));
+
+    snprintf(gc->metrics.admin_port, sizeof(gc->metrics.admin_port), "%d", port);
+
+    s->loop = gc->loop;
+    s->log  = &gc->log;
+    s->pool = gc->pool;
+    s->callback.data = admin_data;
+    s->host = GC_ADMIN_HOST;
+    s->port = gc->metrics.admin_port;
+
+    if(async_server(s, gc, NULL) != GC_OK) {
+        hm_pfree(gc->pool, s);
+        return GC_ERROR;
+    }
+
+    gc->metrics.admin = s;
+
+    hm_log(LOG_INFO, &gc->log, "Serving metrics on %s:%d", GC_ADMIN_HOST, port);
+
+    return GC_OK;
+}
+
+void gc_metrics_admin_stop(struct gc_s *gc)
+{
+    if(!gc->metrics.admin) return;
+
+    async_server_shutdown(gc->metrics.admin);
+    gc->metrics.admin = NULL;
+}
+
+void gc_metrics_free(struct gc_s *gc)
+{
+    struct gc_metrics_port_s *mp, *del;
+
+    gc_metrics_admin_stop(gc);
+
+    for(mp = gc->metrics.endpoints; mp != NULL; ) {
+        del = mp;
+        mp = mp->next;
+        hm_pfree(gc->pool, del);
+    }
+
+    gc->metrics.endpoints = NULL;
+}
@@ -36,6 +36,7 @@ static int curl_request(struct gc_gen_client_s *client,
 {
     CURL *curl;
     CURLcode res;
+    gc_loop_watch(client->base.gc);
 
     curl_global_init(CURL_GLOBAL_ALL);
 
@@ -0,0 +1,244 @@
+/*
+ *
+ * GrizzlyCloud library - simplified VPN alternative for IoT
+ * Copyright (C) 2017 - 2018 Filip Pancik
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <gc.h>
+
+#define BIT_SET(m_map, m_bit)   ((m_map)[(m_bit) >> 3] |= (1 << ((m_bit) & 7)))
+#define BIT_GET(m_map, m_bit)   ((m_map)[(m_bit) >> 3] & (1 << ((m_bit) & 7)))
+
+static int parse_port(const char *s, const char **end)
+{
+    char *e;
+    long port = strtol(s, &e, 10);
+
+    if(e == s || port < 1 || port >= GC_POLICY_PORTS) {
+        return -1;
+    }
+
+    *end = e;
+
+    return (int)port;
+}
+
+static int parse_range(struct json_object *obj, int *min, int *max)
+{
+    const char *s, *end;
+
+    switch(json_object_get_type(obj)) {
+        case json_type_int:
+            *min = *max = json_object_get_int(obj);
+            break;
+
+        case json_type_string:
+            s = json_object_get_string(obj);
+
+            *min = parse_port(s, &end);
+            if(*min == -1) return GC_ERROR;
+
+            if(*end == '-') {
+                *max = parse_port(end + 1, &end);
+                if(*max == -1) return GC_ERROR;
+            } else {
+                *max = *min;
+            }
+
+            if(*end != '\0') return GC_ERROR;
+            break;
+
+        default:
+            return GC_ERROR;
+    }
+
+    if(*min < 1 || *max >= GC_POLICY_PORTS || *min > *max) {
+        return GC_ERROR;
+    }
+
+    return GC_OK;
+}
+
+static int compile_rule(struct hm_pool_s *pool, struct gc_policy_s *policy,
+                        struct json_object *item)
+{
+    struct json_object *cloud = NULL, *device = NULL, *port = NULL;
+    int min, max;
+
+    json_object_object_get_ex(item, "cloud",  &cloud);
+    json_object_object_get_ex(item, "device", &device);
+    if(!json_object_object_get_ex(item, "port", &port)) {
+        json_object_object_get_ex(item, "ports", &port);
+    }
+
+    if(parse_range(port, &min, &max) != GC_OK) {
+        return GC_ERROR;
+    }
+
+    sn_initr(sncloud,  (char *)json_object_get_string(cloud),
+                       cloud ? json_object_get_string_len(cloud) : 0);
+    sn_initr(sndevice, (char *)json_object_get_string(device),
+                       device ? json_object_get_string_len(device) : 0);
+
+    struct gc_policy_rule_s *rule = hm_palloc(pool, sizeof(*rule));
+    if(!rule) return GC_ERROR;
+
+    memset(rule, 0, sizeof(*rule));
+
+    if(sncloud.n > (int)sizeof(rule->cloud.s) ||
+       sndevice.n > (int)sizeof(rule->device.s)) {
+        hm_pfree(pool, rule);
+        return GC_ERROR;
+    }
+
+    snb_cpy_ds(rule->cloud,  sncloud);
+    snb_cpy_ds(rule->device, sndevice);
+    rule->port_min = min;
+    rule->port_max = max;
+
+    rule->next = policy->rules;
+    policy->rules = rule;
+    policy->nrules++;
+
+    return GC_OK;
+}
+
+static int compile_item(struct hm_pool_s *pool, struct gc_policy_s *policy,
+                        struct json_object *item)
+{
+    struct json_object *range = item;
+    int min, max, port;
+
+    if(json_object_get_type(item) == json_type_object) {
+        struct json_object *tmp;
+
+        // Without cloud and device it's just another open port
+        if(json_object_object_get_ex(item, "cloud", &tmp) ||
+           json_object_object_get_ex(item, "device", &tmp)) {
+            return compile_rule(pool, policy, item);
+        }
+
+        if(!json_object_object_get_ex(item, "port", &range)) {
+            json_object_object_get_ex(item, "ports", &range);
+        }
+    }
+
+    if(parse_range(range, &min, &max) != GC_OK) {
+        return GC_ERROR;
+    }
+
+    for(port = min; port <= max; port++) {
+        if(!BIT_GET(policy->ports, port)) {
+            BIT_SET(policy->ports, port);
+            policy->nports++;
+        }
+    }
+
+    return GC_OK;
+}
+
+int gc_policy_compile(struct hm_pool_s *pool, struct gc_policy_s *policy,
+                      struct json_object *allow, struct hm_log_s *log)
+{
+    int i, n = 0;
+
+    assert(policy);
+
+    if(json_object_get_type(allow) != json_type_array) {
+        return 0;
+    }
+
+    array_list *allow_array = json_object_get_array(allow);
+    int nallow = array_list_length(allow_array);
+
+    for(i = 0; i < nallow; i++) {
+        struct json_object *item = array_list_get_idx(allow_array, i);
+
+        if(compile_item(pool, policy, item) != GC_OK) {
+            hm_log(LOG_WARNING, log, "Ignoring malformed allow element [%s]",
+                                     json_object_to_json_string(item));
+            continue;
+        }
+
+        n++;
+    }
+
+    return n;
+}
+
+int gc_policy_check(struct gc_policy_s *policy, sn cloud, sn device, int port)
+{
+    struct gc_policy_rule_s *rule;
+
+    if(port < 1 || port >= GC_POLICY_PORTS) {
+        return GC_ERROR;
+    }
+
+    if(BIT_GET(policy->ports, port)) {
+        return GC_OK;
+    }
+
+    for(rule = policy->rules; rule != NULL; rule = rule->next) {
+        if(port < rule->port_min || port > rule->port_max) continue;
+        if(rule->cloud.n > 0 && !sn_cmps(rule->cloud, cloud)) continue;
+        if(rule->device.n > 0 && !sn_cmps(rule->device, device)) continue;
+
+        return GC_OK;
+    }
+
+    return GC_ERROR;
+}
+
+void gc_policy_dump(struct gc_policy_s *policy, struct hm_log_s *log)
+{
+    struct gc_policy_rule_s *rule;
+    int port, min = 0;
+
+    hm_log(LOG_DEBUG, log, "Allowed ports total: [%d]", policy->nports);
+
+    // Print bitmap as ranges
+    for(port = 1; port <= GC_POLICY_PORTS; port++) {
+        int set = port < GC_POLICY_PORTS && BIT_GET(policy->ports, port);
+
+        if(set && min == 0) {
+            min = port;
+        } else if(!set && min > 0) {
+            if(min == port - 1) hm_log(LOG_DEBUG, log, "Allowed port: [%d]", min);
+            else hm_log(LOG_DEBUG, log, "Allowed ports: [%d-%d]", min, port - 1);
+            min = 0;
+        }
+    }
+
+    for(rule = policy->rules; rule != NULL; rule = rule->next) {
+        hm_log(LOG_DEBUG, log, "Allowed ports: [%d-%d] Cloud: [%.*s] Device: [%.*s]",
+                               rule->port_min, rule->port_max,
+                               sn_p(rule->cloud), sn_p(rule->device));
+    }
+}
+
+void gc_policy_free(struct hm_pool_s *pool, struct gc_policy_s *policy)
+{
+    struct gc_policy_rule_s *rule, *del;
+
+    for(rule = policy->rules; rule != NULL; ) {
+        del = rule;
+        rule = rule->next;
+        hm_pfree(pool, del);
+    }
+
+    policy->rules = NULL;
+    policy->nrules = 0;
+}
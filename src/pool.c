@@ -37,10 +37,98 @@ struct pool_bucket_s {
 
 static int pool_create_bucket(struct hm_pool_s *pool);
 
+// Definitions below are the functions themselves
+#undef hm_palloc
+#undef hm_prealloc
+
+static void *pool_malloc(struct hm_pool_s *pool, size_t size)
+{
+    if(pool && pool->allocator.alloc) {
+        return pool->allocator.alloc(pool->allocator.ctx, size);
+    }
+
+    return malloc(size);
+}
+
+static void *pool_realloc(struct hm_pool_s *pool, void *ptr, size_t size)
+{
+    if(pool && pool->allocator.alloc) {
+        return pool->allocator.realloc(pool->allocator.ctx, ptr, size);
+    }
+
+    return realloc(ptr, size);
+}
+
+static void pool_free(struct hm_pool_s *pool, void *ptr)
+{
+    if(pool && pool->allocator.alloc) {
+        pool->allocator.free(pool->allocator.ctx, ptr);
+        return;
+    }
+
+    free(ptr);
+}
+
+#ifdef POOL_ACCOUNTING
+/**
+ * @brief Header in front of accounted allocation.
+ *
+ * Internal pool structure.
+ */
+struct pool_hdr_s {
+    struct hm_pool_site_s *site;    /**< Owning call site. */
+    size_t                size;     /**< Requested size. */
+};
+
+#define POOL_HDR    ROUND16(sizeof(struct pool_hdr_s))
+
+extern struct hm_pool_site_s __start_hm_palloc_sites[] __attribute__((weak));
+extern struct hm_pool_site_s __stop_hm_palloc_sites[] __attribute__((weak));
+
+// Callers that bypass macros
+static struct hm_pool_site_s pool_unknown
+    __attribute__((section("hm_palloc_sites"), aligned(8), used)) =
+    { 0, "unknown", "unknown", 0, 0, 0, 0 };
+
+static unsigned long long pool_bytes;
+static unsigned long long pool_peak;
+
+static void *pool_account(struct pool_hdr_s *hdr, size_t size, struct hm_pool_site_s *site)
+{
+    hdr->site = site;
+    hdr->size = size;
+
+    site->bytes += size;
+    site->count++;
+    site->allocs++;
+    if(site->bytes > site->peak) site->peak = site->bytes;
+
+    pool_bytes += size;
+    if(pool_bytes > pool_peak) pool_peak = pool_bytes;
+
+    return (char *)hdr + POOL_HDR;
+}
+
+static struct pool_hdr_s *pool_unaccount(void *ptr)
+{
+    struct pool_hdr_s *hdr = (struct pool_hdr_s *)((char *)ptr - POOL_HDR);
+
+    hdr->site->bytes -= hdr->size;
+    hdr->site->count--;
+    pool_bytes -= hdr->size;
+
+    return hdr;
+}
+#endif
+
 int hm_pfree(struct hm_pool_s *pool, void *ptr)
 {
 #ifdef POOL_STDLIB
-    free(ptr);
+    if(ptr && pool) pool->frees++;
+#ifdef POOL_ACCOUNTING
+    if(ptr) ptr = pool_unaccount(ptr);
+#endif
+    pool_free(pool, ptr);
     return 0;
 #endif
 
@@ -64,6 +152,7 @@ int hm_pfree(struct hm_pool_s *pool, void *ptr)
             p->freenode = node;
 
             --p->used;
+            pool->frees++;
 
             return 0;
         }
@@ -107,16 +196,27 @@ static void *pool_get_node(struct hm_pool_s *pool, const int realsize)
 
 /** don't do anything but creating a zero valued holder */
 struct hm_pool_s *hm_create_pool()
+{
+    return hm_create_pool_allocator(NULL);
+}
+
+struct hm_pool_s *hm_create_pool_allocator(const struct hm_allocator_s *allocator)
 {
     struct hm_pool_s *pool;
 
-    pool = malloc(sizeof(*pool));
+    if(allocator && (!allocator->alloc || !allocator->realloc || !allocator->free)) {
+        return NULL;
+    }
+
+    pool = allocator ? allocator->alloc(allocator->ctx, sizeof(*pool)) :
+                       malloc(sizeof(*pool));
 
     if(pool == NULL) {
         return NULL;
     }
 
     memset(pool, 0, sizeof(*pool));
+    if(allocator) pool->allocator = *allocator;
 
     return pool;
 }
@@ -129,16 +229,16 @@ static int pool_create_bucket(struct hm_pool_s *pool)
     struct pool_node_s *node;
 
     /** holder of buckets */
-    b = malloc(sizeof(*b));
+    b = pool_malloc(pool, sizeof(*b));
 
     if(b == NULL) {
         return -1;
     }
 
-    region = malloc((pool->size + sizeof(void *)) * BUCKET_MAX);
+    region = pool_malloc(pool, (pool->size + sizeof(void *)) * BUCKET_MAX);
 
     /** nodes holders */
-    nodes = malloc(BUCKET_MAX * sizeof(struct pool_node_s));
+    nodes = pool_malloc(pool, BUCKET_MAX * sizeof(struct pool_node_s));
 
     if(nodes == NULL) {
         return -1;
@@ -181,7 +281,7 @@ static struct hm_pool_s *pool_create_append(struct hm_pool_s *pool, const int si
 {
     struct hm_pool_s *p, *tp;
 
-    p = malloc(sizeof(*p));
+    p = pool_malloc(pool, sizeof(*p));
 
     if(p == NULL) {
         return NULL;
@@ -193,6 +293,9 @@ static struct hm_pool_s *pool_create_append(struct hm_pool_s *pool, const int si
     p->freenode = NULL;
     p->buckets = NULL;
     p->used = 0;
+    p->allocs = 0;
+    p->frees = 0;
+    p->allocator = pool->allocator;
     p->log = pool->log;
 
     if(pool_create_bucket(p) != 0) {
@@ -219,8 +322,13 @@ static struct hm_pool_s *pool_create_append(struct hm_pool_s *pool, const int si
   */
 void *hm_prealloc(struct hm_pool_s *pool, void *ptr, const int size)
 {
+#ifdef POOL_ACCOUNTING
+    return hm_prealloc_site(pool, ptr, size, &pool_unknown);
+#endif
 #ifdef POOL_STDLIB
-    return realloc(ptr, size);
+    void *re = pool_realloc(pool, ptr, size);
+    if(!ptr && re && pool) pool->allocs++;
+    return re;
 #endif
 
     struct pool_node_s *node = NULL;
@@ -289,11 +397,17 @@ void *hm_prealloc(struct hm_pool_s *pool, void *ptr, const int size)
 
 void *hm_palloc(struct hm_pool_s *pool, int size)
 {
+#ifdef POOL_ACCOUNTING
+    return hm_palloc_site(pool, size, &pool_unknown);
+#endif
 #ifdef POOL_STDLIB
-    return malloc(size);
+    void *mem = pool_malloc(pool, size);
+    if(mem && pool) pool->allocs++;
+    return mem;
 #endif
 
     struct hm_pool_s *p;
+    void *ptr;
 
     assert(pool);
 
@@ -303,7 +417,9 @@ void *hm_palloc(struct hm_pool_s *pool, int size)
 #ifdef POOL_DEBUG
             hm_log(LOG_TRACE, pool->log, "{Pool}: found existing pool: %p/%d", p, p->size);
 #endif
-            return pool_get_node(p, size);
+            ptr = pool_get_node(p, size);
+            if(ptr) pool->allocs++;
+            return ptr;
         }
     }
 
@@ -317,7 +433,75 @@ void *hm_palloc(struct hm_pool_s *pool, int size)
     hm_log(LOG_TRACE, pool->log, "{Pool}: creating new pool with parent pool: %p/%d", p, p->size);
 #endif
 
-    return pool_get_node(p, size);
+    ptr = pool_get_node(p, size);
+    if(ptr) pool->allocs++;
+    return ptr;
+}
+
+void *hm_palloc_site(struct hm_pool_s *pool, int size, struct hm_pool_site_s *site)
+{
+#ifdef POOL_ACCOUNTING
+    struct pool_hdr_s *hdr = pool_malloc(pool, POOL_HDR + size);
+    if(!hdr) return NULL;
+
+    if(pool) pool->allocs++;
+
+    return pool_account(hdr, size, site);
+#else
+    (void )site;
+    return hm_palloc(pool, size);
+#endif
+}
+
+void *hm_prealloc_site(struct hm_pool_s *pool, void *ptr, const int size,
+                       struct hm_pool_site_s *site)
+{
+#ifdef POOL_ACCOUNTING
+    if(ptr == NULL) {
+        return hm_palloc_site(pool, size, site);
+    }
+
+    if(size == 0) {
+        hm_pfree(pool, ptr);
+        return NULL;
+    }
+
+    struct pool_hdr_s *hdr = (struct pool_hdr_s *)((char *)ptr - POOL_HDR);
+    struct pool_hdr_s *re = pool_realloc(pool, hdr, POOL_HDR + size);
+    if(!re) return NULL;
+
+    // Block moves to reallocating site
+    re->site->bytes -= re->size;
+    re->site->count--;
+    pool_bytes -= re->size;
+
+    return pool_account(re, size, site);
+#else
+    (void )site;
+    return hm_prealloc(pool, ptr, size);
+#endif
+}
+
+struct hm_pool_site_s *hm_pool_sites(int *n)
+{
+#ifdef POOL_ACCOUNTING
+    *n = __stop_hm_palloc_sites - __start_hm_palloc_sites;
+    return __start_hm_palloc_sites;
+#else
+    *n = 0;
+    return NULL;
+#endif
+}
+
+unsigned long long hm_pool_usage(unsigned long long *peak)
+{
+#ifdef POOL_ACCOUNTING
+    if(peak) *peak = pool_peak;
+    return pool_bytes;
+#else
+    if(peak) *peak = 0;
+    return 0;
+#endif
 }
 
 int hm_destroy_pool(struct hm_pool_s *pool)
@@ -327,16 +511,16 @@ int hm_destroy_pool(struct hm_pool_s *pool)
 
     for(p = pool; p != NULL; ) {
         for(b = p->buckets; b != NULL; ) {
-            free(b->memory_region);
-            free(b->nodes);
+            pool_free(p, b->memory_region);
+            pool_free(p, b->nodes);
 
             bd = b;
             b = b->next;
-            free(bd);
+            pool_free(p, bd);
         }
         pd = p;
         p = p->next;
-        free(pd);
+        pool_free(pd, pd);
     }
 
     return 0;
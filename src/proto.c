@@ -17,17 +17,9 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  *
  */
-// This file is generated
+// This file is generated by script/proto/protogen.py, do not edit
 #include <gc.h>
 
-#define add_uint(m_pool, m_uint)\
-    { int ret = add_int_intern(m_pool, dst, m_uint);\
-      if(ret != GCPROTO_OK) return ret; }
-
-#define add_bin(m_pool, m_bin, m_nbin)\
-    { int ret = add_intern(m_pool, dst, m_bin, m_nbin);\
-      if(ret != GCPROTO_OK) return ret; }
-
 void gc_proto_dump(struct proto_s *p)
 {
     switch(p->type) {
@@ -132,42 +124,46 @@ void gc_proto_dump(struct proto_s *p)
     }
 }
 
-static int add_intern(struct hm_pool_s *pool, sn *dst, const void *src, const int nsrc)
+static inline char *put_int(char *dst, const int v)
 {
-    assert(dst);
-
-    int offset_0 = dst->n;
-    int offset_1 = dst->n + sizeof(nsrc);
+    /* Network byte order, same as gc_swap_memory() on little endian */
+    dst[0] = (char)((unsigned int)v >> 24);
+    dst[1] = (char)((unsigned int)v >> 16);
+    dst[2] = (char)((unsigned int)v >> 8);
+    dst[3] = (char)((unsigned int)v);
 
-    dst->n += nsrc + sizeof(nsrc);
-    dst->s  = hm_prealloc(pool, dst->s, dst->n);
-
-    assert(dst->s);
+    return dst + sizeof(v);
+}
 
-    (void )memcpy(dst->s + offset_0, &nsrc, sizeof(nsrc));
-    gc_swap_memory(dst->s + offset_0, sizeof(nsrc));
-    (void )memcpy(dst->s + offset_1, src, nsrc);
+static inline char *put_bin(char *dst, sn src)
+{
+    dst = put_int(dst, src.n);
+    if(src.n > 0) (void )memcpy(dst, src.s, src.n);
 
-    return GCPROTO_OK;
+    return dst + src.n;
 }
 
-static int add_int_intern(struct hm_pool_s *pool, sn *dst, int v)
+static inline char *put_ref(char *dst, struct iovec *iov, int *niov, sn src)
 {
-    assert(dst);
-
-    int offset_0 = dst->n;
+    dst = put_int(dst, src.n);
 
-    dst->n += sizeof(v);
-    dst->s  = hm_prealloc(pool, dst->s, dst->n);
+    // Close current header block, reference payload, open next block
+    iov[*niov - 1].iov_len = dst - (char *)iov[*niov - 1].iov_base;
 
-    assert(dst->s);
+    iov[*niov].iov_base = src.s;
+    iov[*niov].iov_len  = src.n;
+    (*niov)++;
 
-    (void )memcpy(dst->s + offset_0, &v, sizeof(v));
-    gc_swap_memory(dst->s + offset_0, sizeof(v));
+    iov[*niov].iov_base = dst;
+    iov[*niov].iov_len  = 0;
+    (*niov)++;
 
-    return GCPROTO_OK;
+    return dst;
 }
 
+#define PROTO_INT_SIZE       ((int)sizeof(int))
+#define PROTO_BIN_SIZE(m_sn) (PROTO_INT_SIZE + (m_sn).n)
+
 static int get_int_intern(sn *src, int *value)
 {
     assert(src);
@@ -210,134 +206,620 @@ static int get_int(sn *src, int *value)
     return get_int_intern(src, (int *)value);
 }
 
+static int size_message_to(struct proto_s *src)
+{
+    return PROTO_BIN_SIZE(src->u.message_to.to) +
+           PROTO_BIN_SIZE(src->u.message_to.address) +
+           PROTO_BIN_SIZE(src->u.message_to.tp) +
+           PROTO_BIN_SIZE(src->u.message_to.body);
+}
+
+static char *write_message_to(char *dst, struct proto_s *src)
+{
+    dst = put_bin(dst, src->u.message_to.to);
+    dst = put_bin(dst, src->u.message_to.address);
+    dst = put_bin(dst, src->u.message_to.tp);
+    dst = put_bin(dst, src->u.message_to.body);
+
+    return dst;
+}
+
+static char *writev_message_to(char *dst, struct iovec *iov, int *niov, struct proto_s *src)
+{
+    dst = put_bin(dst, src->u.message_to.to);
+    dst = put_bin(dst, src->u.message_to.address);
+    dst = put_bin(dst, src->u.message_to.tp);
+    dst = put_ref(dst, iov, niov, src->u.message_to.body);
+
+    return dst;
+}
+
+static int size_message_to_set_reply(struct proto_s *src)
+{
+    if(!(sn_memcmp("ok", 2, src->u.message_to_set_reply.error.s, src->u.message_to_set_reply.error.n) ||
+         sn_memcmp("ok_registered", 13, src->u.message_to_set_reply.error.s, src->u.message_to_set_reply.error.n) ||
+         sn_memcmp("login", 5, src->u.message_to_set_reply.error.s, src->u.message_to_set_reply.error.n) ||
+         sn_memcmp("enoexists", 9, src->u.message_to_set_reply.error.s, src->u.message_to_set_reply.error.n) ||
+         sn_memcmp("general_failure", 15, src->u.message_to_set_reply.error.s, src->u.message_to_set_reply.error.n))) {
+        return -1;
+    }
+
+    return PROTO_BIN_SIZE(src->u.message_to_set_reply.error);
+}
+
+static char *write_message_to_set_reply(char *dst, struct proto_s *src)
+{
+    dst = put_bin(dst, src->u.message_to_set_reply.error);
+
+    return dst;
+}
+
+static int size_account_list(struct proto_s *src)
+{
+    (void )src;
+
+    return 0;
+}
+
+static char *write_account_list(char *dst, struct proto_s *src)
+{
+    (void )src;
+
+    return dst;
+}
+
+static int size_account_list_reply(struct proto_s *src)
+{
+    if(!(sn_memcmp("ok", 2, src->u.account_list_reply.error.s, src->u.account_list_reply.error.n) ||
+         sn_memcmp("general_failure", 15, src->u.account_list_reply.error.s, src->u.account_list_reply.error.n))) {
+        return -1;
+    }
+
+    return PROTO_BIN_SIZE(src->u.account_list_reply.error) +
+           PROTO_BIN_SIZE(src->u.account_list_reply.list);
+}
+
+static char *write_account_list_reply(char *dst, struct proto_s *src)
+{
+    dst = put_bin(dst, src->u.account_list_reply.error);
+    dst = put_bin(dst, src->u.account_list_reply.list);
+
+    return dst;
+}
+
+static int size_traffic_mi(struct proto_s *src)
+{
+    (void )src;
+
+    return 0;
+}
+
+static char *write_traffic_mi(char *dst, struct proto_s *src)
+{
+    (void )src;
+
+    return dst;
+}
+
+static int size_traffic_get(struct proto_s *src)
+{
+    (void )src;
+
+    return 0;
+}
+
+static char *write_traffic_get(char *dst, struct proto_s *src)
+{
+    (void )src;
+
+    return dst;
+}
+
+static int size_traffic_get_reply(struct proto_s *src)
+{
+    if(!(sn_memcmp("ok", 2, src->u.traffic_get_reply.error.s, src->u.traffic_get_reply.error.n) ||
+         sn_memcmp("ok_partial", 10, src->u.traffic_get_reply.error.s, src->u.traffic_get_reply.error.n) ||
+         sn_memcmp("login", 5, src->u.traffic_get_reply.error.s, src->u.traffic_get_reply.error.n) ||
+         sn_memcmp("general_failure", 15, src->u.traffic_get_reply.error.s, src->u.traffic_get_reply.error.n) ||
+         sn_memcmp("denied", 6, src->u.traffic_get_reply.error.s, src->u.traffic_get_reply.error.n) ||
+         sn_memcmp("empty", 5, src->u.traffic_get_reply.error.s, src->u.traffic_get_reply.error.n))) {
+        return -1;
+    }
+
+    return PROTO_BIN_SIZE(src->u.traffic_get_reply.list) +
+           PROTO_BIN_SIZE(src->u.traffic_get_reply.error);
+}
+
+static char *write_traffic_get_reply(char *dst, struct proto_s *src)
+{
+    dst = put_bin(dst, src->u.traffic_get_reply.list);
+    dst = put_bin(dst, src->u.traffic_get_reply.error);
+
+    return dst;
+}
+
+static int size_message_from(struct proto_s *src)
+{
+    return PROTO_BIN_SIZE(src->u.message_from.from_cloud) +
+           PROTO_BIN_SIZE(src->u.message_from.from_device) +
+           PROTO_BIN_SIZE(src->u.message_from.from_address) +
+           PROTO_BIN_SIZE(src->u.message_from.tp) +
+           PROTO_BIN_SIZE(src->u.message_from.body);
+}
+
+static char *write_message_from(char *dst, struct proto_s *src)
+{
+    dst = put_bin(dst, src->u.message_from.from_cloud);
+    dst = put_bin(dst, src->u.message_from.from_device);
+    dst = put_bin(dst, src->u.message_from.from_address);
+    dst = put_bin(dst, src->u.message_from.tp);
+    dst = put_bin(dst, src->u.message_from.body);
+
+    return dst;
+}
+
+static char *writev_message_from(char *dst, struct iovec *iov, int *niov, struct proto_s *src)
+{
+    dst = put_bin(dst, src->u.message_from.from_cloud);
+    dst = put_bin(dst, src->u.message_from.from_device);
+    dst = put_bin(dst, src->u.message_from.from_address);
+    dst = put_bin(dst, src->u.message_from.tp);
+    dst = put_ref(dst, iov, niov, src->u.message_from.body);
+
+    return dst;
+}
+
+static int size_device_pair(struct proto_s *src)
+{
+    return PROTO_BIN_SIZE(src->u.device_pair.cloud) +
+           PROTO_BIN_SIZE(src->u.device_pair.device) +
+           PROTO_BIN_SIZE(src->u.device_pair.local_port) +
+           PROTO_BIN_SIZE(src->u.device_pair.remote_port);
+}
+
+static char *write_device_pair(char *dst, struct proto_s *src)
+{
+    dst = put_bin(dst, src->u.device_pair.cloud);
+    dst = put_bin(dst, src->u.device_pair.device);
+    dst = put_bin(dst, src->u.device_pair.local_port);
+    dst = put_bin(dst, src->u.device_pair.remote_port);
+
+    return dst;
+}
+
+static int size_device_pair_reply(struct proto_s *src)
+{
+    if(!(sn_memcmp("ok", 2, src->u.device_pair_reply.error.s, src->u.device_pair_reply.error.n) ||
+         sn_memcmp("ok_registered", 13, src->u.device_pair_reply.error.s, src->u.device_pair_reply.error.n) ||
+         sn_memcmp("login", 5, src->u.device_pair_reply.error.s, src->u.device_pair_reply.error.n) ||
+         sn_memcmp("general_failure", 15, src->u.device_pair_reply.error.s, src->u.device_pair_reply.error.n))) {
+        return -1;
+    }
+
+    return PROTO_BIN_SIZE(src->u.device_pair_reply.cloud) +
+           PROTO_BIN_SIZE(src->u.device_pair_reply.error) +
+           PROTO_BIN_SIZE(src->u.device_pair_reply.list) +
+           PROTO_BIN_SIZE(src->u.device_pair_reply.type);
+}
+
+static char *write_device_pair_reply(char *dst, struct proto_s *src)
+{
+    dst = put_bin(dst, src->u.device_pair_reply.cloud);
+    dst = put_bin(dst, src->u.device_pair_reply.error);
+    dst = put_bin(dst, src->u.device_pair_reply.list);
+    dst = put_bin(dst, src->u.device_pair_reply.type);
+
+    return dst;
+}
+
+static int size_offline_set(struct proto_s *src)
+{
+    return PROTO_BIN_SIZE(src->u.offline_set.address) +
+           PROTO_BIN_SIZE(src->u.offline_set.cloud) +
+           PROTO_BIN_SIZE(src->u.offline_set.device);
+}
+
+static char *write_offline_set(char *dst, struct proto_s *src)
+{
+    dst = put_bin(dst, src->u.offline_set.address);
+    dst = put_bin(dst, src->u.offline_set.cloud);
+    dst = put_bin(dst, src->u.offline_set.device);
+
+    return dst;
+}
+
+static int size_account_set(struct proto_s *src)
+{
+    return PROTO_BIN_SIZE(src->u.account_set.email) +
+           PROTO_BIN_SIZE(src->u.account_set.password);
+}
+
+static char *write_account_set(char *dst, struct proto_s *src)
+{
+    dst = put_bin(dst, src->u.account_set.email);
+    dst = put_bin(dst, src->u.account_set.password);
+
+    return dst;
+}
+
+static int size_account_set_reply(struct proto_s *src)
+{
+    if(!(sn_memcmp("ok", 2, src->u.account_set_reply.error.s, src->u.account_set_reply.error.n) ||
+         sn_memcmp("denied", 6, src->u.account_set_reply.error.s, src->u.account_set_reply.error.n) ||
+         sn_memcmp("already_exists", 14, src->u.account_set_reply.error.s, src->u.account_set_reply.error.n) ||
+         sn_memcmp("general_failure", 15, src->u.account_set_reply.error.s, src->u.account_set_reply.error.n))) {
+        return -1;
+    }
+
+    return PROTO_BIN_SIZE(src->u.account_set_reply.error);
+}
+
+static char *write_account_set_reply(char *dst, struct proto_s *src)
+{
+    dst = put_bin(dst, src->u.account_set_reply.error);
+
+    return dst;
+}
+
+static int size_account_get(struct proto_s *src)
+{
+    (void )src;
+
+    return 0;
+}
+
+static char *write_account_get(char *dst, struct proto_s *src)
+{
+    (void )src;
+
+    return dst;
+}
+
+static int size_account_login(struct proto_s *src)
+{
+    return PROTO_BIN_SIZE(src->u.account_login.email) +
+           PROTO_BIN_SIZE(src->u.account_login.password) +
+           PROTO_BIN_SIZE(src->u.account_login.devname);
+}
+
+static char *write_account_login(char *dst, struct proto_s *src)
+{
+    dst = put_bin(dst, src->u.account_login.email);
+    dst = put_bin(dst, src->u.account_login.password);
+    dst = put_bin(dst, src->u.account_login.devname);
+
+    return dst;
+}
+
+static int size_account_login_reply(struct proto_s *src)
+{
+    if(!(sn_memcmp("ok", 2, src->u.account_login_reply.error.s, src->u.account_login_reply.error.n) ||
+         sn_memcmp("ok_registered", 13, src->u.account_login_reply.error.s, src->u.account_login_reply.error.n) ||
+         sn_memcmp("version", 7, src->u.account_login_reply.error.s, src->u.account_login_reply.error.n) ||
+         sn_memcmp("try_again", 9, src->u.account_login_reply.error.s, src->u.account_login_reply.error.n) ||
+         sn_memcmp("invalid_login", 13, src->u.account_login_reply.error.s, src->u.account_login_reply.error.n) ||
+         sn_memcmp("general_failure", 15, src->u.account_login_reply.error.s, src->u.account_login_reply.error.n) ||
+         sn_memcmp("already_logged", 14, src->u.account_login_reply.error.s, src->u.account_login_reply.error.n))) {
+        return -1;
+    }
+
+    return PROTO_BIN_SIZE(src->u.account_login_reply.error);
+}
+
+static char *write_account_login_reply(char *dst, struct proto_s *src)
+{
+    dst = put_bin(dst, src->u.account_login_reply.error);
+
+    return dst;
+}
+
+static int size_account_exists(struct proto_s *src)
+{
+    return PROTO_BIN_SIZE(src->u.account_exists.email) +
+           PROTO_BIN_SIZE(src->u.account_exists.password);
+}
+
+static char *write_account_exists(char *dst, struct proto_s *src)
+{
+    dst = put_bin(dst, src->u.account_exists.email);
+    dst = put_bin(dst, src->u.account_exists.password);
+
+    return dst;
+}
+
+static int size_account_exists_reply(struct proto_s *src)
+{
+    if(!(sn_memcmp("ok", 2, src->u.account_exists_reply.error.s, src->u.account_exists_reply.error.n) ||
+         sn_memcmp("invalid_login", 13, src->u.account_exists_reply.error.s, src->u.account_exists_reply.error.n) ||
+         sn_memcmp("general_failure", 15, src->u.account_exists_reply.error.s, src->u.account_exists_reply.error.n))) {
+        return -1;
+    }
+
+    return PROTO_BIN_SIZE(src->u.account_exists_reply.error);
+}
+
+static char *write_account_exists_reply(char *dst, struct proto_s *src)
+{
+    dst = put_bin(dst, src->u.account_exists_reply.error);
+
+    return dst;
+}
+
+static int size_version_mismatch(struct proto_s *src)
+{
+    return PROTO_BIN_SIZE(src->u.version_mismatch.master) +
+           PROTO_BIN_SIZE(src->u.version_mismatch.slave);
+}
+
+static char *write_version_mismatch(char *dst, struct proto_s *src)
+{
+    dst = put_bin(dst, src->u.version_mismatch.master);
+    dst = put_bin(dst, src->u.version_mismatch.slave);
+
+    return dst;
+}
+
+int gc_serialize_size(struct proto_s *src)
+{
+    int n;
+
+    switch(src->type) {
+        case MESSAGE_TO:
+            n = size_message_to(src);
+            break;
+        case MESSAGE_TO_SET_REPLY:
+            n = size_message_to_set_reply(src);
+            break;
+        case ACCOUNT_LIST:
+            n = size_account_list(src);
+            break;
+        case ACCOUNT_LIST_REPLY:
+            n = size_account_list_reply(src);
+            break;
+        case TRAFFIC_MI:
+            n = size_traffic_mi(src);
+            break;
+        case TRAFFIC_GET:
+            n = size_traffic_get(src);
+            break;
+        case TRAFFIC_GET_REPLY:
+            n = size_traffic_get_reply(src);
+            break;
+        case MESSAGE_FROM:
+            n = size_message_from(src);
+            break;
+        case DEVICE_PAIR:
+            n = size_device_pair(src);
+            break;
+        case DEVICE_PAIR_REPLY:
+            n = size_device_pair_reply(src);
+            break;
+        case OFFLINE_SET:
+            n = size_offline_set(src);
+            break;
+        case ACCOUNT_SET:
+            n = size_account_set(src);
+            break;
+        case ACCOUNT_SET_REPLY:
+            n = size_account_set_reply(src);
+            break;
+        case ACCOUNT_GET:
+            n = size_account_get(src);
+            break;
+        case ACCOUNT_LOGIN:
+            n = size_account_login(src);
+            break;
+        case ACCOUNT_LOGIN_REPLY:
+            n = size_account_login_reply(src);
+            break;
+        case ACCOUNT_EXISTS:
+            n = size_account_exists(src);
+            break;
+        case ACCOUNT_EXISTS_REPLY:
+            n = size_account_exists_reply(src);
+            break;
+        case VERSION_MISMATCH:
+            n = size_version_mismatch(src);
+            break;
+
+        default:
+            return -1;
+        break;
+    }
+
+    if(n < 0) {
+        return -1;
+    }
+
+    // version + type
+    return 2 * PROTO_INT_SIZE + n;
+}
+
+int gc_serialize_write(char *dst, struct proto_s *src)
+{
+    char *p = dst;
+
+    p = put_int(p, GCPROTO_VERSION);
+    p = put_int(p, src->type);
+
+    switch(src->type) {
+        case MESSAGE_TO:
+            p = write_message_to(p, src);
+            break;
+        case MESSAGE_TO_SET_REPLY:
+            p = write_message_to_set_reply(p, src);
+            break;
+        case ACCOUNT_LIST:
+            p = write_account_list(p, src);
+            break;
+        case ACCOUNT_LIST_REPLY:
+            p = write_account_list_reply(p, src);
+            break;
+        case TRAFFIC_MI:
+            p = write_traffic_mi(p, src);
+            break;
+        case TRAFFIC_GET:
+            p = write_traffic_get(p, src);
+            break;
+        case TRAFFIC_GET_REPLY:
+            p = write_traffic_get_reply(p, src);
+            break;
+        case MESSAGE_FROM:
+            p = write_message_from(p, src);
+            break;
+        case DEVICE_PAIR:
+            p = write_device_pair(p, src);
+            break;
+        case DEVICE_PAIR_REPLY:
+            p = write_device_pair_reply(p, src);
+            break;
+        case OFFLINE_SET:
+            p = write_offline_set(p, src);
+            break;
+        case ACCOUNT_SET:
+            p = write_account_set(p, src);
+            break;
+        case ACCOUNT_SET_REPLY:
+            p = write_account_set_reply(p, src);
+            break;
+        case ACCOUNT_GET:
+            p = write_account_get(p, src);
+            break;
+        case ACCOUNT_LOGIN:
+            p = write_account_login(p, src);
+            break;
+        case ACCOUNT_LOGIN_REPLY:
+            p = write_account_login_reply(p, src);
+            break;
+        case ACCOUNT_EXISTS:
+            p = write_account_exists(p, src);
+            break;
+        case ACCOUNT_EXISTS_REPLY:
+            p = write_account_exists_reply(p, src);
+            break;
+        case VERSION_MISMATCH:
+            p = write_version_mismatch(p, src);
+            break;
+
+        default:
+            return -1;
+        break;
+    }
+
+    return (int)(p - dst);
+}
+
 int gc_serialize(struct hm_pool_s *pool, sn *dst, struct proto_s *src)
 {
     dst->s = NULL;
     dst->n = dst->offset = 0;
 
-    add_uint(pool, GCPROTO_VERSION);
-    add_uint(pool, src->type);
+    int n = gc_serialize_size(src);
+    if(n < 0) {
+        return -1;
+    }
+
+    dst->s = hm_palloc(pool, n);
+    if(dst->s == NULL) {
+        return -1;
+    }
+
+    dst->n = gc_serialize_write(dst->s, src);
+    assert(dst->n == n);
+
+    return 0;
+}
+
+int gc_serialize_hdr_size(struct proto_s *src)
+{
+    int n = gc_serialize_size(src);
+    if(n < 0) {
+        return -1;
+    }
 
     switch(src->type) {
         case MESSAGE_TO:
-            add_intern(pool, dst, src->u.message_to.to.s, src->u.message_to.to.n);
-            add_intern(pool, dst, src->u.message_to.address.s, src->u.message_to.address.n);
-            add_intern(pool, dst, src->u.message_to.tp.s, src->u.message_to.tp.n);
-            add_intern(pool, dst, src->u.message_to.body.s, src->u.message_to.body.n);
+            n -= src->u.message_to.body.n;
+            break;
+        case MESSAGE_FROM:
+            n -= src->u.message_from.body.n;
+            break;
+
+        default:
+        break;
+    }
+
+    return n;
+}
+
+int gc_serialize_iov(char *hdr, struct iovec *iov, struct proto_s *src)
+{
+    char *p = hdr;
+    int niov = 1;
+
+    iov[0].iov_base = hdr;
+    iov[0].iov_len  = 0;
+
+    p = put_int(p, GCPROTO_VERSION);
+    p = put_int(p, src->type);
+
+    switch(src->type) {
+        case MESSAGE_TO:
+            p = writev_message_to(p, iov, &niov, src);
             break;
         case MESSAGE_TO_SET_REPLY:
-            if(
-                (sn_memcmp("ok", 2, src->u.message_to_set_reply.error.s, src->u.message_to_set_reply.error.n) == 0) ||
-                (sn_memcmp("ok_registered", 13, src->u.message_to_set_reply.error.s, src->u.message_to_set_reply.error.n) == 0) ||
-                (sn_memcmp("login", 5, src->u.message_to_set_reply.error.s, src->u.message_to_set_reply.error.n) == 0) ||
-                (sn_memcmp("enoexists", 9, src->u.message_to_set_reply.error.s, src->u.message_to_set_reply.error.n) == 0) ||
-                (sn_memcmp("general_failure", 15, src->u.message_to_set_reply.error.s, src->u.message_to_set_reply.error.n) == 0)                 ) {
-                    add_intern(pool, dst, src->u.message_to_set_reply.error.s, src->u.message_to_set_reply.error.n);
-                } else { return -1; }
+            p = write_message_to_set_reply(p, src);
             break;
         case ACCOUNT_LIST:
+            p = write_account_list(p, src);
             break;
         case ACCOUNT_LIST_REPLY:
-            if(
-                (sn_memcmp("ok", 2, src->u.account_list_reply.error.s, src->u.account_list_reply.error.n) == 0) ||
-                (sn_memcmp("general_failure", 15, src->u.account_list_reply.error.s, src->u.account_list_reply.error.n) == 0)                 ) {
-                    add_intern(pool, dst, src->u.account_list_reply.error.s, src->u.account_list_reply.error.n);
-                } else { return -1; }
-            add_intern(pool, dst, src->u.account_list_reply.list.s, src->u.account_list_reply.list.n);
+            p = write_account_list_reply(p, src);
             break;
         case TRAFFIC_MI:
+            p = write_traffic_mi(p, src);
             break;
         case TRAFFIC_GET:
+            p = write_traffic_get(p, src);
             break;
         case TRAFFIC_GET_REPLY:
-            add_intern(pool, dst, src->u.traffic_get_reply.list.s, src->u.traffic_get_reply.list.n);
-            if(
-                (sn_memcmp("ok", 2, src->u.traffic_get_reply.error.s, src->u.traffic_get_reply.error.n) == 0) ||
-                (sn_memcmp("ok_partial", 10, src->u.traffic_get_reply.error.s, src->u.traffic_get_reply.error.n) == 0) ||
-                (sn_memcmp("login", 5, src->u.traffic_get_reply.error.s, src->u.traffic_get_reply.error.n) == 0) ||
-                (sn_memcmp("general_failure", 15, src->u.traffic_get_reply.error.s, src->u.traffic_get_reply.error.n) == 0) ||
-                (sn_memcmp("denied", 6, src->u.traffic_get_reply.error.s, src->u.traffic_get_reply.error.n) == 0) ||
-                (sn_memcmp("empty", 5, src->u.traffic_get_reply.error.s, src->u.traffic_get_reply.error.n) == 0)                 ) {
-                    add_intern(pool, dst, src->u.traffic_get_reply.error.s, src->u.traffic_get_reply.error.n);
-                } else { return -1; }
+            p = write_traffic_get_reply(p, src);
             break;
         case MESSAGE_FROM:
-            add_intern(pool, dst, src->u.message_from.from_cloud.s, src->u.message_from.from_cloud.n);
-            add_intern(pool, dst, src->u.message_from.from_device.s, src->u.message_from.from_device.n);
-            add_intern(pool, dst, src->u.message_from.from_address.s, src->u.message_from.from_address.n);
-            add_intern(pool, dst, src->u.message_from.tp.s, src->u.message_from.tp.n);
-            add_intern(pool, dst, src->u.message_from.body.s, src->u.message_from.body.n);
+            p = writev_message_from(p, iov, &niov, src);
             break;
         case DEVICE_PAIR:
-            add_intern(pool, dst, src->u.device_pair.cloud.s, src->u.device_pair.cloud.n);
-            add_intern(pool, dst, src->u.device_pair.device.s, src->u.device_pair.device.n);
-            add_intern(pool, dst, src->u.device_pair.local_port.s, src->u.device_pair.local_port.n);
-            add_intern(pool, dst, src->u.device_pair.remote_port.s, src->u.device_pair.remote_port.n);
+            p = write_device_pair(p, src);
             break;
         case DEVICE_PAIR_REPLY:
-            add_intern(pool, dst, src->u.device_pair_reply.cloud.s, src->u.device_pair_reply.cloud.n);
-            if(
-                (sn_memcmp("ok", 2, src->u.device_pair_reply.error.s, src->u.device_pair_reply.error.n) == 0) ||
-                (sn_memcmp("ok_registered", 13, src->u.device_pair_reply.error.s, src->u.device_pair_reply.error.n) == 0) ||
-                (sn_memcmp("login", 5, src->u.device_pair_reply.error.s, src->u.device_pair_reply.error.n) == 0) ||
-                (sn_memcmp("general_failure", 15, src->u.device_pair_reply.error.s, src->u.device_pair_reply.error.n) == 0)                 ) {
-                    add_intern(pool, dst, src->u.device_pair_reply.error.s, src->u.device_pair_reply.error.n);
-                } else { return -1; }
-            add_intern(pool, dst, src->u.device_pair_reply.list.s, src->u.device_pair_reply.list.n);
-            add_intern(pool, dst, src->u.device_pair_reply.type.s, src->u.device_pair_reply.type.n);
+            p = write_device_pair_reply(p, src);
             break;
         case OFFLINE_SET:
-            add_intern(pool, dst, src->u.offline_set.address.s, src->u.offline_set.address.n);
-            add_intern(pool, dst, src->u.offline_set.cloud.s, src->u.offline_set.cloud.n);
-            add_intern(pool, dst, src->u.offline_set.device.s, src->u.offline_set.device.n);
+            p = write_offline_set(p, src);
             break;
         case ACCOUNT_SET:
-            add_intern(pool, dst, src->u.account_set.email.s, src->u.account_set.email.n);
-            add_intern(pool, dst, src->u.account_set.password.s, src->u.account_set.password.n);
+            p = write_account_set(p, src);
             break;
         case ACCOUNT_SET_REPLY:
-            if(
-                (sn_memcmp("ok", 2, src->u.account_set_reply.error.s, src->u.account_set_reply.error.n) == 0) ||
-                (sn_memcmp("denied", 6, src->u.account_set_reply.error.s, src->u.account_set_reply.error.n) == 0) ||
-                (sn_memcmp("already_exists", 14, src->u.account_set_reply.error.s, src->u.account_set_reply.error.n) == 0) ||
-                (sn_memcmp("general_failure", 15, src->u.account_set_reply.error.s, src->u.account_set_reply.error.n) == 0)                 ) {
-                    add_intern(pool, dst, src->u.account_set_reply.error.s, src->u.account_set_reply.error.n);
-                } else { return -1; }
+            p = write_account_set_reply(p, src);
             break;
         case ACCOUNT_GET:
+            p = write_account_get(p, src);
             break;
         case ACCOUNT_LOGIN:
-            add_intern(pool, dst, src->u.account_login.email.s, src->u.account_login.email.n);
-            add_intern(pool, dst, src->u.account_login.password.s, src->u.account_login.password.n);
-            add_intern(pool, dst, src->u.account_login.devname.s, src->u.account_login.devname.n);
+            p = write_account_login(p, src);
             break;
         case ACCOUNT_LOGIN_REPLY:
-            if(
-                (sn_memcmp("ok", 2, src->u.account_login_reply.error.s, src->u.account_login_reply.error.n) == 0) ||
-                (sn_memcmp("ok_registered", 13, src->u.account_login_reply.error.s, src->u.account_login_reply.error.n) == 0) ||
-                (sn_memcmp("version", 7, src->u.account_login_reply.error.s, src->u.account_login_reply.error.n) == 0) ||
-                (sn_memcmp("try_again", 9, src->u.account_login_reply.error.s, src->u.account_login_reply.error.n) == 0) ||
-                (sn_memcmp("invalid_login", 13, src->u.account_login_reply.error.s, src->u.account_login_reply.error.n) == 0) ||
-                (sn_memcmp("general_failure", 15, src->u.account_login_reply.error.s, src->u.account_login_reply.error.n) == 0) ||
-                (sn_memcmp("already_logged", 14, src->u.account_login_reply.error.s, src->u.account_login_reply.error.n) == 0)                 ) {
-                    add_intern(pool, dst, src->u.account_login_reply.error.s, src->u.account_login_reply.error.n);
-                } else { return -1; }
+            p = write_account_login_reply(p, src);
             break;
         case ACCOUNT_EXISTS:
-            add_intern(pool, dst, src->u.account_exists.email.s, src->u.account_exists.email.n);
-            add_intern(pool, dst, src->u.account_exists.password.s, src->u.account_exists.password.n);
+            p = write_account_exists(p, src);
             break;
         case ACCOUNT_EXISTS_REPLY:
-            if(
-                (sn_memcmp("ok", 2, src->u.account_exists_reply.error.s, src->u.account_exists_reply.error.n) == 0) ||
-                (sn_memcmp("invalid_login", 13, src->u.account_exists_reply.error.s, src->u.account_exists_reply.error.n) == 0) ||
-                (sn_memcmp("general_failure", 15, src->u.account_exists_reply.error.s, src->u.account_exists_reply.error.n) == 0)                 ) {
-                    add_intern(pool, dst, src->u.account_exists_reply.error.s, src->u.account_exists_reply.error.n);
-                } else { return -1; }
+            p = write_account_exists_reply(p, src);
             break;
         case VERSION_MISMATCH:
-            add_intern(pool, dst, src->u.version_mismatch.master.s, src->u.version_mismatch.master.n);
-            add_intern(pool, dst, src->u.version_mismatch.slave.s, src->u.version_mismatch.slave.n);
+            p = write_version_mismatch(p, src);
             break;
 
         default:
@@ -345,7 +827,12 @@ int gc_serialize(struct hm_pool_s *pool, sn *dst, struct proto_s *src)
         break;
     }
 
-    return 0;
+    iov[niov - 1].iov_len = p - (char *)iov[niov - 1].iov_base;
+    if(niov > 1 && iov[niov - 1].iov_len == 0) {
+        niov--;
+    }
+
+    return niov;
 }
 
 #define CRET(m_func)\
@@ -0,0 +1,118 @@
+/*
+ *
+ * GrizzlyCloud library - simplified VPN alternative for IoT
+ * Copyright (C) 2017 - 2018 Filip Pancik
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <gc.h>
+
+#define ID(m_index, m_generation)\
+    (((m_generation) << GC_REGISTRY_INDEX_BITS) | (unsigned int)(m_index))
+
+static int registry_grow(struct hm_pool_s *pool, struct gc_registry_s *reg)
+{
+    int n = reg->nslots > 0 ? reg->nslots * 2 : GC_REGISTRY_INIT;
+    if(n > GC_REGISTRY_MAX) n = GC_REGISTRY_MAX;
+    if(n <= reg->nslots) return GC_ERROR;
+
+    struct gc_registry_slot_s *slots;
+    slots = hm_prealloc(pool, reg->slots, n * sizeof(*slots));
+    if(!slots) return GC_ERROR;
+
+    // New slots are chained in front of free list, lowest index first
+    int i;
+    for(i = n - 1; i >= reg->nslots; i--) {
+        slots[i].ptr        = NULL;
+        slots[i].generation = 1;
+        slots[i].next       = reg->free;
+        reg->free = i;
+    }
+
+    reg->slots  = slots;
+    reg->nslots = n;
+
+    return GC_OK;
+}
+
+int gc_registry_init(struct hm_pool_s *pool, struct gc_registry_s *reg)
+{
+    assert(reg);
+
+    memset(reg, 0, sizeof(*reg));
+    reg->free = -1;
+
+    return registry_grow(pool, reg);
+}
+
+void gc_registry_free(struct hm_pool_s *pool, struct gc_registry_s *reg)
+{
+    if(reg->slots) hm_pfree(pool, reg->slots);
+
+    memset(reg, 0, sizeof(*reg));
+    reg->free = -1;
+}
+
+unsigned int gc_registry_add(struct hm_pool_s *pool, struct gc_registry_s *reg,
+                             void *ptr)
+{
+    assert(ptr);
+
+    if(reg->free == -1 && registry_grow(pool, reg) != GC_OK) {
+        return 0;
+    }
+
+    int index = reg->free;
+    struct gc_registry_slot_s *slot = &reg->slots[index];
+
+    reg->free = slot->next;
+    reg->count++;
+
+    slot->ptr  = ptr;
+    slot->next = -1;
+
+    return ID(index, slot->generation);
+}
+
+void *gc_registry_get(struct gc_registry_s *reg, unsigned int id)
+{
+    int index = id & GC_REGISTRY_INDEX_MASK;
+
+    if(index >= reg->nslots) return NULL;
+
+    struct gc_registry_slot_s *slot = &reg->slots[index];
+    if(!slot->ptr || ID(index, slot->generation) != id) return NULL;
+
+    return slot->ptr;
+}
+
+void gc_registry_rem(struct gc_registry_s *reg, unsigned int id)
+{
+    int index = id & GC_REGISTRY_INDEX_MASK;
+
+    if(!gc_registry_get(reg, id)) return;
+
+    struct gc_registry_slot_s *slot = &reg->slots[index];
+
+    slot->ptr = NULL;
+
+    // Generation 0 is skipped so that no ID is ever 0
+    slot->generation = (slot->generation + 1) & (GC_REGISTRY_MAX - 1);
+    if(slot->generation == 0) slot->generation = 1;
+
+    slot->next = reg->free;
+    reg->free = index;
+    reg->count--;
+}
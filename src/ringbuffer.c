@@ -39,7 +39,7 @@ static void gc_ringbuffer_next(struct hm_pool_s *pool, struct gc_ringbuffer_s *r
 
     if(rb && rb->send && rb->send->sent == rb->send->len) {
         next = rb->send->next;
-        hm_pfree(pool, rb->send->buf);
+        if(rb->send->mem) hm_pfree(pool, rb->send->mem);
         hm_pfree(pool, rb->send);
         rb->send = next;
         if(rb->send == NULL) {
@@ -52,10 +52,58 @@ void gc_ringbuffer_send_skip(struct hm_pool_s *pool, struct gc_ringbuffer_s *rb,
                              int offset)
 {
     assert(rb);
-    assert(rb->send);
-    rb->send->sent += offset;
 
-    gc_ringbuffer_next(pool, rb);
+    // Offset may span several slots after gathered write
+    while(offset > 0) {
+        assert(rb->send);
+
+        int left = rb->send->len - rb->send->sent;
+        int n = offset < left ? offset : left;
+
+        rb->send->sent += n;
+        offset -= n;
+
+        gc_ringbuffer_next(pool, rb);
+    }
+}
+
+void gc_ringbuffer_send_latency(struct gc_ringbuffer_s *rb, int offset,
+                                struct gc_histogram_s *h)
+{
+    struct gc_ringbuffer_slot_s *r;
+    unsigned long long now = 0;
+
+    assert(rb);
+
+    for(r = rb->send; r != NULL && offset >= r->len - r->sent; r = r->next) {
+        offset -= r->len - r->sent;
+        if(r->stamp == 0) continue;
+
+        if(now == 0) now = gc_metrics_now();
+        gc_histogram_record(h, now - r->stamp);
+    }
+}
+
+void gc_ringbuffer_send_stamp(struct gc_ringbuffer_s *rb, unsigned long long stamp)
+{
+    assert(rb);
+
+    if(rb->tail) rb->tail->stamp = stamp;
+}
+
+int gc_ringbuffer_send_iov(struct gc_ringbuffer_s *rb, struct iovec *iov, int max)
+{
+    int n;
+    struct gc_ringbuffer_slot_s *r;
+
+    assert(rb);
+
+    for(n = 0, r = rb->send; r != NULL && n < max; r = r->next, n++) {
+        iov[n].iov_base = (char *)r->buf + r->sent;
+        iov[n].iov_len  = r->len - r->sent;
+    }
+
+    return n;
 }
 
 int gc_ringbuffer_send_is_empty(struct gc_ringbuffer_s *rb)
@@ -64,12 +112,26 @@ int gc_ringbuffer_send_is_empty(struct gc_ringbuffer_s *rb)
     return (rb->send == NULL);
 }
 
+int gc_ringbuffer_send_pending(struct gc_ringbuffer_s *rb)
+{
+    struct gc_ringbuffer_slot_s *r;
+    int n = 0;
+
+    assert(rb);
+
+    for(r = rb->send; r != NULL; r = r->next) {
+        n += r->len - r->sent;
+    }
+
+    return n;
+}
+
 void gc_ringbuffer_send_pop_all(struct hm_pool_s *pool, struct gc_ringbuffer_s *rb)
 {
     struct gc_ringbuffer_slot_s *r, *rdel;
 
     for(r = rb->send; r != NULL; ) {
-        hm_pfree(pool, r->buf);
+        if(r->mem) hm_pfree(pool, r->mem);
         rdel = r;
         r = r->next;
         hm_pfree(pool, rdel);
@@ -88,6 +150,17 @@ int gc_ringbuffer_send_size(struct gc_ringbuffer_s *rb)
     return size;
 }
 
+static void send_link(struct gc_ringbuffer_s *rb, struct gc_ringbuffer_slot_s *slot)
+{
+    if(rb->send == NULL && rb->tail == NULL) {
+        rb->send = rb->tail = slot;
+    } else {
+        assert(rb->tail);
+        rb->tail->next = slot;
+        rb->tail = slot;
+    }
+}
+
 int gc_ringbuffer_send_append(struct hm_pool_s *pool, struct gc_ringbuffer_s *rb,
                               char *buf, const int len)
 {
@@ -105,21 +178,73 @@ int gc_ringbuffer_send_append(struct hm_pool_s *pool, struct gc_ringbuffer_s *rb
     }
 
     memcpy(slot->buf, buf, len);
+    slot->mem = slot->buf;
     slot->len = len;
     slot->sent = 0;
+    slot->stamp = 0;
     slot->next = NULL;
 
-    if(rb->send == NULL && rb->tail == NULL) {
-        rb->send = rb->tail = slot;
-    } else {
-        assert(rb->tail);
-        rb->tail->next = slot;
-        rb->tail = slot;
+    send_link(rb, slot);
+
+    return GC_OK;
+}
+
+int gc_ringbuffer_send_append_nocopy(struct hm_pool_s *pool, struct gc_ringbuffer_s *rb,
+                                     char *buf, const int len)
+{
+    assert(rb);
+    struct gc_ringbuffer_slot_s *slot;
+
+    slot = hm_palloc(pool, sizeof(*slot));
+    if(slot == NULL) {
+        hm_pfree(pool, buf);
+        return GC_ERROR;
     }
 
+    slot->buf = buf;
+    slot->mem = buf;
+    slot->len = len;
+    slot->sent = 0;
+    slot->stamp = 0;
+    slot->next = NULL;
+
+    send_link(rb, slot);
+
     return GC_OK;
 }
 
+int gc_ringbuffer_send_append_iov(struct hm_pool_s *pool, struct gc_ringbuffer_s *rb,
+                                  const struct iovec *iov, const int niov, void **mem)
+{
+    assert(rb);
+    assert(niov > 0 && niov <= RB_IOV_MAX);
+    struct gc_ringbuffer_slot_s *slots[RB_IOV_MAX];
+    int i;
+
+    // Allocate all slots first so that message is queued either whole or not at all
+    for(i = 0; i < niov; i++) {
+        slots[i] = hm_palloc(pool, sizeof(*slots[i]));
+        if(slots[i] == NULL) {
+            while(i-- > 0) hm_pfree(pool, slots[i]);
+            return GC_ERROR;
+        }
+    }
+
+    for(i = 0; i < niov; i++) {
+        assert(iov[i].iov_len > 0);
+
+        slots[i]->buf = iov[i].iov_base;
+        slots[i]->mem = mem[i];
+        slots[i]->len = iov[i].iov_len;
+        slots[i]->sent = 0;
+        slots[i]->stamp = 0;
+        slots[i]->next = NULL;
+
+        send_link(rb, slots[i]);
+    }
+
+    return GC_OK;
+}
 void gc_ringbuffer_recv_append(struct hm_pool_s *pool, struct gc_ringbuffer_s *rb,
                                const int len)
 {
@@ -140,6 +265,18 @@ void gc_ringbuffer_recv_pop(struct hm_pool_s *pool, struct gc_ringbuffer_s *rb)
     }
 }
 
+void *gc_ringbuffer_recv_detach(struct gc_ringbuffer_s *rb)
+{
+    assert(rb);
+    void *buf = rb->recv.buf;
+
+    rb->recv.buf = NULL;
+    rb->recv.len = 0;
+    rb->recv.target = 0;
+
+    return buf;
+}
+
 char *gc_ringbuffer_recv_read(struct gc_ringbuffer_s *rb, int *size)
 {
     *size = rb->recv.len;
@@ -0,0 +1,206 @@
+/*
+ *
+ * GrizzlyCloud library - simplified VPN alternative for IoT
+ * Copyright (C) 2017 - 2018 Filip Pancik
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <gc.h>
+
+void gc_stream_init(struct gc_stream_s *stream, unsigned int id)
+{
+    assert(stream);
+
+    stream->id        = id;
+    stream->window    = GC_STREAM_WINDOW;
+    stream->consumed  = 0;
+    stream->paused    = 0;
+    stream->eof_sent  = 0;
+    stream->eof_recv  = 0;
+    stream->keepalive = 0;
+}
+
+void gc_stream_free(struct hm_pool_s *pool, struct gc_stream_s *stream)
+{
+    if(stream->codec) {
+        gc_codec_free(pool, stream->codec);
+        stream->codec = NULL;
+    }
+}
+
+int gc_stream_encode(struct gc_gen_client_s *client, sn *payload, void **mem)
+{
+    sn z;
+
+    if(!client->stream.codec) {
+        return GC_ERROR;
+    }
+
+    if(gc_codec_compress(client->base.pool, client->stream.codec,
+                         *payload, &z) != GC_OK) {
+        return GC_ERROR;
+    }
+
+    hm_pfree(client->base.pool, *mem);
+    *mem = z.s;
+    *payload = z;
+
+    return GC_OK;
+}
+
+int gc_stream_deliver(struct gc_s *gc, struct gc_gen_client_s *client,
+                      sn body, int compressed)
+{
+    sn raw;
+
+    if(!compressed) {
+        gc_packet_forward(gc, client, body);
+        gc_ringbuffer_send_stamp(&client->base.rb, gc->metrics.decoded);
+        return GC_OK;
+    }
+
+    if(!client->stream.codec ||
+        gc_codec_decompress(client->base.pool, client->stream.codec,
+                            body, &raw) != GC_OK) {
+        hm_log(LOG_DEBUG, client->base.log, "Stream %u payload couldn't be decompressed",
+                                            client->stream.id);
+        return GC_ERROR;
+    }
+
+    if(gc_ringbuffer_send_append_nocopy(client->base.pool, &client->base.rb,
+                                        raw.s, raw.n) != GC_OK) {
+        return GC_ERROR;
+    }
+
+    gc_ringbuffer_send_stamp(&client->base.rb, gc->metrics.decoded);
+    ev_io_start(client->base.loop, &client->base.write);
+
+    return GC_OK;
+}
+
+void gc_stream_sent(struct gc_gen_client_s *client, int n)
+{
+    struct gc_stream_s *s = &client->stream;
+
+    s->window -= n;
+
+    if(s->window <= 0 && !s->paused) {
+        hm_log(LOG_TRACE, client->base.log, "Stream %u paused, window exhausted", s->id);
+        ev_io_stop(client->base.loop, &client->base.read);
+        s->paused = 1;
+    }
+}
+
+int gc_stream_consumed(struct gc_stream_s *stream, int n)
+{
+    int credit;
+
+    stream->consumed += n;
+    if(stream->consumed < GC_STREAM_WINDOW_UPDATE) {
+        return 0;
+    }
+
+    credit = stream->consumed;
+    stream->consumed  = 0;
+
+    return credit;
+}
+
+void gc_stream_credit(struct gc_gen_client_s *client, int n)
+{
+    struct gc_stream_s *s = &client->stream;
+
+    s->window += n;
+
+    if(s->window > 0 && s->paused) {
+        hm_log(LOG_TRACE, client->base.log, "Stream %u resumed, window %d", s->id, s->window);
+        ev_io_start(client->base.loop, &client->base.read);
+        s->paused = 0;
+    }
+}
+
+int gc_stream_eof(struct gc_gen_client_s *client)
+{
+    struct gc_stream_s *s = &client->stream;
+
+    ev_io_stop(client->base.loop, &client->base.read);
+    s->eof_sent = 1;
+
+    hm_log(LOG_TRACE, client->base.log, "Stream %u half-closed locally", s->id);
+
+    return (s->eof_recv && gc_ringbuffer_send_is_empty(&client->base.rb)) ?
+           GC_ERROR : GC_OK;
+}
+
+int gc_stream_peer_eof(struct gc_gen_client_s *client)
+{
+    struct gc_stream_s *s = &client->stream;
+
+    s->eof_recv = 1;
+
+    hm_log(LOG_TRACE, client->base.log, "Stream %u half-closed by peer", s->id);
+
+    // Otherwise shut down from gc_stream_drained()
+    if(!gc_ringbuffer_send_is_empty(&client->base.rb) ||
+       EQFLAG(client->base.flags, GC_CONNECTING)) {
+        return GC_OK;
+    }
+
+    if(!s->keepalive) shutdown(client->base.fd, SHUT_WR);
+
+    return s->eof_sent ? GC_ERROR : GC_OK;
+}
+
+int gc_stream_draining(struct gc_gen_client_s *client)
+{
+    struct gc_stream_s *s = &client->stream;
+
+    return s->eof_sent && s->eof_recv &&
+           !gc_ringbuffer_send_is_empty(&client->base.rb);
+}
+
+void gc_stream_drained(struct gc_gen_client_s *client)
+{
+    struct gc_stream_s *s = &client->stream;
+
+    if(!s->eof_recv) return;
+
+    if(!s->keepalive) shutdown(client->base.fd, SHUT_WR);
+
+    if(s->eof_sent && client->callback.error) {
+        client->callback.error(client, GC_STREAMDONE_ERR);
+    }
+}
+
+int gc_stream_control(struct gc_s *gc, sn to, sn address, const char *tp)
+{
+    struct gc_gen_client_ssl_s *c = &gc->client;
+
+    if(!EQFLAG(c->base.flags, GC_HANDSHAKED) ||
+        EQFLAG(c->base.flags, GC_WANT_SHUTDOWN)) {
+        return GC_ERROR;
+    }
+
+    sn_initz(sntp, (char *)tp);
+    sn_initr(body, "NULL", 4);
+
+    struct proto_s pr = { .type = MESSAGE_TO };
+    sn_set(pr.u.message_to.to,      to);
+    sn_set(pr.u.message_to.address, address);
+    sn_set(pr.u.message_to.tp,      sntp);
+    sn_set(pr.u.message_to.body,    body);
+
+    return gc_packet_send(gc, &pr);
+}
@@ -19,27 +19,39 @@
  */
 #include <gc.h>
 
-static struct gc_tunnel_s    *tunnels  = NULL;
-
-static struct gc_gen_client_s *tunnel_client_find(sn port, sn fd)
+static struct gc_gen_client_s *tunnel_client_find(struct gc_s *gc, sn port,
+                                                  const char *id)
 {
-    struct gc_tunnel_s *t;
-    struct ht_s *kv;
-
-    for(t = tunnels; t != NULL; t = t->next) {
-        if(!sn_cmps(t->port_remote, port)) continue;
-        if(!(t->server && t->server->clients)) continue;
+    char *end;
+    unsigned long n = strtoul(id, &end, 10);
+    if(*id == '\0' || *end != '\0' || n == 0 || n > 0xffffffffUL) {
+        return NULL;
+    }
 
-        char key[16];
-        snprintf(key, sizeof(key), "%.*s", sn_p(fd));
-        kv = ht_get(t->server->clients, key, strlen(key));
+    // Stale IDs of closed clients resolve to nothing
+    struct gc_gen_client_s *client = gc_registry_get(&gc->streams, (unsigned int)n);
+    if(!client) return NULL;
 
-        if(!kv) continue;
+    if(!client->parent->tunnel ||
+       !sn_cmps(client->parent->tunnel->port_remote, port)) return NULL;
 
-        return (struct gc_gen_client_s *)kv->s;
-    }
+    return client;
+}
 
-    return NULL;
+static void tunnel_stats(struct hm_log_s *log, struct gc_tunnel_s *t)
+{
+    struct gc_codec_stats_s *s = &t->stats;
+
+    if(t->codec == GC_CODEC_NONE) return;
+
+    hm_log(LOG_DEBUG, log, "Tunnel [cloud:device:port_remote] [%.*s:%.*s:%.*s] %s: %llu -> %llu bytes (%.1f%%), %llu bytes raw, %llu us",
+                           sn_p(t->cloud),
+                           sn_p(t->device),
+                           sn_p(t->port_remote),
+                           gc_codec_name(t->codec),
+                           s->in, s->out,
+                           s->in > 0 ? 100.0 * s->out / s->in : 100.0,
+                           s->raw, s->usec);
 }
 
 int gc_tunnel_update(struct gc_s *gc, struct proto_s *p, char **argv, int argc)
@@ -50,7 +62,7 @@ int gc_tunnel_update(struct gc_s *gc, struct proto_s *p, char **argv, int argc)
         return GC_ERROR;
     }
 
-    for(t = tunnels; t != NULL; t = t->next) {
+    for(t = gc->tunnels; t != NULL; t = t->next) {
 #define CMP(m_dst, m_src)\
     sn_memcmp(m_dst, strlen(m_dst), m_src.s, m_src.n)
         if(CMP(argv[1], t->cloud) &&
@@ -69,49 +81,238 @@ int gc_tunnel_update(struct gc_s *gc, struct proto_s *p, char **argv, int argc)
 
 int gc_tunnel_response(struct gc_s *gc, struct proto_s *p, char **argv, int argc)
 {
+    // Optional 4th element names codec of compressed payload
+    if(argc != 3 && argc != 4) {
+        return GC_ERROR;
+    }
+
+    sn_initr(port, argv[1], strlen(argv[1]));
+    sn_initr(id,   argv[2], strlen(argv[2]));
+
+    hm_log(LOG_TRACE, &gc->log, "Tunnel response [port:stream] [%.*s:%.*s]",
+                                sn_p(port),
+                                sn_p(id));
+
+    struct gc_gen_client_s *client = tunnel_client_find(gc, port, argv[2]);
+    if(!client) {
+        hm_log(LOG_TRACE, &gc->log, "Tunnel client not found");
+        return GC_ERROR;
+    }
+
+    return gc_stream_deliver(gc, client, p->u.message_from.body, argc == 4);
+}
+
+int gc_tunnel_closed(struct gc_s *gc, struct proto_s *p, char **argv, int argc)
+{
+    (void )p;
+
     if(argc != 3) {
         return GC_ERROR;
     }
 
     sn_initr(port, argv[1], strlen(argv[1]));
-    sn_initr(fd,   argv[2], strlen(argv[2]));
+    sn_initr(id,   argv[2], strlen(argv[2]));
 
-    hm_log(LOG_TRACE, &gc->log, "Tunnel response [port:fd] [%.*s:%.*s]",
+    hm_log(LOG_TRACE, &gc->log, "Tunnel closed by endpoint [port:stream] [%.*s:%.*s]",
                                 sn_p(port),
-                                sn_p(fd));
+                                sn_p(id));
 
-    struct gc_gen_client_s *client = tunnel_client_find(port, fd);
+    struct gc_gen_client_s *client = tunnel_client_find(gc, port, argv[2]);
+    if(!client) {
+        return GC_ERROR;
+    }
+
+    client->stream.closed = 1;
+
+    // Released once remaining payload is written
+    if(gc_stream_draining(client)) return GC_OK;
+
+    async_client_shutdown(client);
+
+    return GC_OK;
+}
+
+int gc_tunnel_half_closed(struct gc_s *gc, struct proto_s *p, char **argv, int argc)
+{
+    (void )p;
+
+    if(argc != 3) {
+        return GC_ERROR;
+    }
+
+    sn_initr(port, argv[1], strlen(argv[1]));
+
+    struct gc_gen_client_s *client = tunnel_client_find(gc, port, argv[2]);
+    if(!client) {
+        hm_log(LOG_TRACE, &gc->log, "Tunnel client not found");
+        return GC_ERROR;
+    }
+
+    if(gc_stream_peer_eof(client) != GC_OK) {
+        async_client_shutdown(client);
+    }
+
+    return GC_OK;
+}
+
+int gc_tunnel_credit(struct gc_s *gc, struct proto_s *p, char **argv, int argc)
+{
+    (void )p;
+
+    if(argc != 4) {
+        return GC_ERROR;
+    }
+
+    sn_initr(port,  argv[1], strlen(argv[1]));
+    sn_initr(bytes, argv[3], strlen(argv[3]));
+
+    struct gc_gen_client_s *client = tunnel_client_find(gc, port, argv[2]);
     if(!client) {
         hm_log(LOG_TRACE, &gc->log, "Tunnel client not found");
         return GC_ERROR;
     }
 
-    gc_gen_ev_send(client,
-                   p->u.message_from.body.s,
-                   p->u.message_from.body.n);
+    sn_atoi(n, bytes, 16);
+    if(n <= 0) {
+        return GC_ERROR;
+    }
+
+    gc_stream_credit(client, n);
 
     return GC_OK;
 }
 
+int gc_tunnel_codec(struct gc_s *gc, struct proto_s *p, char **argv, int argc)
+{
+    (void )p;
+
+    if(argc != 4) {
+        return GC_ERROR;
+    }
+
+    sn_initr(port,  argv[1], strlen(argv[1]));
+    sn_initr(name,  argv[3], strlen(argv[3]));
+
+    struct gc_gen_client_s *client = tunnel_client_find(gc, port, argv[2]);
+    if(!client) {
+        hm_log(LOG_TRACE, &gc->log, "Tunnel client not found");
+        return GC_ERROR;
+    }
+
+    struct gc_tunnel_s *tunnel = client->parent->tunnel;
+    enum gc_codec_e codec = gc_codec_parse(name);
+
+    if(codec == GC_CODEC_NONE || codec != tunnel->codec || client->stream.codec) {
+        return GC_ERROR;
+    }
+
+    client->stream.codec = gc_codec_new(gc->pool, codec, &tunnel->stats);
+    if(!client->stream.codec) {
+        return GC_ERROR;
+    }
+
+    hm_log(LOG_TRACE, &gc->log, "Stream %u compressed with %s",
+                                client->stream.id, gc_codec_name(codec));
+
+    return GC_OK;
+}
+
+static void client_control(struct gc_gen_client_s *client, const char *type,
+                           const char *extra)
+{
+    struct gc_tunnel_s *tunnel = client->parent->tunnel;
+
+    assert(tunnel);
+
+    char header[96];
+    snprintf(header, sizeof(header), "%s/%.*s/%u%s", type,
+                                     sn_p(tunnel->port_remote),
+                                     client->stream.id,
+                                     extra);
+
+    sn_initr(device, tunnel->device.s, tunnel->device.n);
+    sn_initr(pid,    tunnel->pid.s,    tunnel->pid.n);
+
+    gc_stream_control(client->base.gc, device, pid, header);
+}
+
+static void client_accept(struct gc_gen_client_s *client)
+{
+    struct gc_tunnel_s *tunnel = client->parent->tunnel;
+
+    tunnel->traffic.accepted++;
+    tunnel->traffic.active++;
+
+    char extra[32];
+    if(tunnel->codec != GC_CODEC_NONE) {
+        snprintf(extra, sizeof(extra), "/%.*s/%s", sn_p(tunnel->port_local),
+                                                   gc_codec_name(tunnel->codec));
+    } else {
+        snprintf(extra, sizeof(extra), "/%.*s", sn_p(tunnel->port_local));
+    }
+
+    client_control(client, "tunnel_open", extra);
+}
+
+static void client_close(struct gc_gen_client_s *client)
+{
+    client->parent->tunnel->traffic.active--;
+
+    tunnel_stats(client->base.log, client->parent->tunnel);
+
+    if(client->stream.closed) return;
+
+    client_control(client, "tunnel_close", "");
+}
+
+static int client_eof(struct gc_gen_client_s *client)
+{
+    if(gc_stream_eof(client) != GC_OK) return GC_ERROR;
+
+    client_control(client, "tunnel_half_close", "");
+
+    return GC_OK;
+}
+
+static void client_written(struct gc_gen_client_s *client, int len)
+{
+    struct gc_metrics_traffic_s *traffic = &client->parent->tunnel->traffic;
+    traffic->bytes_out += len;
+    traffic->packets_out++;
+
+    int credit = gc_stream_consumed(&client->stream, len);
+    if(credit == 0) return;
+
+    char extra[16];
+    snprintf(extra, sizeof(extra), "/%d", credit);
+
+    client_control(client, "tunnel_window", extra);
+}
+
 static void client_data(struct gc_gen_client_s *client, char *buf, const int len)
 {
     struct gc_tunnel_s *tunnel = client->parent->tunnel;
+    unsigned long long start = gc_metrics_now();
 
     assert(tunnel);
 
+    tunnel->traffic.bytes_in += len;
+    tunnel->traffic.packets_in++;
+
     // Payload
     sn_initr(payload, (char *)buf, len);
+    void *mem = gc_ringbuffer_recv_detach(&client->base.rb);
 
-    // Client file descriptor
-    char client_fd[8];
-    snprintf(client_fd, sizeof(client_fd), "%d", client->base.fd);
+    int compressed = gc_stream_encode(client, &payload, &mem) == GC_OK;
 
     // Message header
     char header[64];
-    snprintf(header, sizeof(header), "tunnel_request/%.*s/%s/%.*s",
+    snprintf(header, sizeof(header), "tunnel_request/%.*s/%u/%.*s%s%s",
                                      sn_p(tunnel->port_remote),
-                                     client_fd,
-                                     sn_p(tunnel->port_local));
+                                     client->stream.id,
+                                     sn_p(tunnel->port_local),
+                                     compressed ? "/" : "",
+                                     compressed ? gc_codec_name(client->stream.codec->type) : "");
     sn_initr(snheader, header, strlen(header));
 
     hm_log(LOG_TRACE, client->base.log, "{Tunnel}: header [%.*s]",
@@ -123,7 +324,13 @@ static void client_data(struct gc_gen_client_s *client, char *buf, const int len
     sn_set(m.u.message_to.body,    payload);
     sn_set(m.u.message_to.tp,      snheader);
 
-    gc_packet_send(client->base.gc, &m);
+    // Payload is queued straight from receive buffer
+    gc_packet_send_ref(client->base.gc, &m, mem);
+
+    gc_stream_sent(client, len);
+
+    gc_histogram_record(&client->base.gc->metrics.latency[GC_LATENCY_LOCAL_RECV],
+                        gc_metrics_now() - start);
 }
 
 static int alloc_server(struct gc_s *gc, struct gc_gen_server_s **c,
@@ -137,7 +344,11 @@ static int alloc_server(struct gc_s *gc, struct gc_gen_server_s **c,
     (*c)->loop = gc->loop;
     (*c)->log  = &gc->log;
     (*c)->pool = gc->pool;
-    (*c)->callback.data = client_data;
+    (*c)->callback.data    = client_data;
+    (*c)->callback.accept  = client_accept;
+    (*c)->callback.close   = client_close;
+    (*c)->callback.written = client_written;
+    (*c)->callback.eof     = client_eof;
     (*c)->host = "0.0.0.0";
 
     sn_to_char(port, port_local, 32);
@@ -176,20 +387,15 @@ static void port_update(struct gc_s *gc, struct gc_device_pair_s *pair,
     ret = gc_packet_send(gc, &pr);
     if(ret != GC_OK) CALLBACK_ERROR(&gc->log, "update_port_local");
 
-    int i;
-    for(i = 0; i < gc->config.ntunnels; i++) {
-        sn_itoa(port,       gc->config.tunnels[i].port, 8);
-        sn_itoa(port_local, gc->config.tunnels[i].port_local,  8);
-
-        if(sn_cmps(gc->config.tunnels[i].cloud, pair->cloud) &&
-           sn_cmps(gc->config.tunnels[i].device, pair->device) &&
-           sn_cmps(port, pair->port_remote) &&
-           sn_cmps(port_local, pair->port_local)) {
-            sn_atoi(npl, new_port_local, 8);
-            gc->config.tunnels[i].port_local = npl;
-            snb_cpy_ds(pair->port_local, new_port_local);
-            break;
+    sn_initr(port_local, pair->port_local.s, pair->port_local.n);
+    struct gc_config_tunnel_s *t = gc_config_tunnel_find(&gc->config, pair->cloud, pair->device,
+                                                         pair->port_remote, port_local);
+    if(t) {
+        sn_atoi(npl, new_port_local, 8);
+        if(gc_config_tunnel_port_local(gc->pool, &gc->config, t, npl) != GC_OK) {
+            hm_log(LOG_WARNING, &gc->log, "Tunnel with local port %d couldn't be indexed", npl);
         }
+        snb_cpy_ds(pair->port_local, new_port_local);
     }
 }
 
@@ -222,38 +428,51 @@ int gc_tunnel_add(struct gc_s *gc, struct gc_device_pair_s *pair, sn type)
     snb_cpy_ds(t->port_remote, pair->port_remote);
     snb_cpy_ds(t->type,        pair->type);
 
+    t->codec = pair->codec;
+
     // Link tunnel and server
     t->server = c;
     if(c) c->tunnel = t;
 
-    t->next = tunnels;
-    tunnels = t;
+    t->next = gc->tunnels;
+    gc->tunnels = t;
 
     return GC_OK;
 }
 
-void gc_tunnel_stop(struct hm_pool_s *pool, struct hm_log_s *log, sn pid)
+struct gc_tunnel_s *gc_tunnels(struct gc_s *gc)
 {
-    struct gc_tunnel_s *t, *prev, *del;
-    for(t = tunnels, prev = NULL; t != NULL; ) {
-        if(sn_cmps(t->pid, pid)) {
+    return gc->tunnels;
+}
+
+static void tunnel_free(struct hm_pool_s *pool, struct hm_log_s *log,
+                        struct gc_tunnel_s *t)
+{
+    fs_unpair(log, &t->pid);
+    tunnel_stats(log, t);
+    if(t->server) {
+        hm_log(LOG_TRACE, t->server->log, "Tunnel stop [cloud:device:port:port_remote] [%.*s:%.*s:%.*s:%.*s]",
+                                          sn_p(t->cloud),
+                                          sn_p(t->device),
+                                          sn_p(t->port_local),
+                                          sn_p(t->port_remote));
+        async_server_shutdown(t->server);
+    }
 
-            fs_unpair(log, &t->pid);
-            if(t->server) {
-                hm_log(LOG_TRACE, t->server->log, "Tunnel stop [cloud:device:port:port_remote] [%.*s:%.*s:%.*s:%.*s]",
-                                                  sn_p(t->cloud),
-                                                  sn_p(t->device),
-                                                  sn_p(t->port_local),
-                                                  sn_p(t->port_remote));
-                async_server_shutdown(t->server);
-            }
+    hm_pfree(pool, t);
+}
 
+void gc_tunnel_stop(struct gc_s *gc, sn pid)
+{
+    struct gc_tunnel_s *t, *prev, *del;
+    for(t = gc->tunnels, prev = NULL; t != NULL; ) {
+        if(sn_cmps(t->pid, pid)) {
             if(prev) prev->next = t->next;
-            else     tunnels = t->next;
+            else     gc->tunnels = t->next;
 
             del = t;
             t = t->next;
-            hm_pfree(pool, del);
+            tunnel_free(gc->pool, &gc->log, del);
         } else {
             prev = t;
             t = t->next;
@@ -261,17 +480,41 @@ void gc_tunnel_stop(struct hm_pool_s *pool, struct hm_log_s *log, sn pid)
     }
 }
 
-void gc_tunnel_stop_all(struct hm_pool_s *pool, struct hm_log_s *log)
+int gc_tunnel_remove(struct gc_s *gc, sn cloud, sn device,
+                     sn port_remote, sn port_local)
+{
+    struct gc_tunnel_s *t, *prev;
+    sn_initz(forced, "forced");
+
+    for(t = gc->tunnels, prev = NULL; t != NULL; prev = t, t = t->next) {
+        if(sn_cmps(t->type, forced) ||
+           !sn_cmps(t->cloud, cloud) ||
+           !sn_cmps(t->device, device) ||
+           !sn_cmps(t->port_remote, port_remote) ||
+           !sn_cmps(t->port_local, port_local)) {
+            continue;
+        }
+
+        if(prev) prev->next = t->next;
+        else     gc->tunnels = t->next;
+
+        tunnel_free(gc->pool, &gc->log, t);
+
+        return GC_OK;
+    }
+
+    return GC_ERROR;
+}
+
+void gc_tunnel_stop_all(struct gc_s *gc)
 {
     struct gc_tunnel_s *t, *del;
 
-    for(t = tunnels; t != NULL; ) {
-        fs_unpair(log, &t->pid);
-        if(t->server) async_server_shutdown(t->server);
+    for(t = gc->tunnels; t != NULL; ) {
         del = t;
         t = t->next;
-        hm_pfree(pool, del);
+        tunnel_free(gc->pool, &gc->log, del);
     }
 
-    tunnels = NULL;
+    gc->tunnels = NULL;
 }
@@ -29,33 +29,14 @@ static void ev_send(struct hm_pool_s *pool,
     ev_io_start(loop, write);
 }
 
-static void memory_append(sn *dst, const char *src, const int nsrc)
+static void ev_send_nocopy(struct hm_pool_s *pool,
+                           struct gc_ringbuffer_s *rb,
+                           struct ev_loop *loop,
+                           struct ev_io *write,
+                           char *buf, int len)
 {
-    assert(dst->n >= nsrc + dst->offset);
-    memcpy(dst->s + dst->offset, src, nsrc);
-    dst->offset += nsrc;
-}
-
-static int net_send(struct gc_s *gc, const char *buffer, const int nbuffer)
-{
-    int len = nbuffer;
-    sn m = {
-        .s      = hm_palloc(gc->pool, nbuffer + sizeof(int)),
-        .n      = nbuffer + sizeof(int),
-        .offset = 0};
-    int tmplen = len;
-
-    gc_swap_memory((void *)&len, sizeof(len));
-
-    memory_append(&m, (void *)&len, sizeof(len));
-    memory_append(&m, buffer, tmplen);
-
-    struct gc_gen_client_ssl_s *c = &gc->client;
-    gc_ssl_ev_send(c, m.s, m.n);
-
-    hm_pfree(gc->pool, m.s);
-
-    return GC_OK;
+    gc_ringbuffer_send_append_nocopy(pool, rb, buf, len);
+    ev_io_start(loop, write);
 }
 
 void gc_swap_memory(char *dst, int ndst)
@@ -81,24 +62,286 @@ void gc_gen_ev_send(struct gc_gen_client_s *client, char *buf, const int len)
             &client->base.write, buf, len);
 }
 
+static char *frame_put(char *dst, struct proto_s *pr)
+{
+    int len = gc_serialize_write(dst + GCPROTO_FRAME_HEADROOM, pr);
+    int n = len;
+
+    gc_swap_memory((void *)&len, sizeof(len));
+    memcpy(dst, &len, GCPROTO_FRAME_HEADROOM);
+
+    return dst + GCPROTO_FRAME_HEADROOM + n;
+}
+
+/*
+ * Serialization time is recorded once frame is queued,
+ * frame's wait in upstream queue is timed from then on.
+ */
+static void frame_queued(struct gc_s *gc, unsigned long long start)
+{
+    unsigned long long now = gc_metrics_now();
+
+    gc_histogram_record(&gc->metrics.latency[GC_LATENCY_SERIALIZE], now - start);
+    gc_ringbuffer_send_stamp(&gc->client.base.rb, now);
+}
+
+static int packet_send(struct gc_s *gc, struct proto_s *pr)
+{
+    unsigned long long start = gc_metrics_now();
+    int n = gc_serialize_size(pr);
+    if(n < 0) {
+        hm_log(LOG_DEBUG, &gc->log, "Packet serialization failed");
+        return GC_ERROR;
+    }
+
+    // Frame is serialized once, right behind its length
+    int nframe = GCPROTO_FRAME_HEADROOM + n;
+    char *frame = hm_palloc(gc->pool, nframe);
+    if(!frame) {
+        hm_log(LOG_DEBUG, &gc->log, "Packet of size %d couldn't be sent", n);
+        return GC_ERROR;
+    }
+
+    char *end = frame_put(frame, pr);
+    assert(end == frame + nframe);
+    (void)end;
+
+    struct gc_gen_client_ssl_s *c = &gc->client;
+    ev_send_nocopy(c->base.pool, &c->base.rb,
+                   c->base.loop, &c->base.write, frame, nframe);
+
+    frame_queued(gc, start);
+    gc->metrics.upstream_frames_out++;
+
+    return GC_OK;
+}
+
+static char *batch_put(char *dst, sn src)
+{
+    int n = src.n;
+    gc_swap_memory((void *)&n, sizeof(n));
+    memcpy(dst, &n, sizeof(n));
+    memcpy(dst + sizeof(n), src.s, src.n);
+
+    return dst + sizeof(n) + src.n;
+}
+
+static int batch_add(struct gc_s *gc, struct proto_s *pr)
+{
+    struct gc_gen_client_ssl_s *c = &gc->client;
+    sn tp   = pr->u.message_to.tp;
+    sn body = pr->u.message_to.body;
+
+    // Coalesce only small messages and only while upstream is busy
+    if(tp.n + body.n >= GC_PACKET_REF_MIN ||
+       (gc->batch.count == 0 && gc_ringbuffer_send_is_empty(&c->base.rb))) {
+        return GC_ERROR;
+    }
+
+    if(gc->batch.count > 0 &&
+       !(sn_cmps(gc->batch.to, pr->u.message_to.to) &&
+         sn_cmps(gc->batch.address, pr->u.message_to.address))) {
+        gc_packet_flush(gc);
+    }
+
+    if(gc->batch.count == 0) {
+        if(pr->u.message_to.to.n > (int)sizeof(gc->batch.to.s) ||
+           pr->u.message_to.address.n > (int)sizeof(gc->batch.address.s)) {
+            return GC_ERROR;
+        }
+
+        snb_cpy_ds(gc->batch.to,      pr->u.message_to.to);
+        snb_cpy_ds(gc->batch.address, pr->u.message_to.address);
+    }
+
+    int n = 2 * sizeof(int) + tp.n + body.n;
+    char *buf = hm_prealloc(gc->pool, gc->batch.buf.s, gc->batch.buf.n + n);
+    if(!buf) {
+        return GC_ERROR;
+    }
+
+    batch_put(batch_put(buf + gc->batch.buf.n, tp), body);
+
+    gc->batch.buf.s = buf;
+    gc->batch.buf.n += n;
+    gc->batch.count++;
+
+    if(gc->batch.buf.n >= GC_BATCH_MAX) {
+        gc_packet_flush(gc);
+    } else {
+        // Flushed once upstream drains
+        ev_io_start(c->base.loop, &c->base.write);
+    }
+
+    return GC_OK;
+}
+
+void gc_packet_flush(struct gc_s *gc)
+{
+    if(gc->batch.count == 0) return;
+
+    sn_initz(tp, "batch");
+
+    struct proto_s pr = { .type = MESSAGE_TO };
+    sn_setr(pr.u.message_to.to,      gc->batch.to.s, gc->batch.to.n);
+    sn_setr(pr.u.message_to.address, gc->batch.address.s, gc->batch.address.n);
+    sn_set(pr.u.message_to.tp,       tp);
+    sn_set(pr.u.message_to.body,     gc->batch.buf);
+
+    hm_log(LOG_TRACE, &gc->log, "Sending batch of %d messages, %d bytes",
+                                gc->batch.count, gc->batch.buf.n);
+
+    gc->batch.count = 0;
+    gc->batch.buf.n = 0;
+
+    if(packet_send(gc, &pr) != GC_OK) {
+        hm_log(LOG_DEBUG, &gc->log, "Batch couldn't be sent");
+    }
+}
+
 int gc_packet_send(struct gc_s *gc, struct proto_s *pr)
 {
-    sn dst;
-    if(gc_serialize(gc->pool, &dst, pr) != GC_OK) {
+    if(gc->config.batch && pr->type == MESSAGE_TO &&
+       batch_add(gc, pr) == GC_OK) {
+        return GC_OK;
+    }
+
+    // Keep order, anything batched so far goes first
+    gc_packet_flush(gc);
+
+    return packet_send(gc, pr);
+}
+
+int gc_packet_send_all(struct gc_s *gc, struct proto_s *pr, const int npr)
+{
+    unsigned long long start = gc_metrics_now();
+    int i, n = 0;
+
+    for(i = 0; i < npr; i++) {
+        int size = gc_serialize_size(&pr[i]);
+        if(size < 0) {
+            hm_log(LOG_DEBUG, &gc->log, "Packet serialization failed");
+            return GC_ERROR;
+        }
+        n += GCPROTO_FRAME_HEADROOM + size;
+    }
+
+    if(n == 0) return GC_OK;
+
+    gc_packet_flush(gc);
+
+    char *frames = hm_palloc(gc->pool, n);
+    if(!frames) {
+        hm_log(LOG_DEBUG, &gc->log, "%d packets of size %d couldn't be sent", npr, n);
+        return GC_ERROR;
+    }
+
+    char *dst = frames;
+    for(i = 0; i < npr; i++) {
+        dst = frame_put(dst, &pr[i]);
+    }
+    assert(dst == frames + n);
+
+    struct gc_gen_client_ssl_s *c = &gc->client;
+    ev_send_nocopy(c->base.pool, &c->base.rb,
+                   c->base.loop, &c->base.write, frames, n);
+
+    frame_queued(gc, start);
+    gc->metrics.upstream_frames_out += npr;
+
+    return GC_OK;
+}
+
+int gc_packet_send_ref(struct gc_s *gc, struct proto_s *pr, void *ref)
+{
+    unsigned long long start = gc_metrics_now();
+    int n = gc_serialize_size(pr);
+    int nhdr = gc_serialize_hdr_size(pr);
+    if(n < 0 || nhdr < 0) {
         hm_log(LOG_DEBUG, &gc->log, "Packet serialization failed");
+        hm_pfree(gc->pool, ref);
+        return GC_ERROR;
+    }
+
+    // Small payloads are cheaper to copy than to queue separately
+    if(n - nhdr < GC_PACKET_REF_MIN) {
+        int ret = gc_packet_send(gc, pr);
+        hm_pfree(gc->pool, ref);
+        return ret;
+    }
+
+    gc_packet_flush(gc);
+
+    int nframe = GCPROTO_FRAME_HEADROOM + nhdr;
+    char *hdr = hm_palloc(gc->pool, nframe);
+    if(!hdr) {
+        hm_log(LOG_DEBUG, &gc->log, "Packet of size %d couldn't be sent", n);
+        hm_pfree(gc->pool, ref);
         return GC_ERROR;
     }
 
-    if(net_send(gc, dst.s, dst.n) != GC_OK) {
-        hm_log(LOG_DEBUG, &gc->log, "Packet of size %d couldn't be sent", dst.n);
+    struct iovec iov[GCPROTO_IOV_MAX];
+    int niov = gc_serialize_iov(hdr + GCPROTO_FRAME_HEADROOM, iov, pr);
+    assert(niov > 0);
+
+    // First header block carries frame length as well
+    iov[0].iov_base = hdr;
+    iov[0].iov_len += GCPROTO_FRAME_HEADROOM;
+
+    int len = n;
+    gc_swap_memory((void *)&len, sizeof(len));
+    memcpy(hdr, &len, GCPROTO_FRAME_HEADROOM);
+
+    // Last slot referencing a memory block releases it
+    void *mem[GCPROTO_IOV_MAX] = { NULL };
+    int i, ihdr = 0, iref = -1;
+    for(i = 0; i < niov; i++) {
+        char *base = iov[i].iov_base;
+        if(base >= hdr && base < hdr + nframe) ihdr = i;
+        else iref = i;
+    }
+    mem[ihdr] = hdr;
+    if(iref != -1) mem[iref] = ref;
+
+    struct gc_gen_client_ssl_s *c = &gc->client;
+    if(gc_ringbuffer_send_append_iov(c->base.pool, &c->base.rb,
+                                     iov, niov, mem) != GC_OK) {
+        hm_log(LOG_DEBUG, &gc->log, "Packet of size %d couldn't be sent", n);
+        hm_pfree(gc->pool, hdr);
+        hm_pfree(gc->pool, ref);
         return GC_ERROR;
     }
 
-    sn_free(gc->pool, dst);
+    ev_io_start(c->base.loop, &c->base.write);
+
+    frame_queued(gc, start);
+    gc->metrics.upstream_frames_out++;
 
     return GC_OK;
 }
 
+void gc_packet_forward(struct gc_s *gc, struct gc_gen_client_s *client, sn body)
+{
+    // Frame can't be handed over while other batch entries point into it
+    if(body.n < GC_PACKET_REF_MIN || gc->batch.unpacking || !gc->client.net.buf) {
+        gc_gen_ev_send(client, body.s, body.n);
+        return;
+    }
+
+    // Hand over whole upstream frame, body is sent straight from it
+    void *frame = gc->client.net.buf;
+    gc->client.net.buf = NULL;
+
+    struct iovec iov = { .iov_base = body.s, .iov_len = body.n };
+    if(gc_ringbuffer_send_append_iov(client->base.pool, &client->base.rb,
+                                     &iov, 1, &frame) != GC_OK) {
+        hm_pfree(gc->pool, frame);
+        return;
+    }
+
+    ev_io_start(client->base.loop, &client->base.write);
+}
+
 int gc_parse_delimiter(struct hm_pool_s *pool, sn input, char ***argv,
                        int *argc, char delimiter)
 {
@@ -151,9 +394,18 @@ int gc_backend_parse(struct hm_pool_s *pool, struct gc_config_s *cfg, const char
     json_object_object_get_ex(jobj, "backends", &backends);
     if(json_object_get_type(backends) == json_type_array) {
         array_list *backends_array = json_object_get_array(backends);
+        int nbackends = array_list_length(backends_array);
+
+        if(nbackends > 0) {
+            cfg->backends.item = hm_palloc(pool, nbackends * sizeof(*cfg->backends.item));
+            if(!cfg->backends.item) {
+                json_object_put(jobj);
+                return GC_ERROR;
+            }
+        }
 
         int i;
-        for(i = 0; i < array_list_length(backends_array); i++) {
+        for(i = 0; i < nbackends; i++) {
             struct json_object *backend = array_list_get_idx(backends_array, i);
             struct json_object *b_ip, *b_host;
 
@@ -163,8 +415,8 @@ int gc_backend_parse(struct hm_pool_s *pool, struct gc_config_s *cfg, const char
                 (char *)json_object_get_string(m_src),\
                 json_object_get_string_len(m_src));
 
-            BND(cfg->backends.item[i].ip,       "ip",       b_ip)
-            BND(cfg->backends.item[i].hostname, "hostname", b_host)
+            BND(cfg->backends.item[cfg->backends.n].ip,       "ip",       b_ip)
+            BND(cfg->backends.item[cfg->backends.n].hostname, "hostname", b_host)
 
             cfg->backends.n++;
         }
@@ -183,6 +435,66 @@ int gc_backend_parse(struct hm_pool_s *pool, struct gc_config_s *cfg, const char
     return GC_OK;
 }
 
+static int tunnel_key(char *dst, const int ndst, sn cloud, sn device,
+                      sn port, sn port_local)
+{
+    int n = snprintf(dst, ndst, "%.*s/%.*s/%.*s/%.*s", sn_p(cloud), sn_p(device),
+                                                      sn_p(port), sn_p(port_local));
+
+    return (n < 0 || n >= ndst) ? -1 : n;
+}
+
+static int tunnel_index(struct hm_pool_s *pool, struct gc_config_s *cfg,
+                        struct gc_config_tunnel_s *t)
+{
+    char key[GC_CFG_TUNNEL_KEY];
+
+    sn_itoa(port,       t->port,       8);
+    sn_itoa(port_local, t->port_local, 8);
+
+    int n = tunnel_key(key, sizeof(key), t->cloud, t->device, port, port_local);
+    if(n < 0 || ht_get(cfg->tunnels_index, key, n)) {
+        return GC_ERROR;
+    }
+
+    if(HT_ADD_WA(cfg->tunnels_index, key, n, t, sizeof(t), pool) != GC_OK) {
+        return GC_ERROR;
+    }
+
+    return GC_OK;
+}
+
+struct gc_config_tunnel_s *gc_config_tunnel_find(struct gc_config_s *cfg, sn cloud,
+                                                 sn device, sn port, sn port_local)
+{
+    char key[GC_CFG_TUNNEL_KEY];
+
+    if(!cfg->tunnels_index) return NULL;
+
+    int n = tunnel_key(key, sizeof(key), cloud, device, port, port_local);
+    if(n < 0) return NULL;
+
+    struct ht_s *kv = ht_get(cfg->tunnels_index, key, n);
+
+    return kv ? (struct gc_config_tunnel_s *)kv->s : NULL;
+}
+
+int gc_config_tunnel_port_local(struct hm_pool_s *pool, struct gc_config_s *cfg,
+                                struct gc_config_tunnel_s *t, const int port_local)
+{
+    char key[GC_CFG_TUNNEL_KEY];
+
+    sn_itoa(port,     t->port,       8);
+    sn_itoa(old_local, t->port_local, 8);
+
+    int n = tunnel_key(key, sizeof(key), t->cloud, t->device, port, old_local);
+    if(n >= 0) ht_rem(cfg->tunnels_index, key, n, pool);
+
+    t->port_local = port_local;
+
+    return tunnel_index(pool, cfg, t);
+}
+
 int gc_config_parse(struct hm_pool_s *pool, struct gc_config_s *cfg, const char *path)
 {
     char *content;
@@ -203,9 +515,14 @@ int gc_config_parse(struct hm_pool_s *pool, struct gc_config_s *cfg, const char
     json_tokener_free(tok);
 
     if(jobj == NULL) {
+        hm_pfree(pool, content);
         return GC_ERROR;
     }
 
+    // Owned by config from now on, even if parsing fails
+    cfg->jobj = jobj;
+    cfg->content = content;
+
 #define PRS(m_v, m_type)\
     struct json_object *m_v;\
     json_object_object_get_ex(jobj, #m_v, &m_v);\
@@ -240,15 +557,51 @@ int gc_config_parse(struct hm_pool_s *pool, struct gc_config_s *cfg, const char
             json_object_get_string_len(action));
     }
 
+    struct json_object *batch;
+    json_object_object_get_ex(jobj, "batch", &batch);
+    if(json_object_get_type(batch) == json_type_boolean) {
+        cfg->batch = json_object_get_boolean(batch);
+    }
+
     struct json_object *allow;
     json_object_object_get_ex(jobj, "allow", &allow);
-    if(json_object_get_type(allow) == json_type_array) {
-        array_list *allow_array = json_object_get_array(allow);
+    cfg->nallowed = gc_policy_compile(pool, &cfg->policy, allow, cfg->log);
+
+    struct json_object *keepalive;
+    json_object_object_get_ex(jobj, "keepalive", &keepalive);
+    if(json_object_get_type(keepalive) == json_type_array) {
+        array_list *keepalive_array = json_object_get_array(keepalive);
+        int nkeepalive = array_list_length(keepalive_array);
+
+        if(nkeepalive > 0) {
+            cfg->keepalive = hm_palloc(pool, nkeepalive * sizeof(*cfg->keepalive));
+            if(!cfg->keepalive) {
+                return GC_ERROR;
+            }
+        }
+
         int i;
-        for(i = 0; i < array_list_length(allow_array); i++) {
-            struct json_object *port = array_list_get_idx(allow_array, i);
-            cfg->allowed[i] = json_object_get_int(port);
-            cfg->nallowed++;
+        for(i = 0; i < nkeepalive; i++) {
+            struct json_object *item = array_list_get_idx(keepalive_array, i);
+            struct json_object *k_port, *k_idle, *k_timeout;
+            struct gc_config_keepalive_s *k;
+
+            k = &cfg->keepalive[cfg->nkeepalive];
+
+            json_object_object_get_ex(item, "port",    &k_port);
+            json_object_object_get_ex(item, "idle",    &k_idle);
+            json_object_object_get_ex(item, "timeout", &k_timeout);
+
+            k->port    = json_object_get_int(k_port);
+            k->idle    = k_idle    ? json_object_get_int(k_idle)    : GC_CONNPOOL_IDLE;
+            k->timeout = k_timeout ? json_object_get_int(k_timeout) : GC_CONNPOOL_TIMEOUT;
+
+            if(k->port <= 0 || k->idle <= 0 || k->timeout <= 0) {
+                hm_log(LOG_WARNING, cfg->log, "Ignoring malformed keepalive element %d", i);
+                continue;
+            }
+
+            cfg->nkeepalive++;
         }
     }
 
@@ -256,11 +609,21 @@ int gc_config_parse(struct hm_pool_s *pool, struct gc_config_s *cfg, const char
     json_object_object_get_ex(jobj, "tunnels", &tunnels);
     if(json_object_get_type(tunnels) == json_type_array) {
         array_list *tunnels_array = json_object_get_array(tunnels);
+        int ntunnels = array_list_length(tunnels_array);
+
+        if(ntunnels > 0) {
+            cfg->tunnels = hm_palloc(pool, ntunnels * sizeof(*cfg->tunnels));
+            cfg->tunnels_index = ht_init(pool);
+            if(!cfg->tunnels || !cfg->tunnels_index) {
+                return GC_ERROR;
+            }
+        }
 
         int i;
-        for(i = 0; i < array_list_length(tunnels_array); i++) {
+        for(i = 0; i < ntunnels; i++) {
             struct json_object *tunnel = array_list_get_idx(tunnels_array, i);
-            struct json_object *t_cloud, *t_device, *t_port, *t_port_local;
+            struct json_object *t_cloud, *t_device, *t_port, *t_port_local, *t_codec;
+            struct gc_config_tunnel_s *t = &cfg->tunnels[cfg->ntunnels];
 
 #define TUN(m_dst, m_name, m_src)\
         json_object_object_get_ex(tunnel, m_name, &m_src);\
@@ -272,21 +635,32 @@ int gc_config_parse(struct hm_pool_s *pool, struct gc_config_s *cfg, const char
         json_object_object_get_ex(tunnel, m_name, &m_src);\
         m_dst = json_object_get_int(m_src);
 
-            TUN(cfg->tunnels[i].cloud,      "cloud",     t_cloud)
-            TUN(cfg->tunnels[i].device,     "device",    t_device)
+            TUN(t->cloud,      "cloud",     t_cloud)
+            TUN(t->device,     "device",    t_device)
 
-            TUN_INT(cfg->tunnels[i].port,       "port",      t_port)
-            TUN_INT(cfg->tunnels[i].port_local, "portLocal", t_port_local)
+            TUN_INT(t->port,       "port",      t_port)
+            TUN_INT(t->port_local, "portLocal", t_port_local)
 
-            cfg->tunnels[i].pid.n = 0;
+            sn codec;
+            TUN(codec, "compression", t_codec)
+            t->codec = gc_codec_parse(codec);
+            if(codec.n > 0 && t->codec == GC_CODEC_NONE) {
+                hm_log(LOG_WARNING, cfg->log, "Unknown compression [%.*s]", sn_p(codec));
+            }
+
+            t->pid.n = 0;
+            t->pairing = 0;
+            t->port_local_config = t->port_local;
+
+            if(tunnel_index(pool, cfg, t) != GC_OK) {
+                hm_log(LOG_WARNING, cfg->log, "Ignoring duplicate tunnel element %d", i);
+                continue;
+            }
 
             cfg->ntunnels++;
         }
     }
 
-    cfg->jobj = jobj;
-    cfg->content = content;
-
     return GC_OK;
 }
 
@@ -298,22 +672,27 @@ void gc_config_dump(struct gc_config_s *cfg)
     hm_log(LOG_DEBUG, cfg->log, "Username: [%.*s]", sn_p(cfg->username));
     hm_log(LOG_DEBUG, cfg->log, "Password: [%s]", cfg->password.n > 0 ? "Set" : "Not Set");
     hm_log(LOG_DEBUG, cfg->log, "Device: [%.*s]", sn_p(cfg->device));
+    hm_log(LOG_DEBUG, cfg->log, "Batching: [%s]", cfg->batch ? "On" : "Off");
 
-    hm_log(LOG_DEBUG, cfg->log, "Allowed ports total: [%d]", cfg->nallowed);
+    gc_policy_dump(&cfg->policy, cfg->log);
 
-    for(i = 0; i < cfg->nallowed; i++) {
-        hm_log(LOG_DEBUG, cfg->log, "Allowed port: [%d]", cfg->allowed[i]);
+    for(i = 0; i < cfg->nkeepalive; i++) {
+        hm_log(LOG_DEBUG, cfg->log, "Keepalive port: [%d] Idle: [%d] Timeout: [%d]",
+                                    cfg->keepalive[i].port,
+                                    cfg->keepalive[i].idle,
+                                    cfg->keepalive[i].timeout);
     }
 
     hm_log(LOG_DEBUG, cfg->log, "Allowed tunnels total: [%d]", cfg->ntunnels);
 
     for(i = 0; i < cfg->ntunnels; i++) {
-        hm_log(LOG_DEBUG, cfg->log, "Tunnel %d: Cloud: [%.*s] Device: [%.*s] Port: [%d] Local port: [%d]",
+        hm_log(LOG_DEBUG, cfg->log, "Tunnel %d: Cloud: [%.*s] Device: [%.*s] Port: [%d] Local port: [%d] Compression: [%s]",
                                     i,
                                     sn_p(cfg->tunnels[i].cloud),
                                     sn_p(cfg->tunnels[i].device),
                                     cfg->tunnels[i].port,
-                                    cfg->tunnels[i].port_local);
+                                    cfg->tunnels[i].port_local,
+                                    gc_codec_name(cfg->tunnels[i].codec));
     }
 
     hm_log(LOG_DEBUG, cfg->log, "Backends total: [%d]", cfg->backends.n);
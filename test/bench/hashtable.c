@@ -0,0 +1,216 @@
+/*
+ *
+ * GrizzlyCloud library - simplified VPN alternative for IoT
+ * Copyright (C) 2017 - 2018 Filip Pancik
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <gc.h>
+
+#define LOOKUPS 1000000
+
+/*
+ * Hashtable as it was before open addressing: fixed array of
+ * HT_MAX chains, key hashed by summing its bytes.
+ */
+#define LEGACY_MAX (1 << 12)
+
+struct legacy_s {
+    char            *k;
+    int             nk;
+    char            *s;
+    struct legacy_s *next;
+};
+
+static void legacy_key(int *dst, const char *key, const int nkey)
+{
+    int i;
+
+    for(i = 0; i < nkey; i++) {
+        *dst += key[i];
+    }
+
+    *dst %= LEGACY_MAX;
+}
+
+static struct legacy_s **legacy_init(struct hm_pool_s *pool)
+{
+    struct legacy_s **ht = hm_palloc(pool, sizeof(void *) * LEGACY_MAX);
+    memset(ht, 0, sizeof(void *) * LEGACY_MAX);
+    return ht;
+}
+
+static void legacy_add(struct legacy_s **ht, const char *key, const int nkey,
+                       void *value, struct hm_pool_s *pool)
+{
+    struct legacy_s *h;
+    int index = 0;
+
+    legacy_key(&index, key, nkey);
+
+    for(h = ht[index]; h != NULL; h = h->next) {
+        if(nkey == h->nk && memcmp(key, h->k, nkey) == 0) {
+            h->s = value;
+            return;
+        }
+    }
+
+    h = hm_palloc(pool, sizeof(*h));
+    h->nk = nkey;
+    h->k = hm_palloc(pool, nkey);
+    memcpy(h->k, key, nkey);
+    h->s = value;
+
+    h->next = ht[index];
+    ht[index] = h;
+}
+
+static struct legacy_s *legacy_get(struct legacy_s **ht, const char *key, const int nkey)
+{
+    struct legacy_s *h;
+    int index = 0;
+
+    legacy_key(&index, key, nkey);
+
+    for(h = ht[index]; h != NULL; h = h->next) {
+        if(h->nk == nkey && memcmp(h->k, key, nkey) == 0) {
+            return h;
+        }
+    }
+
+    return NULL;
+}
+
+static void legacy_rem(struct legacy_s **ht, const char *key, const int nkey,
+                       struct hm_pool_s *pool)
+{
+    struct legacy_s *h, *prev;
+    int index = 0;
+
+    legacy_key(&index, key, nkey);
+
+    for(h = ht[index], prev = NULL; h != NULL; prev = h, h = h->next) {
+        if(nkey == h->nk && memcmp(h->k, key, nkey) == 0) {
+            if(prev == NULL) ht[index] = h->next;
+            else prev->next = h->next;
+
+            hm_pfree(pool, h->k);
+            hm_pfree(pool, h);
+            return;
+        }
+    }
+}
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static char (*keys)[16];
+
+static void bench(struct hm_pool_s *pool, int n)
+{
+    int i;
+    double t0, t1, t2, t3;
+    double legacy[3], open[3];
+
+    // Legacy chains get long, keep the run short
+    int lookups = n >= 100000 ? LOOKUPS / 10 : LOOKUPS;
+
+    for(i = 0; i < n; i++) {
+        snprintf(keys[i], sizeof(keys[i]), "%u", i + 3);
+    }
+
+    // Legacy
+    struct legacy_s **lht = legacy_init(pool);
+
+    t0 = now();
+    for(i = 0; i < n; i++) {
+        legacy_add(lht, keys[i], strlen(keys[i]), keys[i], pool);
+    }
+    t1 = now();
+    for(i = 0; i < lookups; i++) {
+        struct legacy_s *h = legacy_get(lht, keys[i % n], strlen(keys[i % n]));
+        assert(h && h->s == keys[i % n]);
+    }
+    t2 = now();
+    for(i = 0; i < n; i++) {
+        legacy_rem(lht, keys[i], strlen(keys[i]), pool);
+    }
+    t3 = now();
+
+    legacy[0] = (t1 - t0) * 1e9 / n;
+    legacy[1] = (t2 - t1) * 1e9 / lookups;
+    legacy[2] = (t3 - t2) * 1e9 / n;
+
+    hm_pfree(pool, lht);
+
+    // Open addressing
+    struct ht_table_s *ht = ht_init(pool);
+
+    t0 = now();
+    for(i = 0; i < n; i++) {
+        HT_ADD_WA(ht, keys[i], strlen(keys[i]), keys[i], sizeof(keys[i]), pool);
+    }
+    t1 = now();
+    for(i = 0; i < lookups; i++) {
+        struct ht_s *h = ht_get(ht, keys[i % n], strlen(keys[i % n]));
+        assert(h && h->s == keys[i % n]);
+    }
+    t2 = now();
+    for(i = 0; i < n; i++) {
+        HT_REM(ht, keys[i], strlen(keys[i]), pool);
+    }
+    t3 = now();
+
+    open[0] = (t1 - t0) * 1e9 / n;
+    open[1] = (t2 - t1) * 1e9 / lookups;
+    open[2] = (t3 - t2) * 1e9 / n;
+
+    ht_free(ht, pool);
+
+    printf("%7d keys  add %8.1f -> %6.1f ns  get %8.1f -> %6.1f ns  x%.1f  rem %8.1f -> %6.1f ns\n",
+           n, legacy[0], open[0], legacy[1], open[1], legacy[1] / open[1],
+           legacy[2], open[2]);
+}
+
+int main()
+{
+    struct hm_pool_s *pool;
+    struct hm_log_s glog;
+
+    hm_log_open(&glog, NULL, LOG_ERR);
+    pool = hm_create_pool();
+    if(pool == NULL) return 1;
+    pool->log = &glog;
+
+    int sizes[] = { 10, 1000, 100000 };
+    int i;
+
+    keys = malloc(sizeof(*keys) * sizes[COUNT(sizes) - 1]);
+    if(keys == NULL) return 1;
+
+    printf("legacy -> open addressing, numeric keys as used for stream IDs\n");
+    for(i = 0; i < (int)COUNT(sizes); i++) {
+        bench(pool, sizes[i]);
+    }
+
+    free(keys);
+    hm_destroy_pool(pool);
+
+    return 0;
+}
@@ -0,0 +1,133 @@
+/*
+ *
+ * GrizzlyCloud library - simplified VPN alternative for IoT
+ * Copyright (C) 2017 - 2018 Filip Pancik
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <gc.h>
+
+#define ITERATIONS 1000000
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double wallclock()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Log site as it was before the level check moved into hm_log():
+ * arguments evaluated and hm_log_impl() called regardless of level.
+ */
+#define legacy_log(t, l, fmt...)\
+    hm_log_impl(t, l, __FILE__, __LINE__, __FUNCTION__, fmt)
+
+static const char *tp(int i)
+{
+    static char buf[64];
+    snprintf(buf, sizeof(buf), "tunnel_request/22/%d/8888", i);
+    return buf;
+}
+
+static void report(const char *name, double t0, double t1, int n)
+{
+    printf("%-32s %8.1f ns\n", name, (t1 - t0) * 1e9 / n);
+}
+
+int main()
+{
+    struct hm_log_s log;
+    double t0, t1;
+    int i;
+
+    sn_initz(address, "0123456789abcdef");
+
+    // Disabled trace site
+    hm_log_open(&log, "/dev/null", LOG_ERR);
+
+    t0 = now();
+    for(i = 0; i < ITERATIONS; i++) {
+        legacy_log(LOG_TRACE, &log, "Message %.*s %s", sn_p(address), tp(i));
+    }
+    t1 = now();
+    report("disabled, legacy call", t0, t1, ITERATIONS);
+
+    t0 = now();
+    for(i = 0; i < ITERATIONS; i++) {
+        hm_log(LOG_TRACE, &log, "Message %.*s %s", sn_p(address), tp(i));
+    }
+    t1 = now();
+    report("disabled, inline check", t0, t1, ITERATIONS);
+
+    hm_log_close(&log);
+
+    // Enabled site written to /dev/null
+    hm_log_open(&log, "/dev/null", LOG_TRACE);
+
+    t0 = now();
+    for(i = 0; i < ITERATIONS; i++) {
+        hm_log(LOG_TRACE, &log, "Message %.*s %s", sn_p(address), tp(i));
+    }
+    t1 = now();
+    report("enabled, clock per message", t0, t1, ITERATIONS);
+
+    // Loop iteration handling 16 messages
+    t0 = now();
+    for(i = 0; i < ITERATIONS; i++) {
+        if((i & 15) == 0) hm_log_clock(&log, wallclock());
+        hm_log(LOG_TRACE, &log, "Message %.*s %s", sn_p(address), tp(i));
+    }
+    t1 = now();
+    report("enabled, cached clock", t0, t1, ITERATIONS);
+
+    if(hm_log_async_start(&log, 4096, HM_LOG_OVERFLOW_BLOCK) == GC_OK) {
+        t0 = now();
+        for(i = 0; i < ITERATIONS; i++) {
+            if((i & 15) == 0) hm_log_clock(&log, wallclock());
+            hm_log(LOG_TRACE, &log, "Message %.*s %s", sn_p(address), tp(i));
+        }
+        t1 = now();
+        report("enabled, cached clock, async", t0, t1, ITERATIONS);
+        hm_log_async_stop(&log);
+    }
+
+    hm_log_close(&log);
+
+    // Same site recorded by binary trace instead of text log
+    hm_log_open(&log, "/dev/null", LOG_ERR);
+
+    if(hm_log_trace_open(&log, "/tmp/gc_bench.trace", 16 * 1024 * 1024, LOG_TRACE) == GC_OK) {
+        t0 = now();
+        for(i = 0; i < ITERATIONS; i++) {
+            hm_log(LOG_TRACE, &log, "Message %.*s %s", sn_p(address), tp(i));
+        }
+        t1 = now();
+        report("enabled, binary trace", t0, t1, ITERATIONS);
+        hm_log_trace_close(&log);
+        unlink("/tmp/gc_bench.trace");
+    }
+
+    hm_log_close(&log);
+
+    return 0;
+}
@@ -0,0 +1,968 @@
+/*
+ *
+ * GrizzlyCloud library - simplified VPN alternative for IoT
+ * Copyright (C) 2017 - 2018 Filip Pancik
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <gc.h>
+#include <poll.h>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+
+#define LATENCY_ROUNDS      10000
+#define LATENCY_PAYLOAD     64
+#define THROUGHPUT_BYTES    (256 * 1024 * 1024)
+#define THROUGHPUT_CHUNK    (16 * 1024)
+#define CONNECTIONS         200
+
+#define PATTERN_PERIOD      65521
+#define PATTERN_SIZE        (PATTERN_PERIOD + 64 * 1024)
+
+#define MAX_SESSIONS        8
+#define READY_TIMEOUT       15.0
+#define IO_TIMEOUT          10
+
+/*
+ * Loopback benchmark: two library instances talk through a mock
+ * upstream running in its own thread. "tunnel" instance listens on
+ * local port and forwards to "endpoint" instance, which connects
+ * to an echo backend. Load is generated from another thread.
+ *
+ *   load -> tunnel gc -> mock upstream -> endpoint gc -> echo
+ */
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Mock upstream accepts any login, pairs devices that are logged in
+ * and relays MESSAGE_TO to the session it is addressed to as
+ * MESSAGE_FROM. Each frame is written by single SSL_write().
+ */
+struct session_s {
+    int  fd;
+    SSL  *ssl;
+    char pid[16];
+    char cloud[64];
+    char device[64];
+    char *buf;                  /* Received data not framed yet. */
+    int  n;
+    int  size;
+    int  closed;
+    struct session_s *next;
+};
+
+struct upstream_s {
+    int       fd;
+    int       port;
+    int       stop[2];
+    int       nsessions;
+    SSL_CTX   *ctx;
+    pthread_t thread;
+    struct session_s *sessions;
+};
+
+static SSL_CTX *upstream_ctx()
+{
+    EVP_PKEY *key = NULL;
+    EVP_PKEY_CTX *kctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, NULL);
+
+    // Throwaway certificate, tunnel side doesn't verify it
+    if(!kctx || EVP_PKEY_keygen_init(kctx) <= 0 ||
+       EVP_PKEY_CTX_set_rsa_keygen_bits(kctx, 2048) <= 0 ||
+       EVP_PKEY_keygen(kctx, &key) <= 0) {
+        if(kctx) EVP_PKEY_CTX_free(kctx);
+        return NULL;
+    }
+    EVP_PKEY_CTX_free(kctx);
+
+    X509 *x = X509_new();
+    ASN1_INTEGER_set(X509_get_serialNumber(x), 1);
+    X509_gmtime_adj(X509_get_notBefore(x), 0);
+    X509_gmtime_adj(X509_get_notAfter(x), 3600);
+    X509_set_pubkey(x, key);
+
+    X509_NAME *name = X509_get_subject_name(x);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                               (unsigned char *)"localhost", -1, -1, 0);
+    X509_set_issuer_name(x, name);
+    X509_sign(x, key, EVP_sha256());
+
+#if (OPENSSL_VERSION_NUMBER <= 0x100020ffL)
+    SSL_CTX *ctx = SSL_CTX_new(SSLv23_server_method());
+#else
+    SSL_CTX *ctx = SSL_CTX_new(TLS_server_method());
+#endif
+
+    if(ctx && (SSL_CTX_use_certificate(ctx, x) != 1 ||
+               SSL_CTX_use_PrivateKey(ctx, key) != 1)) {
+        SSL_CTX_free(ctx);
+        ctx = NULL;
+    }
+
+    X509_free(x);
+    EVP_PKEY_free(key);
+
+    return ctx;
+}
+
+static int listen_local(int *port)
+{
+    struct sockaddr_in addr;
+    socklen_t naddr = sizeof(addr);
+    int flag = 1;
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if(fd == -1) return -1;
+
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag));
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if(bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+       listen(fd, 512) != 0 ||
+       getsockname(fd, (struct sockaddr *)&addr, &naddr) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    *port = ntohs(addr.sin_port);
+
+    return fd;
+}
+
+static void nodelay(int fd)
+{
+    int flag = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+}
+
+static int session_send(struct session_s *s, struct proto_s *p)
+{
+    int n = gc_serialize_size(p);
+    if(n < 0) return GC_ERROR;
+
+    char *frame = malloc(GCPROTO_FRAME_HEADROOM + n);
+    if(!frame) return GC_ERROR;
+
+    int len = gc_serialize_write(frame + GCPROTO_FRAME_HEADROOM, p);
+    gc_swap_memory((void *)&len, sizeof(len));
+    memcpy(frame, &len, GCPROTO_FRAME_HEADROOM);
+
+    int ret = SSL_write(s->ssl, frame, GCPROTO_FRAME_HEADROOM + n);
+    free(frame);
+
+    return ret == GCPROTO_FRAME_HEADROOM + n ? GC_OK : GC_ERROR;
+}
+
+static struct session_s *session_find(struct upstream_s *up, sn cloud, sn device, sn pid)
+{
+    struct session_s *s;
+
+    for(s = up->sessions; s != NULL; s = s->next) {
+        if(s->closed) continue;
+
+        if(pid.n > 0 && sn_memcmp(s->pid, strlen(s->pid), pid.s, pid.n)) return s;
+
+        if(pid.n == 0 &&
+           sn_memcmp(s->cloud,  strlen(s->cloud),  cloud.s,  cloud.n) &&
+           sn_memcmp(s->device, strlen(s->device), device.s, device.n)) return s;
+    }
+
+    return NULL;
+}
+
+static char *list_put(char *dst, const char *src, int nsrc)
+{
+    int n = nsrc;
+    gc_swap_memory((void *)&n, sizeof(n));
+    memcpy(dst, &n, sizeof(n));
+    memcpy(dst + sizeof(n), src, nsrc);
+
+    return dst + sizeof(n) + nsrc;
+}
+
+static void session_pair(struct upstream_s *up, struct session_s *s, struct proto_s *p)
+{
+    struct proto_s r = { .type = DEVICE_PAIR_REPLY };
+    sn_initr(nopid, "", 0);
+    char list[256], *end;
+
+    sn_set(r.u.device_pair_reply.cloud, p->u.device_pair.cloud);
+
+    struct session_s *peer = session_find(up, p->u.device_pair.cloud,
+                                          p->u.device_pair.device, nopid);
+    if(!peer || p->u.device_pair.local_port.n + p->u.device_pair.remote_port.n > 64) {
+        sn_setr(r.u.device_pair_reply.error, "offline", 7);
+        session_send(s, &r);
+        return;
+    }
+
+    // Pair reply to requester
+    end = list_put(list, peer->pid, strlen(peer->pid));
+    end = list_put(end, peer->device, strlen(peer->device));
+    end = list_put(end, p->u.device_pair.local_port.s, p->u.device_pair.local_port.n);
+    end = list_put(end, p->u.device_pair.remote_port.s, p->u.device_pair.remote_port.n);
+
+    sn_setr(r.u.device_pair_reply.error, "ok", 2);
+    sn_setr(r.u.device_pair_reply.list, list, end - list);
+    sn_setr(r.u.device_pair_reply.type, "device", 6);
+    session_send(s, &r);
+
+    // Peer is forced to know about requester
+    end = list_put(list, s->pid, strlen(s->pid));
+    end = list_put(end, s->device, strlen(s->device));
+    end = list_put(end, p->u.device_pair.local_port.s, p->u.device_pair.local_port.n);
+    end = list_put(end, p->u.device_pair.remote_port.s, p->u.device_pair.remote_port.n);
+
+    sn_setr(r.u.device_pair_reply.cloud, s->cloud, strlen(s->cloud));
+    sn_setr(r.u.device_pair_reply.list, list, end - list);
+    sn_setr(r.u.device_pair_reply.type, "forced", 6);
+    session_send(peer, &r);
+}
+
+static void session_handle(struct upstream_s *up, struct session_s *s, struct proto_s *p)
+{
+    switch(p->type) {
+        case ACCOUNT_LOGIN: {
+            snprintf(s->cloud,  sizeof(s->cloud),  "%.*s", sn_p(p->u.account_login.email));
+            snprintf(s->device, sizeof(s->device), "%.*s", sn_p(p->u.account_login.devname));
+
+            struct proto_s r = { .type = ACCOUNT_LOGIN_REPLY };
+            sn_setr(r.u.account_login_reply.error, "ok", 2);
+            session_send(s, &r);
+        }
+        break;
+        case DEVICE_PAIR:
+            session_pair(up, s, p);
+        break;
+        case MESSAGE_TO: {
+            sn_initr(nocloud, "", 0);
+            struct session_s *peer = session_find(up, nocloud, nocloud,
+                                                  p->u.message_to.address);
+            if(!peer) break;
+
+            struct proto_s r = { .type = MESSAGE_FROM };
+            sn_setr(r.u.message_from.from_cloud,   s->cloud,  strlen(s->cloud));
+            sn_setr(r.u.message_from.from_device,  s->device, strlen(s->device));
+            sn_setr(r.u.message_from.from_address, s->pid,    strlen(s->pid));
+            sn_set(r.u.message_from.tp,   p->u.message_to.tp);
+            sn_set(r.u.message_from.body, p->u.message_to.body);
+            session_send(peer, &r);
+        }
+        break;
+        default:
+        break;
+    }
+}
+
+static int session_read(struct upstream_s *up, struct session_s *s)
+{
+    char tmp[RB_SLOT_SIZE];
+
+    do {
+        int t = SSL_read(s->ssl, tmp, sizeof(tmp));
+        if(t <= 0) return GC_ERROR;
+
+        if(s->n + t > s->size) {
+            int size = (s->n + t) * 2;
+            char *buf = realloc(s->buf, size);
+            if(!buf) return GC_ERROR;
+
+            s->buf = buf;
+            s->size = size;
+        }
+
+        memcpy(s->buf + s->n, tmp, t);
+        s->n += t;
+    } while(SSL_pending(s->ssl) > 0);
+
+    int offset = 0;
+    while(s->n - offset >= GCPROTO_FRAME_HEADROOM) {
+        int len;
+        memcpy(&len, s->buf + offset, sizeof(len));
+        gc_swap_memory((void *)&len, sizeof(len));
+
+        if(len < 0) return GC_ERROR;
+        if(s->n - offset - GCPROTO_FRAME_HEADROOM < len) break;
+
+        struct proto_s p;
+        sn src = { .s = s->buf + offset + GCPROTO_FRAME_HEADROOM, .n = len };
+        if(gc_deserialize(&p, &src) != 0) return GC_ERROR;
+
+        session_handle(up, s, &p);
+
+        offset += GCPROTO_FRAME_HEADROOM + len;
+    }
+
+    memmove(s->buf, s->buf + offset, s->n - offset);
+    s->n -= offset;
+
+    return GC_OK;
+}
+
+static void session_free(struct session_s *s)
+{
+    SSL_free(s->ssl);
+    close(s->fd);
+    free(s->buf);
+    free(s);
+}
+
+static void upstream_accept(struct upstream_s *up)
+{
+    int fd = accept(up->fd, NULL, NULL);
+    if(fd == -1) return;
+
+    struct session_s *s = calloc(1, sizeof(*s));
+    if(!s || up->nsessions == MAX_SESSIONS) {
+        free(s);
+        close(fd);
+        return;
+    }
+
+    nodelay(fd);
+
+    s->fd = fd;
+    s->ssl = SSL_new(up->ctx);
+    SSL_set_fd(s->ssl, fd);
+
+    if(SSL_accept(s->ssl) != 1) {
+        session_free(s);
+        return;
+    }
+
+    snprintf(s->pid, sizeof(s->pid), "mock%d", fd);
+
+    s->next = up->sessions;
+    up->sessions = s;
+    up->nsessions++;
+}
+
+static void *upstream_run(void *arg)
+{
+    struct upstream_s *up = arg;
+    struct session_s *sessions[MAX_SESSIONS], *s, **prev;
+    struct pollfd fds[2 + MAX_SESSIONS];
+
+    for(;;) {
+        int i, n = 0;
+
+        fds[n].fd = up->stop[0];
+        fds[n++].events = POLLIN;
+        fds[n].fd = up->fd;
+        fds[n++].events = POLLIN;
+
+        for(s = up->sessions; s != NULL; s = s->next) {
+            sessions[n - 2] = s;
+            fds[n].fd = s->fd;
+            fds[n++].events = POLLIN;
+        }
+
+        if(poll(fds, n, -1) < 0) {
+            if(errno == EINTR) continue;
+            break;
+        }
+
+        if(fds[0].revents) break;
+
+        for(i = 2; i < n; i++) {
+            if(fds[i].revents && session_read(up, sessions[i - 2]) != GC_OK) {
+                sessions[i - 2]->closed = 1;
+            }
+        }
+
+        for(prev = &up->sessions; *prev != NULL; ) {
+            s = *prev;
+            if(!s->closed) {
+                prev = &s->next;
+                continue;
+            }
+
+            *prev = s->next;
+            up->nsessions--;
+            session_free(s);
+        }
+
+        if(fds[1].revents & POLLIN) upstream_accept(up);
+    }
+
+    return NULL;
+}
+
+static int upstream_start(struct upstream_s *up)
+{
+    memset(up, 0, sizeof(*up));
+
+    up->ctx = upstream_ctx();
+    if(!up->ctx) return GC_ERROR;
+
+    up->fd = listen_local(&up->port);
+    if(up->fd == -1 || pipe(up->stop) != 0) return GC_ERROR;
+
+    if(pthread_create(&up->thread, NULL, upstream_run, up) != 0) return GC_ERROR;
+
+    return GC_OK;
+}
+
+static void upstream_stop(struct upstream_s *up)
+{
+    struct session_s *s, *next;
+
+    if(write(up->stop[1], "", 1) != 1) return;
+    pthread_join(up->thread, NULL);
+
+    for(s = up->sessions; s != NULL; s = next) {
+        next = s->next;
+        session_free(s);
+    }
+
+    close(up->stop[0]);
+    close(up->stop[1]);
+    close(up->fd);
+    SSL_CTX_free(up->ctx);
+}
+
+/*
+ * Echo backend behind "endpoint" instance, thread per connection.
+ */
+struct echo_s {
+    int       fd;
+    int       port;
+    pthread_t thread;
+};
+
+static int write_all(int fd, const char *buf, int len)
+{
+    while(len > 0) {
+        int t = write(fd, buf, len);
+        if(t <= 0) return GC_ERROR;
+        buf += t;
+        len -= t;
+    }
+
+    return GC_OK;
+}
+
+static void *echo_client(void *arg)
+{
+    int fd = (int)(intptr_t)arg;
+    char buf[RB_SLOT_SIZE];
+    int t;
+
+    nodelay(fd);
+
+    while((t = read(fd, buf, sizeof(buf))) > 0) {
+        if(write_all(fd, buf, t) != GC_OK) break;
+    }
+
+    close(fd);
+
+    return NULL;
+}
+
+static void *echo_run(void *arg)
+{
+    struct echo_s *e = arg;
+    pthread_t thread;
+    pthread_attr_t attr;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+    for(;;) {
+        int fd = accept(e->fd, NULL, NULL);
+        if(fd == -1) {
+            if(errno == EINTR || errno == ECONNABORTED) continue;
+            break;
+        }
+
+        if(pthread_create(&thread, &attr, echo_client, (void *)(intptr_t)fd) != 0) {
+            close(fd);
+        }
+    }
+
+    pthread_attr_destroy(&attr);
+
+    return NULL;
+}
+
+/*
+ * Load generator, runs once tunnel is paired.
+ */
+struct load_s {
+    int             port;
+    int             failed;
+    int             corrupted;
+    double          mbps;
+    double          connps;
+    struct gc_histogram_s latency;
+    struct ev_loop  *loop;
+    struct ev_async done;
+    pthread_t       thread;
+};
+
+static int load_connect(int port)
+{
+    struct sockaddr_in addr;
+    struct timeval tv = { .tv_sec = IO_TIMEOUT };
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if(fd == -1) return -1;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    nodelay(fd);
+
+    if(connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/*
+ * Pseudo-random bytes repeating with prime period, byte at stream
+ * offset k is pattern[k % PATTERN_PERIOD]. Echoed data is compared
+ * against it, so lost, duplicated or reordered bytes are noticed.
+ */
+static char pattern[PATTERN_SIZE];
+
+static void pattern_init()
+{
+    unsigned int x = 2463534242u;
+    int i;
+
+    for(i = 0; i < PATTERN_PERIOD; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        pattern[i] = x;
+    }
+
+    for(; i < PATTERN_SIZE; i++) {
+        pattern[i] = pattern[i - PATTERN_PERIOD];
+    }
+}
+
+static const char *pattern_at(long long offset)
+{
+    return pattern + offset % PATTERN_PERIOD;
+}
+
+static int pattern_check(struct load_s *l, long long offset, const char *buf, int len)
+{
+    if(memcmp(buf, pattern_at(offset), len) == 0) return GC_OK;
+
+    l->corrupted = 1;
+
+    return GC_ERROR;
+}
+
+static int read_all(int fd, char *buf, int len)
+{
+    while(len > 0) {
+        int t = read(fd, buf, len);
+        if(t <= 0) return GC_ERROR;
+        buf += t;
+        len -= t;
+    }
+
+    return GC_OK;
+}
+
+static int load_latency(struct load_s *l)
+{
+    char in[LATENCY_PAYLOAD];
+    int i;
+
+    int fd = load_connect(l->port);
+    if(fd == -1) return GC_ERROR;
+
+    for(i = 0; i < LATENCY_ROUNDS; i++) {
+        long long offset = (long long)i * LATENCY_PAYLOAD;
+        unsigned long long start = gc_metrics_now();
+
+        if(write_all(fd, pattern_at(offset), LATENCY_PAYLOAD) != GC_OK ||
+           read_all(fd, in, sizeof(in)) != GC_OK) {
+            close(fd);
+            return GC_ERROR;
+        }
+
+        gc_histogram_record(&l->latency, gc_metrics_now() - start);
+
+        if(pattern_check(l, offset, in, sizeof(in)) != GC_OK) {
+            close(fd);
+            return GC_ERROR;
+        }
+    }
+
+    close(fd);
+
+    return GC_OK;
+}
+
+static int load_throughput(struct load_s *l)
+{
+    static char in[RB_SLOT_SIZE];
+    long long sent = 0, received = 0;
+
+    int fd = load_connect(l->port);
+    if(fd == -1) return GC_ERROR;
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    double t0 = now();
+
+    // Everything sent is echoed back, read while writing
+    while(received < THROUGHPUT_BYTES) {
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        if(sent < THROUGHPUT_BYTES) pfd.events |= POLLOUT;
+
+        if(poll(&pfd, 1, IO_TIMEOUT * 1000) <= 0) break;
+
+        if(pfd.revents & POLLOUT) {
+            long long left = THROUGHPUT_BYTES - sent;
+            int t = write(fd, pattern_at(sent), left < THROUGHPUT_CHUNK ? left : THROUGHPUT_CHUNK);
+            if(t > 0) sent += t;
+        }
+
+        if(pfd.revents & (POLLIN | POLLHUP | POLLERR)) {
+            int t = read(fd, in, sizeof(in));
+            if(t <= 0 && !(t == -1 && errno == EAGAIN)) break;
+            if(t > 0) {
+                if(pattern_check(l, received, in, t) != GC_OK) break;
+                received += t;
+            }
+        }
+    }
+
+    double t1 = now();
+
+    close(fd);
+
+    if(received < THROUGHPUT_BYTES) return GC_ERROR;
+
+    l->mbps = THROUGHPUT_BYTES / (t1 - t0) / (1024 * 1024);
+
+    return GC_OK;
+}
+
+static int load_connections(struct load_s *l)
+{
+    char c;
+    int i;
+
+    double t0 = now();
+
+    // Connection counts once its first byte made it to backend and back
+    for(i = 0; i < CONNECTIONS; i++) {
+        int fd = load_connect(l->port);
+        if(fd == -1) return GC_ERROR;
+
+        if(write_all(fd, pattern_at(i), 1) != GC_OK ||
+           read_all(fd, &c, 1) != GC_OK ||
+           pattern_check(l, i, &c, 1) != GC_OK) {
+            close(fd);
+            return GC_ERROR;
+        }
+
+        close(fd);
+    }
+
+    double t1 = now();
+
+    l->connps = CONNECTIONS / (t1 - t0);
+
+    return GC_OK;
+}
+
+static void *load_run(void *arg)
+{
+    struct load_s *l = arg;
+
+    if(load_latency(l) != GC_OK ||
+       load_throughput(l) != GC_OK ||
+       load_connections(l) != GC_OK) {
+        l->failed = 1;
+    }
+
+    ev_async_send(l->loop, &l->done);
+
+    return NULL;
+}
+
+/*
+ * Library instances.
+ */
+struct bench_s {
+    struct gc_s     *tunnel;
+    struct gc_s     *endpoint;
+    struct load_s   load;
+    struct ev_timer ready;
+    struct ev_timer finish;
+    double          started;
+    double          reuse;
+    int             port;
+    int             timeout;
+};
+
+static void callback_state_changed(struct gc_s *gc, enum gc_state_e state)
+{
+    if(state != GC_HANDSHAKE_SUCCESS) return;
+
+    struct proto_s as = { .type = ACCOUNT_LOGIN };
+    sn_set(as.u.account_login.email,    gc->config.username);
+    sn_set(as.u.account_login.password, gc->config.password);
+    sn_set(as.u.account_login.devname,  gc->config.device);
+
+    gc_packet_send(gc, &as);
+}
+
+static void finish(struct ev_loop *loop, struct ev_timer *timer, int revents)
+{
+    (void )timer;
+    (void )revents;
+
+    ev_break(loop, EVBREAK_ALL);
+}
+
+static double backend_reuse(struct gc_s *gc, int port)
+{
+    struct gc_connpool_s *pool;
+
+    for(pool = gc->connpools; pool != NULL; pool = pool->next) {
+        if(pool->port == port && pool->hits + pool->misses > 0) {
+            return 100. * pool->hits / (pool->hits + pool->misses);
+        }
+    }
+
+    return 0.;
+}
+
+static void stop(struct bench_s *b)
+{
+    gc_force_stop(b->tunnel);
+    gc_force_stop(b->endpoint);
+
+    // Instances shut down on their next timer tick
+    ev_timer_init(&b->finish, finish, 0.5, 0.);
+    ev_timer_start(b->tunnel->loop, &b->finish);
+}
+
+static void load_done(struct ev_loop *loop, struct ev_async *w, int revents)
+{
+    struct bench_s *b = w->data;
+
+    (void )loop;
+    (void )revents;
+
+    // Pools are released on stop
+    b->reuse = backend_reuse(b->endpoint, b->port);
+
+    stop(b);
+}
+
+static void ready(struct ev_loop *loop, struct ev_timer *timer, int revents)
+{
+    struct bench_s *b = timer->data;
+    struct gc_tunnel_s *t = gc_tunnels(b->tunnel);
+
+    (void )revents;
+
+    if(!t || !t->server || !b->endpoint->logged) {
+        if(now() - b->started > READY_TIMEOUT) {
+            b->timeout = 1;
+            ev_timer_stop(loop, timer);
+            stop(b);
+        }
+        return;
+    }
+
+    ev_timer_stop(loop, timer);
+
+    sn_atoi(port, t->port_local, 8);
+    b->load.port = port;
+
+    if(pthread_create(&b->load.thread, NULL, load_run, &b->load) != 0) {
+        b->load.failed = 1;
+        stop(b);
+    }
+}
+
+static int write_config(char *path, const char *fmt, ...)
+{
+    va_list ap;
+
+    int fd = mkstemp(path);
+    if(fd == -1) return GC_ERROR;
+
+    FILE *f = fdopen(fd, "w");
+    if(!f) {
+        close(fd);
+        return GC_ERROR;
+    }
+
+    va_start(ap, fmt);
+    vfprintf(f, fmt, ap);
+    va_end(ap);
+
+    fclose(f);
+
+    return GC_OK;
+}
+
+static struct gc_s *instance(struct ev_loop *loop, int port, const char *cfg,
+                             const char *backends, const char *log)
+{
+    struct gc_init_s init;
+
+    memset(&init, 0, sizeof(init));
+
+    init.loop                   = loop;
+    init.port                   = port;
+    init.cfgfile                = cfg;
+    init.backendfile            = backends;
+    init.logfile                = log ? log : "/dev/null";
+    init.loglevel               = log ? LOG_DEBUG : LOG_ERR;
+    init.module                 = MOD_NONE;
+    init.callback.state_changed = callback_state_changed;
+
+    return gc_init(&init);
+}
+
+static void report(const char *name, double value, const char *unit)
+{
+    printf("%-32s %10.1f %s\n", name, value, unit);
+}
+
+int main(int argc, char **argv)
+{
+    const char *log = argc > 1 ? argv[1] : NULL;
+    struct upstream_s up;
+    struct echo_s echo;
+    struct bench_s b;
+    int ret = 1;
+
+    char cfg_tunnel[]   = "/tmp/gc_bench_tunnel_XXXXXX";
+    char cfg_endpoint[] = "/tmp/gc_bench_endpoint_XXXXXX";
+    char cfg_backends[] = "/tmp/gc_bench_backends_XXXXXX";
+
+    memset(&b, 0, sizeof(b));
+    pattern_init();
+
+    SSL_library_init();
+    SSL_load_error_strings();
+
+    if(upstream_start(&up) != GC_OK) {
+        printf("Mock upstream couldn't be started\n");
+        return 1;
+    }
+
+    echo.fd = listen_local(&echo.port);
+    if(echo.fd == -1 || pthread_create(&echo.thread, NULL, echo_run, &echo) != 0) {
+        printf("Echo backend couldn't be started\n");
+        return 1;
+    }
+
+    if(write_config(cfg_tunnel,
+                    "{ \"user\" : \"bench\", \"password\" : \"bench\", \"device\" : \"tunnel\",\n"
+                    "  \"tunnels\" : [ { \"cloud\" : \"bench\", \"device\" : \"endpoint\",\n"
+                    "                  \"port\" : %d, \"portLocal\" : 0 } ] }\n",
+                    echo.port) != GC_OK ||
+       write_config(cfg_endpoint,
+                    "{ \"user\" : \"bench\", \"password\" : \"bench\", \"device\" : \"endpoint\",\n"
+                    "  \"allow\" : [ %d ], \"keepalive\" : [ { \"port\" : %d } ] }\n",
+                    echo.port, echo.port) != GC_OK ||
+       write_config(cfg_backends,
+                    "{ \"backends\" : [ { \"ip\" : \"127.0.0.1\", \"hostname\" : \"localhost\" } ],\n"
+                    "  \"compare\" : 0 }\n") != GC_OK) {
+        printf("Configuration couldn't be written\n");
+        goto out;
+    }
+
+    struct ev_loop *loop = ev_loop_new(EVFLAG_AUTO);
+
+    b.tunnel   = instance(loop, up.port, cfg_tunnel,   cfg_backends, log);
+    b.endpoint = instance(loop, up.port, cfg_endpoint, cfg_backends, log);
+    if(!b.tunnel || !b.endpoint) {
+        printf("Instances couldn't be initialized\n");
+        goto out;
+    }
+
+    b.port      = echo.port;
+    b.load.loop = loop;
+    ev_async_init(&b.load.done, load_done);
+    b.load.done.data = &b;
+    ev_async_start(loop, &b.load.done);
+
+    b.started = now();
+    ev_timer_init(&b.ready, ready, 0.01, 0.01);
+    b.ready.data = &b;
+    ev_timer_start(loop, &b.ready);
+
+    ev_run(loop, 0);
+
+    if(b.load.thread) pthread_join(b.load.thread, NULL);
+    ev_async_stop(loop, &b.load.done);
+
+    if(b.timeout) {
+        printf("Tunnel wasn't paired within %.0f s\n", READY_TIMEOUT);
+    } else if(b.load.corrupted) {
+        printf("Echoed data doesn't match what was sent\n");
+    } else if(b.load.failed) {
+        printf("Load generator failed\n");
+    } else {
+        report("echo latency p50", gc_histogram_percentile(&b.load.latency, 50.0) / 1e3, "us");
+        report("echo latency p99", gc_histogram_percentile(&b.load.latency, 99.0) / 1e3, "us");
+        report("tunnel throughput", b.load.mbps, "MB/s");
+        report("connections", b.load.connps, "conn/s");
+        report("backend reuse", b.reuse, "%");
+
+        // Sequential streams have to be served by kept-alive connections
+        ret = b.reuse > 0. ? 0 : 1;
+        if(ret != 0) printf("Backend connections weren't reused\n");
+    }
+
+    gc_deinit(b.tunnel);
+    gc_deinit(b.endpoint);
+    ev_loop_destroy(loop);
+
+out:
+    upstream_stop(&up);
+
+    shutdown(echo.fd, SHUT_RDWR);
+    pthread_join(echo.thread, NULL);
+    close(echo.fd);
+
+    unlink(cfg_tunnel);
+    unlink(cfg_endpoint);
+    unlink(cfg_backends);
+
+    return ret;
+}
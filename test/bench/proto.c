@@ -0,0 +1,331 @@
+/*
+ *
+ * GrizzlyCloud library - simplified VPN alternative for IoT
+ * Copyright (C) 2017 - 2018 Filip Pancik
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <gc.h>
+
+#define ITERATIONS 200000
+
+/*
+ * Serializer as it was before script/proto/protogen.py emitted
+ * size and write functions: one hm_prealloc() per field,
+ * followed by another copy to prepend frame length.
+ */
+static void legacy_add(struct hm_pool_s *pool, sn *dst, const void *src, const int nsrc)
+{
+    int offset_0 = dst->n;
+    int offset_1 = dst->n + sizeof(nsrc);
+
+    dst->n += nsrc + sizeof(nsrc);
+    dst->s  = hm_prealloc(pool, dst->s, dst->n);
+
+    memcpy(dst->s + offset_0, &nsrc, sizeof(nsrc));
+    gc_swap_memory(dst->s + offset_0, sizeof(nsrc));
+    memcpy(dst->s + offset_1, src, nsrc);
+}
+
+static void legacy_add_int(struct hm_pool_s *pool, sn *dst, int v)
+{
+    int offset_0 = dst->n;
+
+    dst->n += sizeof(v);
+    dst->s  = hm_prealloc(pool, dst->s, dst->n);
+
+    memcpy(dst->s + offset_0, &v, sizeof(v));
+    gc_swap_memory(dst->s + offset_0, sizeof(v));
+}
+
+static void legacy_frame(struct hm_pool_s *pool, sn *fields, int nfields,
+                         enum proto_e type)
+{
+    int i;
+    sn dst = { .s = NULL, .n = 0, .offset = 0 };
+
+    legacy_add_int(pool, &dst, GCPROTO_VERSION);
+    legacy_add_int(pool, &dst, type);
+
+    for(i = 0; i < nfields; i++) {
+        legacy_add(pool, &dst, fields[i].s, fields[i].n);
+    }
+
+    // net_send()
+    char *frame = hm_palloc(pool, dst.n + sizeof(int));
+    int len = dst.n;
+    gc_swap_memory((void *)&len, sizeof(len));
+    memcpy(frame, &len, sizeof(len));
+    memcpy(frame + sizeof(len), dst.s, dst.n);
+
+    hm_pfree(pool, dst.s);
+    hm_pfree(pool, frame);
+}
+
+static void presized_frame(struct hm_pool_s *pool, struct proto_s *p)
+{
+    int n = gc_serialize_size(p);
+    assert(n > 0);
+
+    char *frame = hm_palloc(pool, GCPROTO_FRAME_HEADROOM + n);
+    int len = gc_serialize_write(frame + GCPROTO_FRAME_HEADROOM, p);
+    gc_swap_memory((void *)&len, sizeof(len));
+    memcpy(frame, &len, sizeof(len));
+
+    hm_pfree(pool, frame);
+}
+
+static void iov_frame(struct hm_pool_s *pool, struct proto_s *p)
+{
+    int n = gc_serialize_size(p);
+    int nhdr = gc_serialize_hdr_size(p);
+    assert(n > 0 && nhdr > 0);
+
+    struct iovec iov[GCPROTO_IOV_MAX];
+    char *hdr = hm_palloc(pool, GCPROTO_FRAME_HEADROOM + nhdr);
+    int niov = gc_serialize_iov(hdr + GCPROTO_FRAME_HEADROOM, iov, p);
+    assert(niov > 0);
+    gc_swap_memory((void *)&n, sizeof(n));
+    memcpy(hdr, &n, sizeof(n));
+
+    hm_pfree(pool, hdr);
+}
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench(struct hm_pool_s *pool, const char *name,
+                  struct proto_s *p, sn *fields, int nfields)
+{
+    int i;
+    double t0, t1, t2, t3;
+
+    t0 = now();
+    for(i = 0; i < ITERATIONS; i++) {
+        legacy_frame(pool, fields, nfields, p->type);
+    }
+    t1 = now();
+    for(i = 0; i < ITERATIONS; i++) {
+        presized_frame(pool, p);
+    }
+    t2 = now();
+    for(i = 0; i < ITERATIONS; i++) {
+        iov_frame(pool, p);
+    }
+    t3 = now();
+
+    printf("%-20s %6d bytes  legacy %8.1f ns  presized %8.1f ns  x%.2f  iov %8.1f ns  x%.2f\n",
+           name, gc_serialize_size(p),
+           (t1 - t0) * 1e9 / ITERATIONS,
+           (t2 - t1) * 1e9 / ITERATIONS,
+           (t1 - t0) / (t2 - t1),
+           (t3 - t2) * 1e9 / ITERATIONS,
+           (t1 - t0) / (t3 - t2));
+}
+
+int main()
+{
+    struct hm_pool_s *pool;
+    struct hm_log_s glog;
+
+    hm_log_open(&glog, NULL, LOG_ERR);
+    pool = hm_create_pool();
+    if(pool == NULL) return 1;
+    pool->log = &glog;
+
+    static char payload[RB_SLOT_SIZE];
+    memset(payload, 'x', sizeof(payload));
+
+    sn_initz(to,       "DevName2");
+    sn_initz(address,  "0123456789abcdef");
+    sn_initz(tp,       "tunnel_request/22/17/8888");
+    sn_initz(cloud,    "grizzlycloud1");
+    sn_initz(email,    "grizzlycloud");
+    sn_initz(password, "StrongPassword");
+    sn_initz(port,     "22");
+    sn_initz(lport,    "8888");
+    sn_initz(error,    "ok");
+    sn_initz(type,     "device");
+    sn_initz(version,  "1");
+    sn_initr(list, payload, 256);
+
+    int sizes[] = { 64, 1024, RB_SLOT_SIZE };
+    int i;
+    for(i = 0; i < (int)COUNT(sizes); i++) {
+        sn_initr(body, payload, sizes[i]);
+
+        struct proto_s m = { .type = MESSAGE_TO };
+        sn_set(m.u.message_to.to,      to);
+        sn_set(m.u.message_to.address, address);
+        sn_set(m.u.message_to.tp,      tp);
+        sn_set(m.u.message_to.body,    body);
+
+        sn fields[] = { to, address, tp, body };
+        bench(pool, "MESSAGE_TO", &m, fields, COUNT(fields));
+    }
+
+    for(i = 0; i < (int)COUNT(sizes); i++) {
+        sn_initr(body, payload, sizes[i]);
+
+        struct proto_s m = { .type = MESSAGE_FROM };
+        sn_set(m.u.message_from.from_cloud,   cloud);
+        sn_set(m.u.message_from.from_device,  to);
+        sn_set(m.u.message_from.from_address, address);
+        sn_set(m.u.message_from.tp,           tp);
+        sn_set(m.u.message_from.body,         body);
+
+        sn fields[] = { cloud, to, address, tp, body };
+        bench(pool, "MESSAGE_FROM", &m, fields, COUNT(fields));
+    }
+
+    {
+        struct proto_s m = { .type = DEVICE_PAIR };
+        sn_set(m.u.device_pair.cloud,       cloud);
+        sn_set(m.u.device_pair.device,      to);
+        sn_set(m.u.device_pair.local_port,  lport);
+        sn_set(m.u.device_pair.remote_port, port);
+
+        sn fields[] = { cloud, to, lport, port };
+        bench(pool, "DEVICE_PAIR", &m, fields, COUNT(fields));
+    }
+
+    {
+        struct proto_s m = { .type = ACCOUNT_LOGIN };
+        sn_set(m.u.account_login.email,    email);
+        sn_set(m.u.account_login.password, password);
+        sn_set(m.u.account_login.devname,  to);
+
+        sn fields[] = { email, password, to };
+        bench(pool, "ACCOUNT_LOGIN", &m, fields, COUNT(fields));
+    }
+
+    {
+        struct proto_s m = { .type = ACCOUNT_SET };
+        sn_set(m.u.account_set.email,    email);
+        sn_set(m.u.account_set.password, password);
+
+        sn fields[] = { email, password };
+        bench(pool, "ACCOUNT_SET", &m, fields, COUNT(fields));
+    }
+
+    {
+        struct proto_s m = { .type = ACCOUNT_EXISTS };
+        sn_set(m.u.account_exists.email,    email);
+        sn_set(m.u.account_exists.password, password);
+
+        sn fields[] = { email, password };
+        bench(pool, "ACCOUNT_EXISTS", &m, fields, COUNT(fields));
+    }
+
+    {
+        struct proto_s m = { .type = DEVICE_PAIR_REPLY };
+        sn_set(m.u.device_pair_reply.cloud, cloud);
+        sn_set(m.u.device_pair_reply.error, error);
+        sn_set(m.u.device_pair_reply.list,  list);
+        sn_set(m.u.device_pair_reply.type,  type);
+
+        sn fields[] = { cloud, error, list, type };
+        bench(pool, "DEVICE_PAIR_REPLY", &m, fields, COUNT(fields));
+    }
+
+    {
+        struct proto_s m = { .type = OFFLINE_SET };
+        sn_set(m.u.offline_set.address, address);
+        sn_set(m.u.offline_set.cloud,   cloud);
+        sn_set(m.u.offline_set.device,  to);
+
+        sn fields[] = { address, cloud, to };
+        bench(pool, "OFFLINE_SET", &m, fields, COUNT(fields));
+    }
+
+    {
+        struct proto_s m = { .type = ACCOUNT_LIST_REPLY };
+        sn_set(m.u.account_list_reply.error, error);
+        sn_set(m.u.account_list_reply.list,  list);
+
+        sn fields[] = { error, list };
+        bench(pool, "ACCOUNT_LIST_REPLY", &m, fields, COUNT(fields));
+    }
+
+    {
+        struct proto_s m = { .type = TRAFFIC_GET_REPLY };
+        sn_set(m.u.traffic_get_reply.list,  list);
+        sn_set(m.u.traffic_get_reply.error, error);
+
+        sn fields[] = { list, error };
+        bench(pool, "TRAFFIC_GET_REPLY", &m, fields, COUNT(fields));
+    }
+
+    {
+        struct proto_s m = { .type = VERSION_MISMATCH };
+        sn_set(m.u.version_mismatch.master, version);
+        sn_set(m.u.version_mismatch.slave,  version);
+
+        sn fields[] = { version, version };
+        bench(pool, "VERSION_MISMATCH", &m, fields, COUNT(fields));
+    }
+
+    {
+        struct proto_s m = { .type = MESSAGE_TO_SET_REPLY };
+        sn_set(m.u.message_to_set_reply.error, error);
+
+        sn fields[] = { error };
+        bench(pool, "MESSAGE_TO_SET_REPLY", &m, fields, COUNT(fields));
+    }
+
+    {
+        struct proto_s m = { .type = ACCOUNT_SET_REPLY };
+        sn_set(m.u.account_set_reply.error, error);
+
+        sn fields[] = { error };
+        bench(pool, "ACCOUNT_SET_REPLY", &m, fields, COUNT(fields));
+    }
+
+    {
+        struct proto_s m = { .type = ACCOUNT_LOGIN_REPLY };
+        sn_set(m.u.account_login_reply.error, error);
+
+        sn fields[] = { error };
+        bench(pool, "ACCOUNT_LOGIN_REPLY", &m, fields, COUNT(fields));
+    }
+
+    {
+        struct proto_s m = { .type = ACCOUNT_EXISTS_REPLY };
+        sn_set(m.u.account_exists_reply.error, error);
+
+        sn fields[] = { error };
+        bench(pool, "ACCOUNT_EXISTS_REPLY", &m, fields, COUNT(fields));
+    }
+
+    // Messages without fields
+    static const enum proto_e empty[] = {
+        ACCOUNT_LIST, TRAFFIC_MI, TRAFFIC_GET, ACCOUNT_GET
+    };
+    static const char *empty_name[] = {
+        "ACCOUNT_LIST", "TRAFFIC_MI", "TRAFFIC_GET", "ACCOUNT_GET"
+    };
+    for(i = 0; i < (int)COUNT(empty); i++) {
+        struct proto_s m = { .type = empty[i] };
+        bench(pool, empty_name[i], &m, NULL, 0);
+    }
+
+    hm_destroy_pool(pool);
+
+    return 0;
+}